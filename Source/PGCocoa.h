@@ -8,6 +8,21 @@
  */
 
 #import "PGConnection.h"
+#import "PGConnectionMultiplexer.h"
+#import "PGError.h"
+#import "PGLargeObject.h"
+#import "PGMemoryAccount.h"
+#import "PGParallelScan.h"
 #import "PGPreparedQuery.h"
+#import "PGQueryCache.h"
+#import "PGReplicaRouter.h"
+#import "PGReplicationStream.h"
 #import "PGResult.h"
+#import "PGResultSnapshot.h"
+#import "PGResultStructs.h"
+#import "PGResultWriter.h"
 #import "PGRow.h"
+#import "PGRowMapper.h"
+#import "PGShardRouter.h"
+#import "PGWorkloadRecorder.h"
+#import "PGWriteCoalescer.h"
@@ -9,7 +9,12 @@
 #import <Cocoa/Cocoa.h>
 
 @class PGResult;
+@class PGRow;
 @class PGPreparedQuery;
+@class PGMemoryAccount;
+@class PGQueryCache;
+@class PGWorkloadRecorder;
+@class PGQueryParameters;
 struct pg_conn;
 
 /**  Mapped directly to ConnStatusType */
@@ -47,37 +52,218 @@ typedef enum {
 	kPGTransactionUnknown			/**< cannot determine status */
 } PGTransactStatusType;
 
+/** Mapped directly to PostgresPollingStatusType */
+typedef enum {
+	kPGPollingFailed = 0,			/**< connection attempt failed */
+	kPGPollingReading,				/**< wait until the socket is readable */
+	kPGPollingWriting,				/**< wait until the socket is writable */
+	kPGPollingOK,					/**< connection is ready */
+	kPGPollingActive				/**< unused; keep for awhile for backwards compatibility */
+} PGPollingStatusType;
+
+/** Transaction isolation levels for -performTransactionWithIsolation:options:block:error: */
+typedef enum {
+	kPGIsolationLevelDefault,		/**< the session's default_transaction_isolation */
+	kPGIsolationLevelReadCommitted,
+	kPGIsolationLevelRepeatableRead,
+	kPGIsolationLevelSerializable
+} PGIsolationLevel;
+
+/** Transaction access modes, which may be combined */
+typedef enum {
+	kPGTransactionOptionNone       = 0,
+	kPGTransactionOptionReadOnly   = 1 << 0,	/**< READ ONLY */
+	kPGTransactionOptionDeferrable = 1 << 1		/**< DEFERRABLE; only meaningful for
+												 * serializable, read-only transactions */
+} PGTransactionOptions;
+
+@class PGConnection;
+
+/** A unit of work performed within a transaction. Return NO and set error to roll back. */
+typedef BOOL (^PGTransactionBlock)(PGConnection *conn, NSError **error);
+
+/** Receives each row of a streamed query. Set stop to YES to cancel the query. */
+typedef void (^PGRowHandler)(PGRow *row, BOOL *stop);
+
+/** Receives each result of a batch as it completes. Set stop to YES to cancel the batch. */
+typedef void (^PGResultHandler)(PGResult *result, NSUInteger index, BOOL *stop);
+
 @interface PGConnection : NSObject 
 {
 	struct pg_conn *_connection;
 
 	NSDictionary *_params;
+	NSDictionary *_sessionParams;
+
+	// NULL-terminated keyword/value arrays passed to PQconnectdbParams(), built once
+	const char **_keywords;
+	const char **_values;
+
+	NSUInteger _transactionDepth;	// 0 outside performTransaction:, incremented per savepoint
+	NSUInteger _maxTransactionAttempts;
+
+	PGMemoryAccount *_memoryAccount;
+	NSUInteger _maxResultBytes;
+
+	PGQueryCache *_queryCache;
+
+	PGWorkloadRecorder *_recorder;
+	uint32_t _recordingSession;
 }
 
 @property (readonly) NSString *errorMessage;
 @property (readonly) NSError  *error;
 @property (readonly) PGConnStatusType status;
 @property (readonly) PGTransactStatusType transactionStatus;
+@property (readonly) NSInteger serverVersion;	///< e.g., 90305 for 9.3.5; 0 if not connected
+
+/** The number of times a transaction block is attempted when it fails with a
+ *  serialization failure (40001) or deadlock (40P01). Defaults to 5.
+ */
+@property NSUInteger maxTransactionAttempts;
+
+/** The account charged for every live result created by this connection. */
+@property (readonly) PGMemoryAccount *memoryAccount;
+
+/** The largest result executeQuery:, executeQuery:values: and executeCachedQuery:values:tags:
+ *  will accumulate, or 0 (the default) for no limit.
+ * @discussion When set, rows are received one at a time and copied into the result, so
+ *             a query whose result would exceed the limit is cancelled as soon as it does,
+ *             and an error result saying so is returned instead. Use
+ *             executeQuery:values:rowHandler: to process larger results.
+ *
+ *             The results of executeBatch: and of prepared queries are not limited.
+ */
+@property NSUInteger maxResultBytes;
+
+/** The cache used by executeCachedQuery:values:tags:. May be shared by many connections. */
+@property (retain) PGQueryCache *queryCache;
+
+/** When set, every statement executed, including by prepared queries, is recorded for replay.
+ *  Cached results that aren't executed are not recorded.
+ */
+@property (retain) PGWorkloadRecorder *recorder;
 
 - (id)initWithParameters:(NSDictionary *)params;
 
+/** The designated initializer.
+ * @discussion The connection parameters are converted once to the keyword/value arrays
+ *             used by PQconnectdbParams(), so values need no quoting or escaping. If
+ *             application_name is not specified, the process name is used as the fallback.
+ * @param params the libpq connection parameters, keyed by the PGConnectionParameter constants
+ * @param sessionParams run-time parameters (e.g., statement_timeout, work_mem) sent in
+ *        the startup packet. May be nil.
+ */
+- (id)initWithParameters:(NSDictionary *)params sessionParameters:(NSDictionary *)sessionParams;
+
 - (BOOL)connect;
 - (void)disconnect;
 
+/** Begin a non-blocking connection attempt with PQconnectStartParams().
+ * @return NO if the connection could not be started; otherwise, call -pollConnect until
+ *         it returns kPGPollingOK or kPGPollingFailed.
+ */
+- (BOOL)startConnect;
+- (PGPollingStatusType)pollConnect;
+
 - (PGResult *)executeQuery:(NSString *)query;
 - (PGResult *)executeQuery:(NSString *)query values:(NSArray *)values;
 
+/** Execute a query, passing each row to a handler as it is received.
+ * @discussion Only one row is held in memory at a time, regardless of maxResultBytes.
+ * @param values the values to bind to query parameters; may be nil
+ * @param handler invoked once per row, on the calling thread
+ * @return the final result, which has no rows, or an error result. If the handler
+ *         stops the query, the result is the server's cancellation error.
+ */
+- (PGResult *)executeQuery:(NSString *)query values:(NSArray *)values rowHandler:(PGRowHandler)handler;
+
+/** Execute a read-only query, returning a result from queryCache if present.
+ * @discussion Successful results are added to the cache, tagged with tags. Without a
+ *             queryCache, this is the same as executeQuery:values:.
+ * @param tags the tags, such as table names, by which the result can be invalidated
+ */
+- (PGResult *)executeCachedQuery:(NSString *)query values:(NSArray *)values tags:(NSArray *)tags;
+
+/** LISTEN on a channel. Notifications are retrieved with consumeNotifications. */
+- (BOOL)listen:(NSString *)channel;
+
+/** Read pending input and return the notifications received, as dictionaries keyed by
+ *  the PGNotification keys, or an empty array.
+ */
+- (NSArray *)consumeNotifications;
+
+/** Send several statements in one round trip and return every result.
+ * @discussion The statements are sent as a single simple-query message, so they may not
+ *             have parameters and their results are in text format. They run in one
+ *             implicit transaction unless the string contains transaction commands. If a
+ *             statement fails, its error result is the last element: the server skips the
+ *             remaining statements and rolls back the implicit transaction.
+ * @param statements SQL statements separated by semicolons
+ * @return an array of PGResult, one per executed statement
+ */
+- (NSArray *)executeBatch:(NSString *)statements;
+
+/** Send several statements in one round trip, passing each result to a handler as it
+ *  completes.
+ * @return NO if the batch could not be sent, was stopped, or a statement failed
+ */
+- (BOOL)executeBatch:(NSString *)statements resultHandler:(PGResultHandler)handler;
+
+/** Join an array of statements into one batch.
+ * @see executeBatch:
+ */
+- (NSArray *)executeQueries:(NSArray *)queries;
+
+/** Request that the server abandon the command in progress. */
+- (BOOL)cancel;
+
+/** Wrap a PGresult obtained from this connection, charging it to memoryAccount. */
+- (PGResult *)_resultWithResult:(struct pg_result *)result;
+
+/** Send a query with PQsendQueryParams() and switch to single-row mode. The caller
+ *  receives the rows with PQgetResult() until it returns NULL.
+ */
+- (BOOL)_sendSingleRowQuery:(NSString *)query values:(NSArray *)values;
+
+/** Record an execution with the recorder, if any. start is from CFAbsoluteTimeGetCurrent().
+ *  If params is not nil, its bound values are recorded rather than values.
+ */
+- (void)_recordQuery:(NSString *)query values:(NSArray *)values parameters:(PGQueryParameters *)params count:(NSInteger)nParams
+			   flags:(int)flags start:(double)start status:(int)status;
+
 - (NSString *)valueForServerParameter:(NSString *)paramName;
 
 - (BOOL)beginTransaction;
 - (BOOL)commitTransaction;
 - (BOOL)rollbackTransaction;
 
+/** Perform a block within a transaction using the session's default isolation level.
+ * @see performTransactionWithIsolation:options:block:error:
+ */
+- (BOOL)performTransaction:(PGTransactionBlock)block error:(NSError **)error;
+
+/** Perform a block within a transaction.
+ * @discussion The transaction is committed if the block returns YES and rolled back otherwise.
+ *             If the transaction fails with a serialization failure or deadlock, it is rolled
+ *             back and the block is invoked again after a randomized, exponentially increasing
+ *             delay, up to maxTransactionAttempts. When invoked while a transaction is already
+ *             in progress, the block is performed within a savepoint instead, the level and
+ *             options are ignored, and retrying is left to the outermost transaction.
+ * @param level the isolation level for BEGIN
+ * @param options the access mode for BEGIN
+ * @param block the work to perform; may be invoked more than once
+ * @param error on failure, the error from the block or from the failed transaction command
+ * @return YES if the transaction (or savepoint) was committed
+ */
+- (BOOL)performTransactionWithIsolation:(PGIsolationLevel)level options:(PGTransactionOptions)options block:(PGTransactionBlock)block error:(NSError **)error;
+
 - (struct pg_conn *)conn;
 
 @end
 
 extern NSString *const PostgreSQLErrorDomain;
+extern NSString *const PGErrorSQLStateKey;		///< userInfo key for the five-character SQLSTATE
 
 
 // Connection Parameter Keys
@@ -92,3 +278,14 @@ extern NSString *const PGConnectionParameterOptionsKey;
 extern NSString *const PGConnectionParameterSSLModeKey;
 extern NSString *const PGConnectionParameterKerberosServiceNameKey;
 extern NSString *const PGConnectionParameterServiceNameKey;
+extern NSString *const PGConnectionParameterApplicationNameKey;
+extern NSString *const PGConnectionParameterReplicationKey;	///< "database" for a logical replication connection
+
+// Notification Keys
+extern NSString *const PGNotificationChannelKey;
+extern NSString *const PGNotificationPayloadKey;
+extern NSString *const PGNotificationProcessIDKey;
+
+// Session Parameter Keys
+extern NSString *const PGSessionParameterStatementTimeoutKey;
+extern NSString *const PGSessionParameterWorkMemKey;
@@ -8,6 +8,11 @@
 
 #import "PGConnection.h"
 #import "PGResult.h"
+#import "PGError.h"
+#import "PGRow.h"
+#import "PGMemoryAccount.h"
+#import "PGQueryCache.h"
+#import "PGWorkloadRecorder.h"
 #import "PGPreparedQuery.h"
 #import "PGInternal.h"
 #import "PGQueryParameters.h"
@@ -19,39 +24,133 @@ NSInteger PGSecondsFromUTC(PGConnection *conn);
 
 #pragma mark -
 
+/** Escape a run-time parameter value for the options keyword, where whitespace separates
+ *  arguments unless preceded by a backslash.
+ */
+static NSString *PGEscapeOptionValue(NSString *value)
+{
+	NSMutableString *escaped = [NSMutableString stringWithCapacity:value.length];
+
+	for (NSUInteger i = 0; i < value.length; i++) {
+		unichar c = [value characterAtIndex:i];
+		if (c == '\\' || c == ' ' || c == '\t')
+			[escaped appendString:@"\\"];
+		[escaped appendFormat:@"%C", c];
+	}
+	return escaped;
+}
+
 @implementation PGConnection
 
+@synthesize maxTransactionAttempts = _maxTransactionAttempts;
+@synthesize memoryAccount = _memoryAccount;
+@synthesize maxResultBytes = _maxResultBytes;
+@synthesize queryCache = _queryCache;
+@synthesize recorder = _recorder;
+
 - (id)initWithParameters:(NSDictionary *)params;
+{
+	return [self initWithParameters:params sessionParameters:nil];
+}
+
+- (id)initWithParameters:(NSDictionary *)params sessionParameters:(NSDictionary *)sessionParams
 {
 	if (self = [super init]) {
 		_params = [params copy];
+		_sessionParams = [sessionParams copy];
+		_maxTransactionAttempts = 5;
+		_memoryAccount = [[PGMemoryAccount alloc] init];
 	}
 
 	return self;
 }
 
-- (BOOL)connect
+- (BOOL)_buildConnectionArrays
 {
-	NSArray *keys = _params.allKeys;
+	if (_keywords) return YES;
+
+	NSMutableDictionary *params = [NSMutableDictionary dictionaryWithCapacity:_params.count + 2];
+
+	for (id key in _params)
+		params[[key description]] = [_params[key] description];
 
-	if ([keys containsObject:@"application_name"] == NO) {
-		NSString *name = [[NSProcessInfo processInfo] processName];
-		name = [name stringByReplacingOccurrencesOfString:@"\\" withString:@"\\\\"]; // escape backlashes with double-backslash
-		name = [name stringByReplacingOccurrencesOfString:@"'" withString:@"\\'"];    // escape single quote with backslash-quote
+	if (params[PGConnectionParameterApplicationNameKey] == nil)
+		params[@"fallback_application_name"] = [[NSProcessInfo processInfo] processName];
+
+	if (_sessionParams.count) {
+		NSMutableString *options = [NSMutableString string];
+
+		if (params[PGConnectionParameterOptionsKey])
+			[options appendString:params[PGConnectionParameterOptionsKey]];
+
+		for (id key in _sessionParams) {
+			NSString *value = PGEscapeOptionValue([_sessionParams[key] description]);
+			[options appendFormat:@"%s-c %@=%@", (options.length ? " " : ""), key, value];
+		}
+		params[PGConnectionParameterOptionsKey] = options;
 	}
-	
-	NSMutableString *connString = [NSMutableString string];
 
-	for (int i = 0; i < keys.count; i++) {
-		NSString *key = keys[i];
-		[connString appendFormat:@"%@='%@' ", key, _params[key]];
+	NSUInteger count = params.count;
+
+	_keywords = calloc(count + 1, sizeof(char *));
+	_values   = calloc(count + 1, sizeof(char *));
+	if (!_keywords || !_values) {
+		free(_keywords);
+		free(_values);
+		_keywords = _values = NULL;
+		return NO;
 	}
-	
-	_connection = PQconnectdb([connString cStringUsingEncoding:NSUTF8StringEncoding]);
+
+	NSUInteger i = 0;
+	for (NSString *key in params) {
+		_keywords[i] = strdup(key.UTF8String);
+		_values[i]   = strdup([params[key] UTF8String]);
+		i++;
+	}
+
+	return YES;
+}
+
+- (void)_freeConnectionArrays
+{
+	for (int i = 0; _keywords && _keywords[i]; i++) {
+		free((void *)_keywords[i]);
+		free((void *)_values[i]);
+	}
+	free(_keywords);
+	free(_values);
+	_keywords = _values = NULL;
+}
+
+- (BOOL)connect
+{
+	if ([self _buildConnectionArrays] == NO)
+		return NO;
+
+	if (_connection) PQfinish(_connection);
+
+	_connection = PQconnectdbParams(_keywords, _values, 0);
 
 	return (PQstatus(_connection) == CONNECTION_OK);
 }
 
+- (BOOL)startConnect
+{
+	if ([self _buildConnectionArrays] == NO)
+		return NO;
+
+	if (_connection) PQfinish(_connection);
+
+	_connection = PQconnectStartParams(_keywords, _values, 0);
+
+	return (_connection != NULL && PQstatus(_connection) != CONNECTION_BAD);
+}
+
+- (PGPollingStatusType)pollConnect
+{
+	return PQconnectPoll(_connection);
+}
+
 - (void)disconnect
 {
 	if (_connection) {
@@ -65,17 +164,175 @@ NSInteger PGSecondsFromUTC(PGConnection *conn);
 	PQreset(_connection);
 }
 
+- (PGResult *)_resultWithResult:(PGresult *)result
+{
+	PGResult *object = [PGResult _resultWithResult:result];
+
+	[object _setMemoryAccount:_memoryAccount];
+
+	return object;
+}
+
 - (PGResult *)executeQuery:(NSString *)query
 {
+	if (_maxResultBytes)
+		return [self executeQuery:query values:nil];
+
+	CFAbsoluteTime start = _recorder ? CFAbsoluteTimeGetCurrent() : 0;
 	PGresult *result = PQexecParams(_connection, query.UTF8String, 0, NULL, NULL, NULL, NULL, 1);
 
-	return [PGResult _resultWithResult:result];
+	if (_recorder) [self _recordQuery:query values:nil parameters:nil count:0 flags:0 start:start status:PQresultStatus(result)];
+	return [self _resultWithResult:result];
+}
+
+/** Send a query with PQsendQueryParams() and switch to single-row mode. */
+- (BOOL)_sendSingleRowQuery:(NSString *)query values:(NSArray *)values
+{
+	PGQueryParameters *params = nil;
+	int nParams = 0;
+	Oid *types = NULL;
+	const char ** valrefs = NULL;
+	int *lengths = NULL;
+	int *formats = NULL;
+
+	if (values.count) {
+		if ((params = [PGQueryParameters queryParametersWithValues:values]) == nil)
+			return NO;
+
+		nParams = [params getNumberOfTypes:&types values:&valrefs lengths:&lengths formats:&formats];
+		if (nParams < 0)
+			return NO;
+	}
+
+	if (!PQsendQueryParams(_connection, query.UTF8String, nParams, types, valrefs, lengths, formats, 1))
+		return NO;
+
+	if (!PQsetSingleRowMode(_connection)) {
+		// the query was sent; discard its results so the connection can be used again
+		PGresult *result;
+		while ((result = PQgetResult(_connection)) != NULL)
+			PQclear(result);
+		return NO;
+	}
+	return YES;
+}
+
+/** Receive the results of a single-row mode query. The handler takes ownership of each
+ *  row result; when it returns NO, the query is cancelled and the remaining rows are
+ *  discarded. Returns the final result, which the caller must clear.
+ */
+- (PGresult *)_receiveSingleRowResults:(BOOL (^)(PGresult *row))handler
+{
+	PGresult *result, *final = NULL;
+	BOOL cancelled = NO;
+
+	while ((result = PQgetResult(_connection)) != NULL) {
+		if (PQresultStatus(result) == PGRES_SINGLE_TUPLE) {
+			if (cancelled) {
+				PQclear(result);
+			}
+			else if (handler(result) == NO) {
+				cancelled = YES;
+				[self cancel];
+			}
+		}
+		else {
+			if (final) PQclear(final);
+			final = result;
+		}
+	}
+
+	if (!final)
+		final = PQmakeEmptyPGresult(_connection, PGRES_FATAL_ERROR);
+	else if (cancelled && PQresultStatus(final) != PGRES_FATAL_ERROR) {
+		// the query completed before the cancel request arrived
+		PQclear(final);
+		final = PQmakeEmptyPGresult(_connection, PGRES_FATAL_ERROR);
+	}
+
+	return final;
+}
+
+- (void)setRecorder:(PGWorkloadRecorder *)recorder
+{
+	@synchronized(self) {
+		if (recorder == _recorder) return;
+
+		[_recorder release];
+		_recorder = [recorder retain];
+		_recordingSession = [recorder _nextSessionID];
+	}
+}
+
+- (void)_recordQuery:(NSString *)query values:(NSArray *)values parameters:(PGQueryParameters *)params count:(NSInteger)nParams
+			   flags:(int)flags start:(double)start status:(int)status
+{
+	PGWorkloadRecorder *recorder = _recorder;
+	NSTimeInterval duration = CFAbsoluteTimeGetCurrent() - start;
+
+	if (params)
+		[recorder _recordQuery:query parameters:params count:nParams flags:flags session:_recordingSession start:start duration:duration status:status];
+	else
+		[recorder recordQuery:query values:values flags:flags session:_recordingSession start:start duration:duration status:status];
 }
 
 - (PGResult *)executeQuery:(NSString *)query values:(NSArray *)values
 {
 	PGresult *result;
 	PGQueryParameters *params;
+	CFAbsoluteTime start = _recorder ? CFAbsoluteTimeGetCurrent() : 0;
+
+	if (_maxResultBytes) {
+		if ([self _sendSingleRowQuery:query values:values] == NO)
+			return [self _resultWithResult:PQmakeEmptyPGresult(_connection, PGRES_FATAL_ERROR)];
+
+		// Copy each row into one result, so at most one row is held beyond the result itself.
+		// The first row is charged for the result's fields as well as its cells.
+		__block PGresult *merged = NULL;
+		__block size_t total = 0;
+		__block BOOL exceeded = NO;
+		NSUInteger limit = _maxResultBytes;
+
+		result = [self _receiveSingleRowResults:^BOOL(PGresult *row) {
+			BOOL success;
+
+			total += merged ? PGresultRowMemorySize(row, 0) : PGresultMemorySize(row);
+			exceeded = (total > limit);
+			if ((success = !exceeded)) {
+				if (!merged) merged = PQcopyResult(row, PG_COPYRES_ATTRS);
+
+				int tuple = PQntuples(merged);
+				for (int field = 0, count = PQnfields(row); field < count && success; field++) {
+					if (PQgetisnull(row, 0, field))
+						success = PQsetvalue(merged, tuple, field, NULL, -1);
+					else
+						success = PQsetvalue(merged, tuple, field, PQgetvalue(row, 0, field), PQgetlength(row, 0, field));
+				}
+			}
+			PQclear(row);
+
+			return success;
+		}];
+
+		if (exceeded) {
+			// replace the server's cancellation error
+			PQclear(result);
+			result = PQmakeEmptyPGresult(_connection, PGRES_FATAL_ERROR);
+		}
+		if (merged && PQresultStatus(result) == PGRES_TUPLES_OK) {
+			PQclear(result);
+			result = merged;
+		}
+		else if (merged) {
+			PQclear(merged);
+		}
+		if (_recorder) [self _recordQuery:query values:values parameters:nil count:0 flags:0 start:start status:PQresultStatus(result)];
+
+		PGResult *object = [self _resultWithResult:result];
+		if (exceeded)
+			[object _setErrorMessage:[NSString stringWithFormat:@"The result exceeded the limit of %lu bytes.", (unsigned long)limit]];
+		return object;
+	}
 
 	if ((params = [PGQueryParameters queryParametersWithValues:values]) == nil)
 		return nil;
@@ -95,7 +352,181 @@ NSInteger PGSecondsFromUTC(PGConnection *conn);
 
 	result = PQexecParams(_connection, query.UTF8String, nParams, types, valrefs, lengths, formats, 1);
 
-	return [PGResult _resultWithResult:result];
+	if (_recorder) [self _recordQuery:query values:values parameters:params count:nParams flags:0 start:start status:PQresultStatus(result)];
+	return [self _resultWithResult:result];
+}
+
+- (PGResult *)executeCachedQuery:(NSString *)query values:(NSArray *)values tags:(NSArray *)tags
+{
+	PGQueryCache *cache = self.queryCache;
+	PGQueryParameters *params;
+	PGResult *result;
+
+	if (!cache)
+		return [self executeQuery:query values:values];
+
+	if ((params = [PGQueryParameters queryParametersWithValues:values]) == nil)
+		return nil;
+
+	Oid *types;
+	const char **valrefs;
+	int *lengths;
+	int *formats;
+
+	int nParams = [params getNumberOfTypes:&types values:&valrefs lengths:&lengths formats:&formats];
+	if (nParams < 0)
+		return nil;
+
+	NSMutableData *encoded = [NSMutableData data];
+	[params _appendEncodedValuesToData:encoded];
+	NSData *key = [PGQueryCache keyForQuery:query encodedValues:encoded];
+
+	if ((result = [cache resultForKey:key]) != nil)
+		return result;
+
+	// an invalidation that arrives while the query runs must prevent caching its result
+	NSUInteger generation = [cache generationForTags:tags];
+
+	if (_maxResultBytes) {
+		result = [self executeQuery:query values:values];
+	}
+	else {
+		CFAbsoluteTime start = _recorder ? CFAbsoluteTimeGetCurrent() : 0;
+		result = [self _resultWithResult:PQexecParams(_connection, query.UTF8String, nParams, types, valrefs, lengths, formats, 1)];
+		if (_recorder) [self _recordQuery:query values:values parameters:params count:nParams flags:0 start:start status:result.status];
+	}
+	if (result.status == kPGResultTuplesOK)
+		[cache setResult:result forKey:key tags:tags generation:generation];
+
+	return result;
+}
+
+- (PGResult *)executeQuery:(NSString *)query values:(NSArray *)values rowHandler:(PGRowHandler)handler
+{
+	CFAbsoluteTime start = _recorder ? CFAbsoluteTimeGetCurrent() : 0;
+
+	if ([self _sendSingleRowQuery:query values:values] == NO)
+		return [self _resultWithResult:PQmakeEmptyPGresult(_connection, PGRES_FATAL_ERROR)];
+
+	PGresult *result = [self _receiveSingleRowResults:^BOOL(PGresult *row) {
+		BOOL stop = NO;
+
+		@autoreleasepool {
+			handler([self _resultWithResult:row][0], &stop);
+		}
+		return !stop;
+	}];
+
+	if (_recorder) [self _recordQuery:query values:values parameters:nil count:0 flags:0 start:start status:PQresultStatus(result)];
+	return [self _resultWithResult:result];
+}
+
+- (BOOL)executeBatch:(NSString *)statements resultHandler:(PGResultHandler)handler
+{
+	PGresult *result;
+	NSUInteger index = 0;
+	BOOL stop = NO, failed = NO;
+	CFAbsoluteTime start = _recorder ? CFAbsoluteTimeGetCurrent() : 0;
+
+	if (!PQsendQuery(_connection, statements.UTF8String)) {
+		@autoreleasepool {
+			handler([self _resultWithResult:PQmakeEmptyPGresult(_connection, PGRES_FATAL_ERROR)], 0, &stop);
+		}
+		return NO;
+	}
+
+	// Results must be read until NULL even after stopping, to leave the connection idle.
+	while ((result = PQgetResult(_connection)) != NULL) {
+		if (stop) {
+			PQclear(result);
+			continue;
+		}
+
+		ExecStatusType status = PQresultStatus(result);
+		failed = failed || (status == PGRES_FATAL_ERROR || status == PGRES_BAD_RESPONSE);
+
+		@autoreleasepool {
+			handler([self _resultWithResult:result], index++, &stop);
+		}
+		if (stop) [self cancel];
+	}
+
+	if (_recorder)
+		[self _recordQuery:statements values:nil parameters:nil count:0 flags:kPGWorkloadEventBatch start:start status:failed ? kPGResultFatalError : kPGResultCommandOK];
+
+	return !stop && !failed;
+}
+
+- (NSArray *)executeBatch:(NSString *)statements
+{
+	NSMutableArray *results = [NSMutableArray array];
+
+	[self executeBatch:statements resultHandler:^(PGResult *result, NSUInteger index, BOOL *stop) {
+		[results addObject:result];
+	}];
+
+	return results;
+}
+
+- (NSArray *)executeQueries:(NSArray *)queries
+{
+	NSCharacterSet *trim = [NSCharacterSet characterSetWithCharactersInString:@"; \t\r\n"];
+	NSMutableString *batch = [NSMutableString string];
+
+	for (NSString *query in queries) {
+		[batch appendString:[query stringByTrimmingCharactersInSet:trim]];
+		[batch appendString:@";\n"];
+	}
+
+	return [self executeBatch:batch];
+}
+
+- (BOOL)listen:(NSString *)channel
+{
+	const char *name = channel.UTF8String;
+	char *identifier = PQescapeIdentifier(_connection, name, strlen(name));
+
+	if (!identifier)
+		return NO;
+
+	NSString *command = [@"LISTEN " stringByAppendingString:[NSString stringWithUTF8String:identifier]];
+	PQfreemem(identifier);
+
+	return [self _executeCommand:command error:NULL];
+}
+
+- (NSArray *)consumeNotifications
+{
+	NSMutableArray *notifications = [NSMutableArray array];
+	PGnotify *notify;
+
+	if (!PQconsumeInput(_connection))
+		return notifications;
+
+	while ((notify = PQnotifies(_connection)) != NULL) {
+		NSDictionary *notification = @{
+			PGNotificationChannelKey : [NSString stringWithUTF8String:notify->relname],
+			PGNotificationPayloadKey : notify->extra ? [NSString stringWithUTF8String:notify->extra] : @"",
+			PGNotificationProcessIDKey : @(notify->be_pid) };
+		[notifications addObject:notification];
+		PQfreemem(notify);
+	}
+	return notifications;
+}
+
+- (BOOL)cancel
+{
+	char errbuf[256];
+	PGcancel *cancel;
+	BOOL success;
+
+	if ((cancel = PQgetCancel(_connection)) == NULL)
+		return NO;
+
+	success = PQcancel(cancel, errbuf, sizeof(errbuf));
+	PQfreeCancel(cancel);
+
+	return success;
 }
 
 - (NSString *)errorMessage
@@ -120,34 +551,146 @@ NSInteger PGSecondsFromUTC(PGConnection *conn);
 	return [NSError errorWithDomain:PostgreSQLErrorDomain code:-1 userInfo:info];
 }
 
-- (BOOL)beginTransaction
+// Transaction control and savepoints are recorded too, so a replay keeps each statement
+// in its transaction. They're sent with PQexec(), and may hold two statements, so they're
+// replayed as batches.
+- (BOOL)_executeCommand:(NSString *)command error:(NSError **)error
 {
-	PGresult *result = PQexec(_connection, "BEGIN");
+	CFAbsoluteTime start = _recorder ? CFAbsoluteTimeGetCurrent() : 0;
+	PGResult *result = [self _resultWithResult:PQexec(_connection, command.UTF8String)];
+
+	if (_recorder) [self _recordQuery:command values:nil parameters:nil count:0 flags:kPGWorkloadEventBatch start:start status:result.status];
 
-	ExecStatusType status = PQresultStatus(result);
-	PQclear(result);
+	if (result.status != kPGResultCommandOK && error)
+		*error = result.error;
 
-	return (status == PGRES_COMMAND_OK);
+	return (result.status == kPGResultCommandOK);
+}
+
+- (BOOL)beginTransaction
+{
+	return [self _executeCommand:@"BEGIN" error:NULL];
 }
 
 - (BOOL)commitTransaction
 {
-	PGresult *result = PQexec(_connection, "COMMIT");
+	return [self _executeCommand:@"COMMIT" error:NULL];
+}
 
-	ExecStatusType status = PQresultStatus(result);
-	PQclear(result);
+- (BOOL)rollbackTransaction
+{
+	return [self _executeCommand:@"ROLLBACK" error:NULL];
+}
 
-	return (status == PGRES_COMMAND_OK);
+- (NSError *)_abortedTransactionError
+{
+	NSDictionary *info = @{ NSLocalizedDescriptionKey : @"The transaction was aborted by a failed command." };
+
+	return [NSError errorWithDomain:PostgreSQLErrorDomain code:kPGSQLStateInFailedSQLTransaction userInfo:info];
 }
 
-- (BOOL)rollbackTransaction
+- (BOOL)performTransaction:(PGTransactionBlock)block error:(NSError **)error
 {
-	PGresult *result = PQexec(_connection, "ROLLBACK");
+	return [self performTransactionWithIsolation:kPGIsolationLevelDefault options:kPGTransactionOptionNone block:block error:error];
+}
 
-	ExecStatusType status = PQresultStatus(result);
-	PQclear(result);
-	
-	return (status == PGRES_COMMAND_OK);
+- (BOOL)_performSavepointWithBlock:(PGTransactionBlock)block error:(NSError **)outError
+{
+	NSError *error = nil;
+	NSString *name = [NSString stringWithFormat:@"pgcocoa_savepoint_%lu", (unsigned long)_transactionDepth];
+	BOOL success;
+
+	if ([self _executeCommand:[@"SAVEPOINT " stringByAppendingString:name] error:&error] == NO) {
+		if (outError) *outError = error;
+		return NO;
+	}
+
+	_transactionDepth++;
+	@try {
+		success = block(self, &error);
+	}
+	@catch (NSException *exception) {
+		_transactionDepth--;
+		[self _executeCommand:[NSString stringWithFormat:@"ROLLBACK TO SAVEPOINT %@; RELEASE SAVEPOINT %@", name, name] error:NULL];
+		@throw;
+	}
+	_transactionDepth--;
+
+	if (success && self.transactionStatus == kPGTransactionInError) {
+		error = [self _abortedTransactionError];
+		success = NO;
+	}
+
+	if (success)
+		success = [self _executeCommand:[@"RELEASE SAVEPOINT " stringByAppendingString:name] error:&error];
+	else
+		[self _executeCommand:[NSString stringWithFormat:@"ROLLBACK TO SAVEPOINT %@; RELEASE SAVEPOINT %@", name, name] error:NULL];
+
+	if (!success && outError) *outError = error;
+
+	return success;
+}
+
+- (BOOL)performTransactionWithIsolation:(PGIsolationLevel)level options:(PGTransactionOptions)options block:(PGTransactionBlock)block error:(NSError **)outError
+{
+	NSError *error = nil;
+	BOOL success = NO;
+
+	if (_transactionDepth > 0 || self.transactionStatus == kPGTransactionInTransaction)
+		return [self _performSavepointWithBlock:block error:outError];
+
+	// The mode is part of BEGIN rather than a separate SET TRANSACTION round trip.
+	NSMutableArray *modes = [NSMutableArray arrayWithCapacity:3];
+	switch (level) {
+		case kPGIsolationLevelReadCommitted:  [modes addObject:@"ISOLATION LEVEL READ COMMITTED"];  break;
+		case kPGIsolationLevelRepeatableRead: [modes addObject:@"ISOLATION LEVEL REPEATABLE READ"]; break;
+		case kPGIsolationLevelSerializable:   [modes addObject:@"ISOLATION LEVEL SERIALIZABLE"];    break;
+		default: break;
+	}
+	if (options & kPGTransactionOptionReadOnly)   [modes addObject:@"READ ONLY"];
+	if (options & kPGTransactionOptionDeferrable) [modes addObject:@"DEFERRABLE"];
+
+	NSString *begin = modes.count ? [@"BEGIN " stringByAppendingString:[modes componentsJoinedByString:@", "]] : @"BEGIN";
+
+	for (NSUInteger attempt = 1; ; attempt++) {
+		error = nil;
+
+		if ([self _executeCommand:begin error:&error] == NO)
+			break;
+
+		_transactionDepth = 1;
+		@try {
+			success = block(self, &error);
+		}
+		@catch (NSException *exception) {
+			_transactionDepth = 0;
+			[self _executeCommand:@"ROLLBACK" error:NULL];
+			@throw;
+		}
+		_transactionDepth = 0;
+
+		if (success && self.transactionStatus == kPGTransactionInError) {
+			error = [self _abortedTransactionError];
+			success = NO;
+		}
+
+		// A serializable transaction may also fail at COMMIT, which is retried the same way.
+		if (success)
+			success = [self _executeCommand:@"COMMIT" error:&error];
+		else
+			[self _executeCommand:@"ROLLBACK" error:NULL];
+
+		if (success || attempt >= self.maxTransactionAttempts || ![error isKindOfClass:PGError.class] || ![(PGError *)error isRetryable])
+			break;
+
+		// Exponential backoff starting at 10ms with full jitter, capped at 640ms.
+		uint32_t ceiling = 10000 << MIN(attempt - 1, 6);
+		usleep(arc4random_uniform(ceiling) + 1);
+	}
+
+	if (!success && outError) *outError = error;
+
+	return success;
 }
 
 - (PGConnStatusType)status
@@ -160,6 +703,11 @@ NSInteger PGSecondsFromUTC(PGConnection *conn);
 	return PQtransactionStatus(_connection);
 }
 
+- (NSInteger)serverVersion
+{
+	return PQserverVersion(_connection);
+}
+
 - (NSString *)valueForServerParameter:(NSString *)paramName
 {
 	const char *status = PQparameterStatus(_connection, paramName.UTF8String);
@@ -175,6 +723,11 @@ NSInteger PGSecondsFromUTC(PGConnection *conn);
 - (void)dealloc
 {
 	[_params release];
+	[_sessionParams release];
+	[_memoryAccount release];
+	[_queryCache release];
+	[_recorder release];
+	[self _freeConnectionArrays];
 	if (_connection) PQfinish(_connection);
 	[super dealloc];
 }
@@ -191,6 +744,7 @@ NSInteger PGSecondsFromUTC(PGConnection *conn)
 }
 
 NSString *const PostgreSQLErrorDomain = @"PostgreSQLErrorDomain";
+NSString *const PGErrorSQLStateKey = @"PGErrorSQLState";
 
 // Connection Parameter Keys
 NSString *const PGConnectionParameterHostKey = @"host";
@@ -204,5 +758,16 @@ NSString *const PGConnectionParameterOptionsKey = @"options";
 NSString *const PGConnectionParameterSSLModeKey = @"sslmode";
 NSString *const PGConnectionParameterKerberosServiceNameKey = @"krbsrvname";
 NSString *const PGConnectionParameterServiceNameKey = @"service";
+NSString *const PGConnectionParameterApplicationNameKey = @"application_name";
+NSString *const PGConnectionParameterReplicationKey = @"replication";
+
+// Notification Keys
+NSString *const PGNotificationChannelKey = @"channel";
+NSString *const PGNotificationPayloadKey = @"payload";
+NSString *const PGNotificationProcessIDKey = @"pid";
+
+// Session Parameter Keys
+NSString *const PGSessionParameterStatementTimeoutKey = @"statement_timeout";
+NSString *const PGSessionParameterWorkMemKey = @"work_mem";
 
 
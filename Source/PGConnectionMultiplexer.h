@@ -0,0 +1,99 @@
+//
+//  PGConnectionMultiplexer.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <dispatch/dispatch.h>
+
+@class PGConnection;
+@class PGResult;
+
+typedef void (^PGQueryCompletion)(PGResult *result);
+
+/** The eventual result of a query submitted to a PGConnectionMultiplexer. */
+@interface PGQueryFuture : NSObject
+{
+@public
+	PGQueryFuture *_next;		// link in the multiplexer's submission stack
+@protected
+	NSString *_query;
+	NSArray *_values;
+	PGResult *_result;
+	PGQueryCompletion _completion;
+	dispatch_queue_t _completionQueue;
+	dispatch_group_t _group;	// entered until the result is set
+	volatile int32_t _state;
+	id _multiplexer;			// not retained; valid while the query is in flight
+}
+
+@property (readonly) NSString *query;
+@property (readonly) NSArray *values;
+@property (readonly, getter=isComplete) BOOL complete;
+
+/** Wait for the query to complete and return its result. The result of a cancelled query
+ *  has status kPGResultFatalError.
+ */
+- (PGResult *)result;
+
+/** Wait up to timeout seconds for the result. Returns nil if the query hasn't completed. */
+- (PGResult *)resultWithTimeout:(NSTimeInterval)timeout;
+
+/** Cancel the query. A query not yet sent is never sent; one in progress is cancelled on
+ *  the server with PQcancel().
+ */
+- (void)cancel;
+
+@end
+
+/** Shares one connection among many threads.
+ * @discussion Threads submit queries without taking a lock: each submission is pushed onto
+ *             a lock-free stack, which the multiplexer's queue takes whole and runs in the
+ *             order submitted. The connection is non-blocking and driven by dispatch
+ *             sources, so each query is sent as soon as the previous one completes, and no
+ *             thread waits on the socket. Submitters wait on a future or receive a
+ *             completion block.
+ *
+ *             Each query runs in its own implicit transaction. Work that must share a
+ *             transaction, session state or a prepared statement needs its own connection.
+ */
+@interface PGConnectionMultiplexer : NSObject
+{
+	PGConnection *_connection;
+	dispatch_queue_t _queue;
+	dispatch_source_t _readSource;
+	dispatch_source_t _writeSource;
+	BOOL _writeSourceSuspended;
+
+	PGQueryFuture *volatile _submissions;	// lock-free stack, newest first; capped by -close
+	volatile int32_t _pumpScheduled;
+
+	NSMutableArray *_pending;		// in submission order; only accessed on _queue
+	PGQueryFuture *_inFlight;
+	struct pg_result *_lastResult;
+}
+
+@property (readonly) PGConnection *connection;
+
+/** Take over a connected connection, which must not be used directly afterward. */
+- (id)initWithConnection:(PGConnection *)conn;
+
+- (PGQueryFuture *)submitQuery:(NSString *)query values:(NSArray *)values;
+
+/** Submit a query and call a block with the result.
+ * @param queue the queue for the completion; if NULL, a global concurrent queue
+ */
+- (PGQueryFuture *)submitQuery:(NSString *)query values:(NSArray *)values completionQueue:(dispatch_queue_t)queue completion:(PGQueryCompletion)completion;
+
+/** Submit a query and wait for its result. */
+- (PGResult *)executeQuery:(NSString *)query values:(NSArray *)values;
+
+/** Fail queries not yet sent, wait for the one in progress and stop. Queries submitted
+ *  afterward are cancelled. Called by dealloc.
+ */
+- (void)close;
+
+@end
@@ -0,0 +1,457 @@
+//
+//  PGConnectionMultiplexer.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGConnectionMultiplexer.h"
+#import "PGConnection.h"
+#import "PGResult.h"
+#import "PGQueryParameters_Private.h"
+#import "PGInternal.h"
+#import <libkern/OSAtomic.h>
+#import <pthread.h>
+
+enum {
+	kPGFuturePending = 0,
+	kPGFutureSent,		// claimed by the multiplexer
+	kPGFutureCancelled,	// claimed by -cancel or -close
+	kPGFutureComplete
+};
+
+@interface PGConnectionMultiplexer ()
+- (void)_cancelFuture:(PGQueryFuture *)future;
+@end
+
+@interface PGQueryFuture ()
+- (id)_initWithQuery:(NSString *)query values:(NSArray *)values completionQueue:(dispatch_queue_t)queue completion:(PGQueryCompletion)completion;
+- (BOOL)_markSent:(PGConnectionMultiplexer *)multiplexer;
+- (void)_completeWithResult:(PGResult *)result;
+@end
+
+/** The multiplexer whose queue the thread is running a block for, if any. */
+static pthread_key_t PGMultiplexerQueueKey;
+
+/** Once the multiplexer is closed, the head of its submission stack; later submissions fail. */
+static char PGSubmissionsClosedMarker;
+#define kPGSubmissionsClosed ((PGQueryFuture *)&PGSubmissionsClosedMarker)
+
+static PGResult *PGFailedResult(PGConnection *conn)
+{
+	return [PGResult _resultWithResult:PQmakeEmptyPGresult(conn.conn, PGRES_FATAL_ERROR)];
+}
+
+#pragma mark -
+
+@implementation PGQueryFuture
+
+@synthesize query = _query;
+@synthesize values = _values;
+
+- (id)_initWithQuery:(NSString *)query values:(NSArray *)values completionQueue:(dispatch_queue_t)queue completion:(PGQueryCompletion)completion
+{
+	if (self = [super init]) {
+		_query = [query copy];
+		_values = [values copy];
+		_completion = [completion copy];
+		if (completion) {
+			_completionQueue = queue ? queue : dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+			dispatch_retain(_completionQueue);
+		}
+		_group = dispatch_group_create();
+		dispatch_group_enter(_group);
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[_query release];
+	[_values release];
+	[_result release];
+	[_completion release];
+	if (_completionQueue) dispatch_release(_completionQueue);
+	dispatch_release(_group);
+	[super dealloc];
+}
+
+- (BOOL)isComplete
+{
+	return OSAtomicAdd32Barrier(0, &_state) == kPGFutureComplete;
+}
+
+- (BOOL)_markSent:(PGConnectionMultiplexer *)multiplexer
+{
+	_multiplexer = multiplexer;	// set first, so -cancel finds it once the state is Sent
+	if (OSAtomicCompareAndSwap32Barrier(kPGFuturePending, kPGFutureSent, &_state))
+		return YES;
+
+	_multiplexer = nil;
+	return NO;
+}
+
+// Called exactly once, by whichever of the multiplexer or -cancel claims the future
+- (void)_completeWithResult:(PGResult *)result
+{
+	_result = [result retain];
+	OSMemoryBarrier();
+	_state = kPGFutureComplete;
+	_multiplexer = nil;
+
+	if (_completion) {
+		PGQueryCompletion completion = [_completion retain];
+		dispatch_async(_completionQueue, ^{
+			completion(result);
+			[completion release];
+		});
+	}
+	dispatch_group_leave(_group);
+}
+
+- (PGResult *)result
+{
+	dispatch_group_wait(_group, DISPATCH_TIME_FOREVER);
+	return [[_result retain] autorelease];
+}
+
+- (PGResult *)resultWithTimeout:(NSTimeInterval)timeout
+{
+	if (dispatch_group_wait(_group, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC))) != 0)
+		return nil;
+
+	return [[_result retain] autorelease];
+}
+
+- (void)cancel
+{
+	if (OSAtomicCompareAndSwap32Barrier(kPGFuturePending, kPGFutureCancelled, &_state)) {
+		[self _completeWithResult:PGFailedResult(nil)];
+	}
+	else if (_state == kPGFutureSent) {
+		[_multiplexer _cancelFuture:self];
+	}
+}
+
+@end
+
+/** Run a block with the thread marked as on the multiplexer's queue. */
+static void PGRunOnQueue(PGConnectionMultiplexer *multiplexer, dispatch_block_t block)
+{
+	void *outer = pthread_getspecific(PGMultiplexerQueueKey);
+
+	pthread_setspecific(PGMultiplexerQueueKey, multiplexer);
+	block();
+	pthread_setspecific(PGMultiplexerQueueKey, outer);
+}
+
+#pragma mark -
+
+@implementation PGConnectionMultiplexer
+
+@synthesize connection = _connection;
+
++ (void)initialize
+{
+	if (self == [PGConnectionMultiplexer class])
+		pthread_key_create(&PGMultiplexerQueueKey, NULL);
+}
+
+- (id)initWithConnection:(PGConnection *)conn
+{
+	if (self = [super init]) {
+		_connection = [conn retain];
+		_pending = [[NSMutableArray alloc] init];
+		_queue = dispatch_queue_create("PGConnectionMultiplexer", DISPATCH_QUEUE_SERIAL);
+
+		PQsetnonblocking(_connection.conn, 1);
+
+		// The sources don't retain self; -close cancels them before self goes away
+		__block PGConnectionMultiplexer *blockSelf = self;
+
+		_readSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, PQsocket(_connection.conn), 0, _queue);
+		dispatch_source_set_event_handler(_readSource, ^{
+			PGRunOnQueue(blockSelf, ^{ [blockSelf _readResults]; });
+		});
+
+		_writeSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_WRITE, PQsocket(_connection.conn), 0, _queue);
+		dispatch_source_set_event_handler(_writeSource, ^{
+			PGRunOnQueue(blockSelf, ^{ [blockSelf _flush]; });
+		});
+		_writeSourceSuspended = YES;	// until PQflush() leaves data unsent
+
+		dispatch_resume(_readSource);
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self close];
+	dispatch_release(_queue);
+	[_pending release];
+	[_connection release];
+	[super dealloc];
+}
+
+#pragma mark Submission
+
+- (PGQueryFuture *)submitQuery:(NSString *)query values:(NSArray *)values
+{
+	return [self submitQuery:query values:values completionQueue:NULL completion:nil];
+}
+
+- (PGQueryFuture *)submitQuery:(NSString *)query values:(NSArray *)values completionQueue:(dispatch_queue_t)queue completion:(PGQueryCompletion)completion
+{
+	PGQueryFuture *future = [[PGQueryFuture alloc] _initWithQuery:query values:values completionQueue:queue completion:completion];
+
+	// Push onto the stack unless -close has capped it; checking the head in the same
+	// compare-and-swap means no submission can land after -close takes the stack.
+	// The +1 reference belongs to the stack until the queue takes it.
+	PGQueryFuture *head;
+	do {
+		head = _submissions;
+		if (head == kPGSubmissionsClosed) {
+			[future cancel];
+			return [future autorelease];
+		}
+		future->_next = head;
+	} while (!OSAtomicCompareAndSwapPtrBarrier(head, future, (void * volatile *)&_submissions));
+
+	if (OSAtomicCompareAndSwap32Barrier(0, 1, &_pumpScheduled)) {
+		[self _performOnQueue:^{
+			[self _pump];
+		}];
+	}
+
+	return [[future retain] autorelease];
+}
+
+- (PGResult *)executeQuery:(NSString *)query values:(NSArray *)values
+{
+	return [[self submitQuery:query values:values] result];
+}
+
+/** Run a block on _queue, marked as on it. The block holds the multiplexer until it returns,
+ *  so a last release there happens where -close can tell it is on the queue.
+ */
+- (void)_performOnQueue:(dispatch_block_t)block
+{
+	__block PGConnectionMultiplexer *blockSelf = [self retain];
+	__block dispatch_block_t work = [block copy];
+
+	dispatch_async(_queue, ^{
+		PGRunOnQueue(blockSelf, ^{
+			work();
+			[work release];
+			[blockSelf release];
+		});
+	});
+}
+
+- (BOOL)_isClosed
+{
+	return _submissions == kPGSubmissionsClosed;
+}
+
+/** Take every submission from the stack and append them to _pending in the order submitted. */
+- (void)_takeSubmissions
+{
+	PGQueryFuture *list;
+
+	do {
+		list = _submissions;
+		if (list == kPGSubmissionsClosed) return;	// -close took them
+	} while (list && !OSAtomicCompareAndSwapPtrBarrier(list, nil, (void * volatile *)&_submissions));
+
+	[self _appendSubmissions:list];
+}
+
+- (void)_appendSubmissions:(PGQueryFuture *)list
+{
+	NSUInteger insertAt = _pending.count;
+	for (PGQueryFuture *future = list, *next; future; future = next) {
+		next = future->_next;
+		future->_next = nil;
+		[_pending insertObject:future atIndex:insertAt];	// the list is newest first
+		[future release];
+	}
+}
+
+- (void)_pump
+{
+	OSAtomicCompareAndSwap32Barrier(1, 0, &_pumpScheduled);	// later submissions schedule another pump
+
+	if ([self _isClosed]) return;	// the sources may already be gone
+
+	[self _takeSubmissions];
+	[self _sendNext];
+}
+
+#pragma mark Connection
+
+- (void)_sendNext
+{
+	PGconn *conn = _connection.conn;
+
+	if ([self _isClosed]) return;
+
+	while (!_inFlight && _pending.count) {
+		PGQueryFuture *future = [[_pending[0] retain] autorelease];
+		[_pending removeObjectAtIndex:0];
+
+		if (![future _markSent:self]) continue;  // cancelled
+
+		PGQueryParameters *params = nil;
+		int nParams = 0;
+		unsigned int *types = NULL;
+		const char **valrefs = NULL;
+		int *lengths = NULL;
+		int *formats = NULL;
+
+		if (future.values.count) {
+			params = [PGQueryParameters queryParametersWithValues:future.values];
+			nParams = (int)[params getNumberOfTypes:&types values:&valrefs lengths:&lengths formats:&formats];
+		}
+
+		if (nParams < 0 || !PQsendQueryParams(conn, future.query.UTF8String, nParams, types, valrefs, lengths, formats, 1)) {
+			[future _completeWithResult:PGFailedResult(_connection)];
+			continue;
+		}
+
+		_inFlight = [future retain];
+		[self _flush];
+	}
+}
+
+- (void)_flush
+{
+	int status = PQflush(_connection.conn);
+
+	if (status == 1 && _writeSourceSuspended) {
+		dispatch_resume(_writeSource);
+		_writeSourceSuspended = NO;
+	}
+	else if (status != 1 && !_writeSourceSuspended) {
+		dispatch_suspend(_writeSource);
+		_writeSourceSuspended = YES;
+	}
+
+	if (status < 0)
+		[self _failAll];
+}
+
+- (void)_readResults
+{
+	PGconn *conn = _connection.conn;
+	PGnotify *notify;
+
+	if (!PQconsumeInput(conn)) {
+		// The connection is lost; stop reading and fail everything, including later submissions
+		dispatch_source_cancel(_readSource);
+		[self _failAll];
+		return;
+	}
+
+	while ((notify = PQnotifies(conn)))
+		PQfreemem(notify);
+
+	while (_inFlight && !PQisBusy(conn)) {
+		PGresult *result = PQgetResult(conn);
+
+		if (result) {
+			// a query string may hold several statements; keep the last result
+			if (_lastResult) PQclear(_lastResult);
+			_lastResult = result;
+			continue;
+		}
+
+		PGQueryFuture *future = _inFlight;
+		PGResult *complete = _lastResult ? [_connection _resultWithResult:_lastResult] : PGFailedResult(_connection);
+
+		_inFlight = nil;
+		_lastResult = NULL;
+		[future _completeWithResult:complete];
+		[future release];
+
+		[self _takeSubmissions];
+		[self _sendNext];
+	}
+}
+
+- (void)_failAll
+{
+	[self _takeSubmissions];
+
+	if (_lastResult) PQclear(_lastResult);
+	_lastResult = NULL;
+
+	if (_inFlight) {
+		[_inFlight _completeWithResult:PGFailedResult(_connection)];
+		[_inFlight release];
+		_inFlight = nil;
+	}
+
+	for (PGQueryFuture *future in _pending) {
+		if ([future _markSent:self])
+			[future _completeWithResult:PGFailedResult(_connection)];
+	}
+	[_pending removeAllObjects];
+}
+
+- (void)_cancelFuture:(PGQueryFuture *)future
+{
+	[self _performOnQueue:^{
+		if (_inFlight == future)
+			[_connection cancel];
+	}];
+}
+
+- (void)close
+{
+	PGQueryFuture *list;
+
+	// Cap the stack with the closed marker, taking what was submitted before it
+	do {
+		list = _submissions;
+		if (list == kPGSubmissionsClosed) return;
+	} while (!OSAtomicCompareAndSwapPtrBarrier(list, kPGSubmissionsClosed, (void * volatile *)&_submissions));
+
+	__block PGQueryFuture *inFlight = nil;
+
+	// The last release may come from a block on _queue, where the query in progress can't
+	// be waited for, so it's cancelled instead.
+	BOOL onQueue = (pthread_getspecific(PGMultiplexerQueueKey) == self);
+
+	if (onQueue) {
+		[self _appendSubmissions:list];
+		if (_inFlight) [_connection cancel];
+		[self _failAll];
+	}
+	else {
+		dispatch_sync(_queue, ^{
+			[self _appendSubmissions:list];
+			for (PGQueryFuture *future in _pending) {
+				if ([future _markSent:self])
+					[future _completeWithResult:PGFailedResult(nil)];
+			}
+			[_pending removeAllObjects];
+			inFlight = [_inFlight retain];
+		});
+		[inFlight result];
+		[inFlight release];
+	}
+
+	dispatch_source_cancel(_readSource);
+	if (_writeSourceSuspended) dispatch_resume(_writeSource);
+	dispatch_source_cancel(_writeSource);
+	if (!onQueue)
+		dispatch_sync(_queue, ^{});
+	dispatch_release(_readSource);
+	dispatch_release(_writeSource);
+
+	PQsetnonblocking(_connection.conn, 0);
+}
+
+@end
@@ -8,11 +8,96 @@
 
 #import <Cocoa/Cocoa.h>
 
+@class PGResult;
+@class PGError;
 
+/** Packs a five-character SQLSTATE into an integer, six bits per character, as the
+ *  server's MAKE_SQLSTATE() does.
+ */
+#define PG_SQLSTATE_CHAR(ch) (((ch) - '0') & 0x3F)
+#define PG_MAKE_SQLSTATE(ch1, ch2, ch3, ch4, ch5) \
+	(PG_SQLSTATE_CHAR(ch1) + (PG_SQLSTATE_CHAR(ch2) << 6) + (PG_SQLSTATE_CHAR(ch3) << 12) + \
+	 (PG_SQLSTATE_CHAR(ch4) << 18) + (PG_SQLSTATE_CHAR(ch5) << 24))
+
+/** The SQLSTATE class is the first two characters of the code. */
+#define PG_SQLSTATE_CLASS(code) ((code) & ((1 << 12) - 1))
+
+/** Commonly handled SQLSTATE codes. Any other code can be compared using PG_MAKE_SQLSTATE(). */
+typedef enum {
+	kPGSQLStateNone                        = -1,	///< the error has no SQLSTATE, e.g., one detected by libpq
+	kPGSQLStateSuccessfulCompletion        = PG_MAKE_SQLSTATE('0','0','0','0','0'),
+	kPGSQLStateWarning                     = PG_MAKE_SQLSTATE('0','1','0','0','0'),
+	kPGSQLStateConnectionException         = PG_MAKE_SQLSTATE('0','8','0','0','0'),
+	kPGSQLStateConnectionDoesNotExist      = PG_MAKE_SQLSTATE('0','8','0','0','3'),
+	kPGSQLStateConnectionFailure           = PG_MAKE_SQLSTATE('0','8','0','0','6'),
+	kPGSQLStateStringDataRightTruncation   = PG_MAKE_SQLSTATE('2','2','0','0','1'),
+	kPGSQLStateNumericValueOutOfRange      = PG_MAKE_SQLSTATE('2','2','0','0','3'),
+	kPGSQLStateDivisionByZero              = PG_MAKE_SQLSTATE('2','2','0','1','2'),
+	kPGSQLStateInvalidTextRepresentation   = PG_MAKE_SQLSTATE('2','2','P','0','2'),
+	kPGSQLStateIntegrityConstraintViolation = PG_MAKE_SQLSTATE('2','3','0','0','0'),
+	kPGSQLStateNotNullViolation            = PG_MAKE_SQLSTATE('2','3','5','0','2'),
+	kPGSQLStateForeignKeyViolation         = PG_MAKE_SQLSTATE('2','3','5','0','3'),
+	kPGSQLStateUniqueViolation             = PG_MAKE_SQLSTATE('2','3','5','0','5'),
+	kPGSQLStateCheckViolation              = PG_MAKE_SQLSTATE('2','3','5','1','4'),
+	kPGSQLStateExclusionViolation          = PG_MAKE_SQLSTATE('2','3','P','0','1'),
+	kPGSQLStateInFailedSQLTransaction      = PG_MAKE_SQLSTATE('2','5','P','0','2'),
+	kPGSQLStateInvalidPassword             = PG_MAKE_SQLSTATE('2','8','P','0','1'),
+	kPGSQLStateSerializationFailure        = PG_MAKE_SQLSTATE('4','0','0','0','1'),
+	kPGSQLStateDeadlockDetected            = PG_MAKE_SQLSTATE('4','0','P','0','1'),
+	kPGSQLStateSyntaxError                 = PG_MAKE_SQLSTATE('4','2','6','0','1'),
+	kPGSQLStateInsufficientPrivilege       = PG_MAKE_SQLSTATE('4','2','5','0','1'),
+	kPGSQLStateUndefinedColumn             = PG_MAKE_SQLSTATE('4','2','7','0','3'),
+	kPGSQLStateUndefinedTable              = PG_MAKE_SQLSTATE('4','2','P','0','1'),
+	kPGSQLStateDuplicateObject             = PG_MAKE_SQLSTATE('4','2','7','1','0'),
+	kPGSQLStateTooManyConnections          = PG_MAKE_SQLSTATE('5','3','3','0','0'),
+	kPGSQLStateQueryCanceled               = PG_MAKE_SQLSTATE('5','7','0','1','4'),
+	kPGSQLStateAdminShutdown               = PG_MAKE_SQLSTATE('5','7','P','0','1')
+} PGSQLState;
+
+/** Invoked for each error created from a result. The level is a syslog(3) priority
+ *  derived from the server's severity.
+ */
+typedef void (^PGErrorLogHandler)(PGError *error, int level);
+
+/** An error returned by the server. The code is the SQLSTATE as a PGSQLState value, or
+ *  kPGSQLStateNone for errors without one.
+ * @discussion The diagnostic fields are read from the underlying result only when
+ *             requested, so creating an error for an expected failure, such as a unique
+ *             violation, costs little more than the result itself.
+ */
 @interface PGError : NSError 
 {
-
+	PGResult *_result;
+	NSDictionary *_info;	// userInfo, built on first use
 }
 
+@property (readonly) PGSQLState sqlState;
+@property (readonly) NSInteger resultStatus;	///< the PGExecStatusType of the result
+@property (readonly) NSString *sqlStateString;
+@property (readonly) NSString *severity;
+@property (readonly) NSString *message;
+@property (readonly) NSString *detail;
+@property (readonly) NSString *hint;
+@property (readonly) NSString *schemaName;
+@property (readonly) NSString *tableName;
+@property (readonly) NSString *columnName;
+@property (readonly) NSString *constraintName;
+
+/** YES for serialization failures and deadlocks, which may succeed when retried. */
+@property (readonly, getter=isRetryable) BOOL retryable;
+
++ (instancetype)errorWithResult:(PGResult *)result;
+
+- (id)initWithResult:(PGResult *)result;
+
+/** Set the handler invoked when an error is created. Logging is off (nil) by default. */
++ (void)setLogHandler:(PGErrorLogHandler)handler;
++ (PGErrorLogHandler)logHandler;
+
+/** A handler that writes the error's description to syslog. */
++ (PGErrorLogHandler)syslogHandler;
+
 @end
 
+/** The packed form of a five-character SQLSTATE, or kPGSQLStateNone if sqlstate is NULL or malformed. */
+PGSQLState PGSQLStateFromString(const char *sqlstate);
@@ -7,10 +7,223 @@
 //
 
 #import "PGError.h"
+#import "PGConnection.h"
+#import "PGResult.h"
+#import "PGInternal.h"
+#import <syslog.h>
 
+#pragma mark - Prototypes
+
+NSString * NSStringFromPGresultStatus(ExecStatusType status);
+int PGSyslogLevelFromSeverity(const char *severity, ExecStatusType status);
+
+static PGErrorLogHandler sLogHandler = nil;
+
+#pragma mark -
 
 @implementation PGError
 
++ (instancetype)errorWithResult:(PGResult *)result
+{
+	return [[[self alloc] initWithResult:result] autorelease];
+}
+
+- (id)initWithResult:(PGResult *)result
+{
+	char *sqlstate = PQresultErrorField(result.pgresult, PG_DIAG_SQLSTATE);
+
+	if (self = [super initWithDomain:PostgreSQLErrorDomain code:PGSQLStateFromString(sqlstate) userInfo:nil]) {
+		_result = [result retain];
+
+		if (sLogHandler) {
+			PGErrorLogHandler handler = [PGError logHandler];
+			char *severity = PQresultErrorField(_result.pgresult, PG_DIAG_SEVERITY);
+			if (handler) handler(self, PGSyslogLevelFromSeverity(severity, PQresultStatus(_result.pgresult)));
+		}
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[_result release];
+	[_info release];
+	[super dealloc];
+}
+
+#pragma mark Diagnostic Fields
+
+- (NSString *)_stringForField:(int)fieldcode
+{
+	char *value = PQresultErrorField(_result.pgresult, fieldcode);
+
+	return value ? [NSString stringWithUTF8String:value] : nil;
+}
+
+- (PGSQLState)sqlState
+{
+	return (PGSQLState)self.code;
+}
+
+- (NSInteger)resultStatus
+{
+	return PQresultStatus(_result.pgresult);
+}
+
+- (BOOL)isRetryable
+{
+	return self.code == kPGSQLStateSerializationFailure || self.code == kPGSQLStateDeadlockDetected;
+}
+
+- (NSString *)sqlStateString  { return [self _stringForField:PG_DIAG_SQLSTATE]; }
+- (NSString *)severity        { return [self _stringForField:PG_DIAG_SEVERITY]; }
+- (NSString *)message         { return _result._errorMessage ?: [self _stringForField:PG_DIAG_MESSAGE_PRIMARY]; }
+- (NSString *)detail          { return [self _stringForField:PG_DIAG_MESSAGE_DETAIL]; }
+- (NSString *)hint            { return [self _stringForField:PG_DIAG_MESSAGE_HINT]; }
+- (NSString *)schemaName      { return [self _stringForField:PG_DIAG_SCHEMA_NAME]; }
+- (NSString *)tableName       { return [self _stringForField:PG_DIAG_TABLE_NAME]; }
+- (NSString *)columnName      { return [self _stringForField:PG_DIAG_COLUMN_NAME]; }
+- (NSString *)constraintName  { return [self _stringForField:PG_DIAG_CONSTRAINT_NAME]; }
+
+#pragma mark NSError
+
+- (NSString *)localizedDescription
+{
+	NSString *message = self.message;
+
+	return message ? message : NSStringFromPGresultStatus(PQresultStatus(_result.pgresult));
+}
+
+- (NSString *)localizedFailureReason
+{
+	char *sqlstate = PQresultErrorField(_result.pgresult, PG_DIAG_SQLSTATE);
+	char *detail   = PQresultErrorField(_result.pgresult, PG_DIAG_MESSAGE_DETAIL);
+
+	if (sqlstate && detail)
+		return [NSString stringWithFormat:@"[SQLSTATE: %s] %s", sqlstate, detail];
+
+	return nil;
+}
+
+- (NSString *)localizedRecoverySuggestion
+{
+	return self.hint;
+}
+
+- (NSDictionary *)userInfo
+{
+	@synchronized(self) {
+		if (!_info) {
+			NSMutableDictionary *info = [NSMutableDictionary dictionaryWithCapacity:4];
+
+			[info setValue:self.localizedDescription forKey:NSLocalizedDescriptionKey];
+			[info setValue:self.localizedFailureReason forKey:NSLocalizedFailureReasonErrorKey];
+			[info setValue:self.localizedRecoverySuggestion forKey:NSLocalizedRecoverySuggestionErrorKey];
+			[info setValue:self.sqlStateString forKey:PGErrorSQLStateKey];
+
+			_info = [info copy];
+		}
+		return _info;
+	}
+}
+
+#pragma mark Logging
+
++ (void)setLogHandler:(PGErrorLogHandler)handler
+{
+	@synchronized(self) {
+		[sLogHandler release];
+		sLogHandler = [handler copy];
+	}
+}
+
++ (PGErrorLogHandler)logHandler
+{
+	@synchronized(self) {
+		return [[sLogHandler retain] autorelease];
+	}
+}
+
++ (PGErrorLogHandler)syslogHandler
+{
+	return [[^(PGError *error, int level) {
+		syslog(level, "%s", error.localizedDescription.UTF8String);
+	} copy] autorelease];
+}
 
 @end
 
+PGSQLState PGSQLStateFromString(const char *sqlstate)
+{
+	if (!sqlstate || strlen(sqlstate) != 5)
+		return kPGSQLStateNone;
+
+	return PG_MAKE_SQLSTATE(sqlstate[0], sqlstate[1], sqlstate[2], sqlstate[3], sqlstate[4]);
+}
+
+int PGSyslogLevelFromSeverity(const char *severity, ExecStatusType status)
+{
+	int level;
+
+	if (!severity)
+		level = LOG_INFO;
+	else if (!strncmp(severity, "ERROR", 3))
+		level = LOG_ERR;
+	else if (!strncmp(severity, "FATAL", 3))
+		level = LOG_CRIT;
+	else if (!strncmp(severity, "PANIC", 3))
+		level = LOG_CRIT;
+	else if (!strncmp(severity, "WARNING", 3))
+		level = LOG_WARNING;
+	else if (!strncmp(severity, "NOTICE", 3))
+		level = LOG_NOTICE;
+	else if (!strncmp(severity, "DEBUG", 3))
+		level = LOG_DEBUG;
+	else if (!strncmp(severity, "INFO", 3))
+		level = LOG_INFO;
+	else if (!strncmp(severity, "LOG", 3))
+		level = LOG_DEBUG;
+	else if (status == PGRES_NONFATAL_ERROR)
+		level = LOG_WARNING;
+	else if (status == PGRES_FATAL_ERROR)
+		level = LOG_ERR;
+	else
+		level = LOG_INFO;
+
+	return level;
+}
+
+NSString * NSStringFromPGresultStatus(ExecStatusType status)
+{
+	NSString *desc;	
+	
+	switch (status) {
+		case PGRES_EMPTY_QUERY:
+			desc = @"The string sent to the server was empty.";
+			break;
+		case PGRES_COMMAND_OK:
+			desc = @"Successful completion of a command returning no data.";
+			break;
+		case PGRES_TUPLES_OK:
+			desc = @"Successful completion of a command returning data (such as a SELECT or SHOW).";
+			break;
+		case PGRES_COPY_OUT:
+			desc = @"Copy Out (from server) data transfer started.";
+			break;
+		case PGRES_COPY_IN:
+			desc = @"Copy In (to server) data transfer started.";
+			break;
+		case PGRES_BAD_RESPONSE:
+			desc = @"The server's response was not understood.";
+			break;
+		case PGRES_NONFATAL_ERROR:
+			desc = @"A nonfatal error (a notice or warning) occurred.";
+			break;
+		case PGRES_FATAL_ERROR:
+			desc = @"A fatal error occurred.";
+			break;
+		default:
+			desc = @"Unknown database error";
+	}
+	return desc;	
+}
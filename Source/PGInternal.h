@@ -60,4 +60,9 @@ id NSObjectFromPGBinaryValue(char *bytes, int length, Oid oid);
 
 NSDecimalNumber * NSDecimalNumberFromNumeric(pg_numeric_t *numeric);
 
-pg_numeric_t * NumericFromNSDecimalNumber(NSDecimalNumber *value);
\ No newline at end of file
+pg_numeric_t * NumericFromNSDecimalNumber(NSDecimalNumber *value);
+
+size_t PGresultMemorySize(const PGresult *result);
+
+/** The part of PGresultMemorySize() charged for one row. */
+size_t PGresultRowMemorySize(const PGresult *result, int row);
\ No newline at end of file
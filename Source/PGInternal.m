@@ -107,6 +107,36 @@ id NSObjectFromPGBinaryValue(char *bytes, int length, Oid oid)
 	return value;
 }
 
+size_t PGresultMemorySize(const PGresult *result)
+{
+	// Mirrors libpq's storage: a PGresAttDesc and name per field, then each row's cells.
+	int nfields = PQnfields(result);
+	int ntuples = PQntuples(result);
+	size_t size = sizeof(void *) * 8;
+
+	for (int f = 0; f < nfields; f++)
+		size += sizeof(void *) * 4 + strlen(PQfname(result, f)) + 1;
+
+	for (int t = 0; t < ntuples; t++)
+		size += PGresultRowMemorySize(result, t);
+
+	return size;
+}
+
+size_t PGresultRowMemorySize(const PGresult *result, int row)
+{
+	// The row's pointer, a PGresAttValue (length and pointer) per cell, and each non-NULL
+	// value plus its terminator. NULLs share a single empty string.
+	int nfields = PQnfields(result);
+	size_t size = sizeof(void *) + nfields * 2 * sizeof(void *);
+
+	for (int f = 0; f < nfields; f++) {
+		if (!PQgetisnull(result, row, f))
+			size += PQgetlength(result, row, f) + 1;
+	}
+	return size;
+}
+
 NSDecimalNumber * NSDecimalNumberFromNumeric(pg_numeric_t *pgval)
 {
 	NSDecimal decimal;
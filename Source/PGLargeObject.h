@@ -0,0 +1,94 @@
+//
+//  PGLargeObject.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <PGCocoa/PGConnection.h>
+
+/** Access modes for opening a large object. Same values as INV_READ and INV_WRITE. */
+typedef enum {
+	kPGLargeObjectModeRead      = 0x00040000,
+	kPGLargeObjectModeWrite     = 0x00020000,
+	kPGLargeObjectModeReadWrite = 0x00060000
+} PGLargeObjectMode;
+
+/** An open large object descriptor.
+ * @discussion Large object descriptors are only valid within a transaction, so create
+ *             or open objects within a transaction block and close them before it ends.
+ *             Data is transferred in chunks of chunkSize bytes, so streaming an object
+ *             to or from a file holds one chunk in memory rather than the whole object.
+ */
+@interface PGLargeObject : NSObject
+{
+	PGConnection *_connection;
+	unsigned int _oid;
+	int _fd;
+	NSUInteger _chunkSize;
+}
+
+@property (readonly) unsigned int oid;		///< the large object's Oid
+@property (readonly) PGConnection *connection;
+@property NSUInteger chunkSize;				///< default 256 KB
+
+/** Create a new, empty large object and open it for reading and writing.
+ * @return the opened object, or nil on error (see the connection's error)
+ */
++ (PGLargeObject *)createWithConnection:(PGConnection *)conn;
+
+/** Open an existing large object.
+ * @return the opened object, or nil on error (see the connection's error)
+ */
++ (PGLargeObject *)openWithOid:(unsigned int)oid mode:(PGLargeObjectMode)mode connection:(PGConnection *)conn;
+
+/** Delete a large object from the database. */
++ (BOOL)unlinkOid:(unsigned int)oid connection:(PGConnection *)conn;
+
+- (id)initWithOid:(unsigned int)oid mode:(PGLargeObjectMode)mode connection:(PGConnection *)conn;
+
+/** Read up to length bytes into buffer, returning the count read, 0 at end, or -1 on error. */
+- (NSInteger)read:(uint8_t *)buffer maxLength:(NSUInteger)length;
+
+/** Write length bytes, returning the count written or -1 on error. */
+- (NSInteger)write:(const uint8_t *)buffer length:(NSUInteger)length;
+
+/** Read up to length bytes; nil on error. */
+- (NSData *)readDataOfLength:(NSUInteger)length;
+- (BOOL)writeData:(NSData *)data;
+
+/** Reposition the descriptor, with whence as for lseek(2). Returns the new offset or -1. */
+- (int64_t)seekToOffset:(int64_t)offset whence:(int)whence;
+- (int64_t)offset;
+- (BOOL)truncateToLength:(int64_t)length;
+
+/** Copy the remainder of an open stream into the object, one chunk at a time. */
+- (BOOL)writeContentsOfStream:(NSInputStream *)stream;
+
+/** Copy the object from the current offset to an open stream, one chunk at a time. */
+- (BOOL)readIntoStream:(NSOutputStream *)stream;
+
+/** A stream reading from the current offset. The stream retains the object.
+ * @discussion The stream is synchronous: each read blocks on the connection, and
+ *             scheduling it in a run loop has no effect, so its delegate receives no
+ *             events. Read it in a loop, on a thread that may block.
+ */
+- (NSInputStream *)inputStream;
+
+/** A stream writing at the current offset. The stream retains the object.
+ * @discussion Like inputStream, the stream is synchronous and sends no delegate events.
+ */
+- (NSOutputStream *)outputStream;
+
+- (void)close;
+
+@end
+
+@interface PGConnection (PGLargeObject)
+
+- (PGLargeObject *)createLargeObject;
+- (PGLargeObject *)openLargeObject:(unsigned int)oid mode:(PGLargeObjectMode)mode;
+
+@end
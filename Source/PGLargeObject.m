@@ -0,0 +1,312 @@
+//
+//  PGLargeObject.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGLargeObject.h"
+#import "PGConnection.h"
+#import "PGInternal.h"
+
+#pragma mark Streams
+
+/** Synchronous streams over a large object. They can't be scheduled in a run loop. */
+@interface PGLargeObjectInputStream : NSInputStream
+{
+	PGLargeObject *_object;
+	NSStreamStatus _status;
+	id _delegate;
+}
+- (id)_initWithLargeObject:(PGLargeObject *)object;
+@end
+
+@interface PGLargeObjectOutputStream : NSOutputStream
+{
+	PGLargeObject *_object;
+	NSStreamStatus _status;
+	id _delegate;
+}
+- (id)_initWithLargeObject:(PGLargeObject *)object;
+@end
+
+#pragma mark -
+
+@implementation PGLargeObject
+
+@synthesize oid = _oid;
+@synthesize connection = _connection;
+@synthesize chunkSize = _chunkSize;
+
++ (PGLargeObject *)createWithConnection:(PGConnection *)conn
+{
+	Oid oid = lo_creat(conn.conn, kPGLargeObjectModeReadWrite);
+
+	if (oid == InvalidOid)
+		return nil;
+
+	return [[[PGLargeObject alloc] initWithOid:oid mode:kPGLargeObjectModeReadWrite connection:conn] autorelease];
+}
+
++ (PGLargeObject *)openWithOid:(unsigned int)oid mode:(PGLargeObjectMode)mode connection:(PGConnection *)conn
+{
+	return [[[PGLargeObject alloc] initWithOid:oid mode:mode connection:conn] autorelease];
+}
+
++ (BOOL)unlinkOid:(unsigned int)oid connection:(PGConnection *)conn
+{
+	return lo_unlink(conn.conn, oid) >= 0;
+}
+
+- (id)initWithOid:(unsigned int)oid mode:(PGLargeObjectMode)mode connection:(PGConnection *)conn
+{
+	if (self = [super init]) {
+		_connection = [conn retain];
+		_oid = oid;
+		_chunkSize = 256 * 1024;
+
+		if ((_fd = lo_open(_connection.conn, oid, mode)) < 0) {
+			[self release];
+			self = nil;
+		}
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self close];
+	[_connection release];
+	[super dealloc];
+}
+
+- (void)close
+{
+	if (_fd >= 0 && _connection.conn) {
+		lo_close(_connection.conn, _fd);
+	}
+	_fd = -1;
+}
+
+- (NSInteger)read:(uint8_t *)buffer maxLength:(NSUInteger)length
+{
+	return lo_read(_connection.conn, _fd, (char *)buffer, MIN(length, (NSUInteger)INT_MAX));
+}
+
+- (NSInteger)write:(const uint8_t *)buffer length:(NSUInteger)length
+{
+	NSUInteger total = 0;
+
+	// lo_write() sends one message per call, so large writes are split into chunks
+	while (total < length) {
+		int count = lo_write(_connection.conn, _fd, (const char *)buffer + total, MIN(length - total, _chunkSize));
+		if (count <= 0)
+			return -1;	// 0 would never advance
+		total += count;
+	}
+	return total;
+}
+
+- (NSData *)readDataOfLength:(NSUInteger)length
+{
+	NSMutableData *data = [NSMutableData dataWithLength:length];
+	NSUInteger total = 0;
+	NSInteger count = 0;
+
+	while (total < length && (count = [self read:(uint8_t *)data.mutableBytes + total maxLength:MIN(length - total, _chunkSize)]) > 0)
+		total += count;
+
+	if (count < 0)
+		return nil;
+
+	data.length = total;
+	return data;
+}
+
+- (BOOL)writeData:(NSData *)data
+{
+	return [self write:data.bytes length:data.length] == (NSInteger)data.length;
+}
+
+- (int64_t)seekToOffset:(int64_t)offset whence:(int)whence
+{
+	return lo_lseek64(_connection.conn, _fd, offset, whence);
+}
+
+- (int64_t)offset
+{
+	return lo_tell64(_connection.conn, _fd);
+}
+
+- (BOOL)truncateToLength:(int64_t)length
+{
+	return lo_truncate64(_connection.conn, _fd, length) == 0;
+}
+
+- (BOOL)writeContentsOfStream:(NSInputStream *)stream
+{
+	uint8_t *buffer = malloc(_chunkSize);
+	NSInteger count;
+	BOOL success = YES;
+
+	if (!buffer) return NO;
+
+	while (success && (count = [stream read:buffer maxLength:_chunkSize]) > 0)
+		success = ([self write:buffer length:count] == count);
+
+	free(buffer);
+
+	return success && count == 0;
+}
+
+- (BOOL)readIntoStream:(NSOutputStream *)stream
+{
+	uint8_t *buffer = malloc(_chunkSize);
+	NSInteger count;
+	BOOL success = YES;
+
+	if (!buffer) return NO;
+
+	while (success && (count = [self read:buffer maxLength:_chunkSize]) > 0) {
+		for (NSInteger written = 0, n; success && written < count; written += n)
+			success = ((n = [stream write:buffer + written maxLength:count - written]) > 0);
+	}
+
+	free(buffer);
+
+	return success && count == 0;
+}
+
+- (NSInputStream *)inputStream
+{
+	return [[[PGLargeObjectInputStream alloc] _initWithLargeObject:self] autorelease];
+}
+
+- (NSOutputStream *)outputStream
+{
+	return [[[PGLargeObjectOutputStream alloc] _initWithLargeObject:self] autorelease];
+}
+
+@end
+
+@implementation PGConnection (PGLargeObject)
+
+- (PGLargeObject *)createLargeObject
+{
+	return [PGLargeObject createWithConnection:self];
+}
+
+- (PGLargeObject *)openLargeObject:(unsigned int)oid mode:(PGLargeObjectMode)mode
+{
+	return [PGLargeObject openWithOid:oid mode:mode connection:self];
+}
+
+@end
+
+#pragma mark -
+
+@implementation PGLargeObjectInputStream
+
+- (id)_initWithLargeObject:(PGLargeObject *)object
+{
+	if (self = [super init]) {
+		_object = [object retain];
+		_status = NSStreamStatusNotOpen;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[_object release];
+	[super dealloc];
+}
+
+- (void)open   { _status = NSStreamStatusOpen; }
+- (void)close  { _status = NSStreamStatusClosed; }
+
+- (NSStreamStatus)streamStatus  { return _status; }
+- (NSError *)streamError        { return _status == NSStreamStatusError ? _object.connection.error : nil; }
+- (id)delegate                  { return _delegate; }
+- (void)setDelegate:(id)delegate { _delegate = delegate; }
+- (id)propertyForKey:(NSString *)key { return nil; }
+- (BOOL)setProperty:(id)property forKey:(NSString *)key { return NO; }
+// synchronous; see -[PGLargeObject inputStream]
+- (void)scheduleInRunLoop:(NSRunLoop *)runLoop forMode:(NSString *)mode { }
+- (void)removeFromRunLoop:(NSRunLoop *)runLoop forMode:(NSString *)mode { }
+
+- (NSInteger)read:(uint8_t *)buffer maxLength:(NSUInteger)length
+{
+	if (_status != NSStreamStatusOpen)
+		return (_status == NSStreamStatusAtEnd) ? 0 : -1;
+
+	NSInteger count = [_object read:buffer maxLength:MIN(length, _object.chunkSize)];
+	if (count < 0)
+		_status = NSStreamStatusError;
+	else if (count == 0)
+		_status = NSStreamStatusAtEnd;
+
+	return count;
+}
+
+- (BOOL)getBuffer:(uint8_t **)buffer length:(NSUInteger *)length
+{
+	return NO;
+}
+
+- (BOOL)hasBytesAvailable
+{
+	return _status == NSStreamStatusOpen;
+}
+
+@end
+
+@implementation PGLargeObjectOutputStream
+
+- (id)_initWithLargeObject:(PGLargeObject *)object
+{
+	if (self = [super init]) {
+		_object = [object retain];
+		_status = NSStreamStatusNotOpen;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[_object release];
+	[super dealloc];
+}
+
+- (void)open   { _status = NSStreamStatusOpen; }
+- (void)close  { _status = NSStreamStatusClosed; }
+
+- (NSStreamStatus)streamStatus  { return _status; }
+- (NSError *)streamError        { return _status == NSStreamStatusError ? _object.connection.error : nil; }
+- (id)delegate                  { return _delegate; }
+- (void)setDelegate:(id)delegate { _delegate = delegate; }
+- (id)propertyForKey:(NSString *)key { return nil; }
+- (BOOL)setProperty:(id)property forKey:(NSString *)key { return NO; }
+// synchronous; see -[PGLargeObject inputStream]
+- (void)scheduleInRunLoop:(NSRunLoop *)runLoop forMode:(NSString *)mode { }
+- (void)removeFromRunLoop:(NSRunLoop *)runLoop forMode:(NSString *)mode { }
+
+- (NSInteger)write:(const uint8_t *)buffer maxLength:(NSUInteger)length
+{
+	if (_status != NSStreamStatusOpen)
+		return -1;
+
+	NSInteger count = [_object write:buffer length:length];
+	if (count < 0)
+		_status = NSStreamStatusError;
+
+	return count;
+}
+
+- (BOOL)hasSpaceAvailable
+{
+	return _status == NSStreamStatusOpen;
+}
+
+@end
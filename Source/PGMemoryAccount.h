@@ -0,0 +1,29 @@
+//
+//  PGMemoryAccount.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/** A thread-safe tally of the bytes held by live result objects.
+ * @discussion Each PGConnection charges its results to its own account. Setting the
+ *             parent of several connections' accounts to a shared account (e.g., one per
+ *             pool) aggregates their totals. Changes propagate to the parent as they
+ *             occur, so the parent must be assigned before results are created.
+ */
+@interface PGMemoryAccount : NSObject
+{
+	volatile int64_t _bytes;
+	PGMemoryAccount *_parent;
+}
+
+@property (readonly) int64_t bytes;
+@property (retain) PGMemoryAccount *parent;
+
+/** Add (or, if negative, subtract) bytes to this account and its ancestors. */
+- (void)addBytes:(int64_t)delta;
+
+@end
@@ -0,0 +1,33 @@
+//
+//  PGMemoryAccount.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGMemoryAccount.h"
+#import <libkern/OSAtomic.h>
+
+@implementation PGMemoryAccount
+
+@synthesize parent = _parent;
+
+- (int64_t)bytes
+{
+	return OSAtomicAdd64Barrier(0, &_bytes);
+}
+
+- (void)addBytes:(int64_t)delta
+{
+	for (PGMemoryAccount *account = self; account; account = account->_parent)
+		OSAtomicAdd64Barrier(delta, &account->_bytes);
+}
+
+- (void)dealloc
+{
+	[_parent release];
+	[super dealloc];
+}
+
+@end
@@ -0,0 +1,70 @@
+//
+//  PGParallelScan.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class PGRow;
+
+/** Receives the rows of a parallel scan, with the index of the connection that read them. */
+typedef void (^PGScanRowHandler)(PGRow *row, NSUInteger worker, BOOL *stop);
+
+/** Reads one table over several connections that share a snapshot.
+ * @discussion The first connection begins a REPEATABLE READ transaction and exports its
+ *             snapshot with pg_export_snapshot(); the others import it with SET TRANSACTION
+ *             SNAPSHOT, so every connection sees the same rows no matter what commits
+ *             during the scan. The table is divided into one disjoint range per connection,
+ *             each read concurrently on its own thread.
+ *
+ *             With a keyColumn, the ranges divide the integer key's span, which an index on
+ *             the key makes efficient. Otherwise, they divide the table's pages by ctid,
+ *             which requires a TID range scan (PostgreSQL 14); on older servers the table is
+ *             read by one connection.
+ */
+@interface PGParallelScan : NSObject
+{
+	NSDictionary *_params;
+	NSString *_table;
+	NSString *_columns;
+	NSString *_condition;
+	NSString *_keyColumn;
+	NSUInteger _numberOfConnections;
+}
+
+@property (readonly) NSString *table;
+
+/** The select list. Defaults to "*". */
+@property (copy) NSString *columns;
+
+/** An optional filter, ANDed with each connection's range. */
+@property (copy) NSString *condition;
+
+/** An integer column by which to divide the table, or nil to divide it by ctid. */
+@property (copy) NSString *keyColumn;
+
+/** The number of connections, including the one that exports the snapshot. Defaults to 4. */
+@property NSUInteger numberOfConnections;
+
+/** Initialize for a table.
+ * @param params the connection parameters for every connection
+ * @param table the table name, used as written, so it may be schema-qualified
+ */
+- (id)initWithParameters:(NSDictionary *)params table:(NSString *)table;
+
+/** Scan the table, calling the handler concurrently from each connection's thread.
+ * @param error on failure, the first error from any connection
+ * @return NO if a connection fails. Stopping the handler ends every connection's scan and
+ *         returns YES.
+ */
+- (BOOL)scanWithHandler:(PGScanRowHandler)handler error:(NSError **)error;
+
+/** Scan the table, calling the handler with one row at a time, in no particular order,
+ *  while the connections continue to read concurrently.
+ */
+- (BOOL)scanSeriallyWithHandler:(PGScanRowHandler)handler error:(NSError **)error;
+
+@end
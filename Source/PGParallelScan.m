@@ -0,0 +1,280 @@
+//
+//  PGParallelScan.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGParallelScan.h"
+#import "PGConnection.h"
+#import "PGResult.h"
+#import "PGRow.h"
+#import "PGError.h"
+#import "PGInternal.h"
+#import <libkern/OSAtomic.h>
+
+enum {
+	kPGScanRunning = 0,
+	kPGScanStopped,		// by the handler
+	kPGScanFailed
+};
+
+/** Join range conditions on an expression: the first range has no lower bound and the
+ *  last no upper bound, so together they cover every row.
+ */
+static NSArray *PGRangeConditions(NSString *expression, NSArray *bounds)
+{
+	NSMutableArray *conditions = [NSMutableArray arrayWithCapacity:bounds.count + 1];
+
+	for (NSUInteger i = 0; i <= bounds.count; i++) {
+		NSMutableArray *terms = [NSMutableArray arrayWithCapacity:2];
+
+		if (i > 0)            [terms addObject:[NSString stringWithFormat:@"%@ >= %@", expression, bounds[i - 1]]];
+		if (i < bounds.count) [terms addObject:[NSString stringWithFormat:@"%@ < %@", expression, bounds[i]]];
+
+		[conditions addObject:terms.count ? [terms componentsJoinedByString:@" AND "] : @"TRUE"];
+	}
+	return conditions;
+}
+
+@implementation PGParallelScan
+
+@synthesize table = _table;
+@synthesize columns = _columns;
+@synthesize condition = _condition;
+@synthesize keyColumn = _keyColumn;
+@synthesize numberOfConnections = _numberOfConnections;
+
+- (id)initWithParameters:(NSDictionary *)params table:(NSString *)table
+{
+	if (self = [super init]) {
+		_params = [params copy];
+		_table = [table copy];
+		_columns = @"*";
+		_numberOfConnections = 4;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[_params release];
+	[_table release];
+	[_columns release];
+	[_condition release];
+	[_keyColumn release];
+	[super dealloc];
+}
+
+#pragma mark Ranges
+
+/** Divide the table into at most count conditions, one per connection. */
+- (NSArray *)_rangesWithConnection:(PGConnection *)conn count:(NSUInteger)count error:(NSError **)error
+{
+	NSMutableArray *bounds = [NSMutableArray array];
+	PGResult *result;
+
+	if (self.keyColumn) {
+		const char *name = self.keyColumn.UTF8String;
+		char *identifier = PQescapeIdentifier(conn.conn, name, strlen(name));
+		if (!identifier) {
+			*error = conn.error;
+			return nil;
+		}
+		NSString *key = [NSString stringWithUTF8String:identifier];
+		PQfreemem(identifier);
+
+		result = [conn executeQuery:[NSString stringWithFormat:@"SELECT min(%@)::int8, max(%@)::int8 FROM %@", key, key, _table]];
+		if (result.status != kPGResultTuplesOK) {
+			*error = result.error;
+			return nil;
+		}
+		if (result[0][0] == NSNull.null)
+			return @[ @"TRUE" ];	// no rows, or only rows without a key
+
+		// In unsigned arithmetic, since the span of extreme keys overflows int64_t
+		int64_t low = [result[0][0] longLongValue], high = [result[0][1] longLongValue];
+		uint64_t span = (uint64_t)high - (uint64_t)low;
+		uint64_t step = span / count + 1;
+
+		for (NSUInteger i = 1; i < count && step * i <= span; i++)
+			[bounds addObject:[NSString stringWithFormat:@"%lld", (long long)((uint64_t)low + step * i)]];
+
+		// No range condition holds for a NULL key, so the first range takes those rows
+		NSMutableArray *conditions = [[PGRangeConditions(key, bounds) mutableCopy] autorelease];
+		conditions[0] = [NSString stringWithFormat:@"%@ OR %@ IS NULL", conditions[0], key];
+
+		return conditions;
+	}
+
+	if (conn.serverVersion < 140000)
+		return @[ @"TRUE" ];
+
+	result = [conn executeQuery:@"SELECT pg_relation_size($1::regclass) / current_setting('block_size')::int8" values:@[ _table ]];
+	if (result.status != kPGResultTuplesOK) {
+		*error = result.error;
+		return nil;
+	}
+
+	// Pages added after the snapshot hold no visible rows; the last range is open anyway
+	uint64_t pages = [result[0][0] unsignedLongLongValue];
+	uint64_t step = pages / count + (pages % count ? 1 : 0);
+
+	for (NSUInteger i = 1; i < count && step * i < pages; i++)
+		[bounds addObject:[NSString stringWithFormat:@"'(%llu,0)'::tid", step * i]];
+
+	return PGRangeConditions(@"ctid", bounds);
+}
+
+- (NSString *)_queryForRange:(NSString *)range
+{
+	NSMutableString *query = [NSMutableString stringWithFormat:@"SELECT %@ FROM %@ WHERE (%@)", self.columns, _table, range];
+
+	if (self.condition)
+		[query appendFormat:@" AND (%@)", self.condition];
+
+	return query;
+}
+
+#pragma mark Scanning
+
+- (BOOL)scanWithHandler:(PGScanRowHandler)handler error:(NSError **)error
+{
+	return [self _scanWithHandler:handler serially:NO error:error];
+}
+
+- (BOOL)scanSeriallyWithHandler:(PGScanRowHandler)handler error:(NSError **)error
+{
+	return [self _scanWithHandler:handler serially:YES error:error];
+}
+
+- (BOOL)_scanWithHandler:(PGScanRowHandler)handler serially:(BOOL)serially error:(NSError **)outError
+{
+	NSUInteger count = MAX(self.numberOfConnections, 1);
+	NSMutableArray *connections = [NSMutableArray arrayWithCapacity:count];
+	NSError *error = nil;
+	BOOL success = NO;
+
+	for (NSUInteger i = 0; i < count; i++) {
+		PGConnection *conn = [[[PGConnection alloc] initWithParameters:_params] autorelease];
+
+		if (![conn connect]) {
+			error = conn.error;
+			goto done;
+		}
+		[connections addObject:conn];
+	}
+
+	// The exporting transaction stays open until every connection has finished, since a
+	// snapshot can only be imported while the transaction that exported it is in progress.
+	success = [connections[0] performTransactionWithIsolation:kPGIsolationLevelRepeatableRead options:kPGTransactionOptionReadOnly
+														block:^BOOL(PGConnection *conn, NSError **blockError) {
+		PGResult *result = [conn executeQuery:@"SELECT pg_export_snapshot()"];
+		if (result.status != kPGResultTuplesOK) {
+			*blockError = result.error;
+			return NO;
+		}
+
+		NSArray *ranges = [self _rangesWithConnection:conn count:count error:blockError];
+		if (!ranges)
+			return NO;
+
+		return [self _scanRanges:ranges connections:connections snapshot:result[0][0] handler:handler serially:serially error:blockError];
+	} error:&error];
+
+done:
+	for (PGConnection *conn in connections)
+		[conn disconnect];
+
+	if (!success && outError) *outError = error;
+	return success;
+}
+
+/** Read each range on its own connection, the first on the calling thread. */
+- (BOOL)_scanRanges:(NSArray *)ranges connections:(NSArray *)connections snapshot:(NSString *)snapshot
+			handler:(PGScanRowHandler)handler serially:(BOOL)serially error:(NSError **)outError
+{
+	__block volatile int32_t state = kPGScanRunning;
+	__block NSError *firstError = nil;
+	NSLock *handlerLock = serially ? [[[NSLock alloc] init] autorelease] : nil;
+	NSString *import = [NSString stringWithFormat:@"SET TRANSACTION SNAPSHOT '%@'", snapshot];
+	dispatch_group_t group = dispatch_group_create();
+
+	void (^fail)(NSError *) = ^(NSError *error) {
+		@synchronized(connections) {
+			if (!firstError) firstError = [error retain];
+		}
+		OSAtomicCompareAndSwap32Barrier(kPGScanRunning, kPGScanFailed, &state);
+	};
+
+	BOOL (^read)(PGConnection *, NSUInteger, NSError **) = ^BOOL(PGConnection *conn, NSUInteger worker, NSError **error) {
+		PGResult *result = [conn executeQuery:[self _queryForRange:ranges[worker]] values:nil rowHandler:^(PGRow *row, BOOL *stop) {
+			BOOL stopScan = NO;
+
+			if (state != kPGScanRunning) {
+				*stop = YES;
+				return;
+			}
+
+			if (handlerLock) {
+				[handlerLock lock];
+				if (state == kPGScanRunning) handler(row, worker, &stopScan);
+				[handlerLock unlock];
+			}
+			else {
+				handler(row, worker, &stopScan);
+			}
+
+			if (stopScan) {
+				OSAtomicCompareAndSwap32Barrier(kPGScanRunning, kPGScanStopped, &state);
+				*stop = YES;
+			}
+		}];
+
+		// A query ended because another connection stopped or failed is not an error
+		if (result.status != kPGResultTuplesOK && state == kPGScanRunning) {
+			*error = result.error;
+			return NO;
+		}
+		return YES;
+	};
+
+	for (NSUInteger worker = 1; worker < ranges.count; worker++) {
+		PGConnection *conn = connections[worker];
+		dispatch_queue_t queue = dispatch_queue_create("PGParallelScan", DISPATCH_QUEUE_SERIAL);
+
+		dispatch_group_async(group, queue, ^{
+			@autoreleasepool {
+				NSError *error = nil;
+				BOOL success = [conn performTransactionWithIsolation:kPGIsolationLevelRepeatableRead options:kPGTransactionOptionReadOnly
+															   block:^BOOL(PGConnection *conn, NSError **blockError) {
+					PGResult *result = [conn executeQuery:import];
+					if (result.status != kPGResultCommandOK) {
+						*blockError = result.error;
+						return NO;
+					}
+					return read(conn, worker, blockError);
+				} error:&error];
+
+				if (!success) fail(error);
+			}
+		});
+		dispatch_release(queue);
+	}
+
+	if (ranges.count) {
+		NSError *error = nil;
+		if (!read(connections[0], 0, &error)) fail(error);
+	}
+
+	dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+	dispatch_release(group);
+
+	if (firstError && outError) *outError = [firstError autorelease];
+	else [firstError release];
+
+	return firstError == nil;
+}
+
+@end
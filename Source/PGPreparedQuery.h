@@ -11,6 +11,7 @@
 
 @class PGConnection;
 @class PGResult;
+@class PGResultDescriptor;
 
 @interface PGPreparedQuery : NSObject 
 {
@@ -20,9 +21,21 @@
 	
 //	NSMutableArray *_params;
 	BOOL _allocated;			// indicator for status of the prepared query
-	
+
+	// From PQdescribePrepared(), so executions do no metadata work
+	int _numberOfParams;
+	unsigned int *_paramTypes;		// Same type as Oid
+	void *_encoders;				// a PGParameterEncoder per parameter
+	PGQueryParameters *_parameters;	// rebound by each execution
+	PGResultDescriptor *_resultDescriptor;
 }
 
+/** The number of parameters the server found in the statement. */
+@property (readonly) NSUInteger numberOfParameters;
+
+/** The names of the fields the statement returns; empty for a command. */
+@property (readonly) NSArray *fieldNames;
+
 /** Convenience creator using initWithName:query:types:connection:.
  @param name the name of prepared query
  @param sql the SQL statement
@@ -59,7 +72,13 @@
  */
 - (id)initWithName:(NSString *)name query:(NSString *)query types:(PGQueryParameterType *)types count:(NSUInteger)numTypes connection:(PGConnection *)conn;
 
+/** The type the server resolved for a parameter, whether given or inferred. */
+- (PGQueryParameterType)typeOfParameterAtIndex:(NSUInteger)index;
+
 /** Execute the prepared query with the given values.
+ * @discussion Values are encoded for the parameter types the server resolved, so, e.g.,
+ *             an NSNumber is sent as an int8 to a bigint parameter. A value that can't be
+ *             encoded exactly is sent as text for the server to convert.
  * @param values the values to bind to be bound to query parameters
  * @return A result object is always returned.
  */
@@ -11,6 +11,8 @@
 #import "PGConnection.h"
 #import "PGResult.h"
 #import "PGInternal.h"
+#import "PGResultDescriptor.h"
+#import "PGWorkloadRecorder.h"
 #import <syslog.h>
 
 #pragma mark - Prototypes
@@ -59,6 +61,10 @@
 {
 	if (_allocated) [self deallocate];
 	
+	free(_paramTypes);
+	free(_encoders);
+	[_parameters release];
+	[_resultDescriptor release];
 	[_name release];
 	[_query release];
 	[_connection release];
@@ -73,8 +79,12 @@
 		_name = name ? [name copy] : @"";
 
 		PGresult *result = PQprepare(_connection.conn, _name.UTF8String, _query.UTF8String, numParams, paramTypes);
-		if (PQresultStatus(result) == PGRES_COMMAND_OK) {
+		ExecStatusType status = PQresultStatus(result);
+		PQclear(result);
+
+		if (status == PGRES_COMMAND_OK) {
 			_allocated = YES;
+			[self _describe];
 		}
 		else {
 			[self dealloc];
@@ -84,6 +94,50 @@
 	return self;
 }
 
+- (void)_describe
+{
+	PGresult *result = PQdescribePrepared(_connection.conn, _name.UTF8String);
+
+	if (PQresultStatus(result) == PGRES_COMMAND_OK) {
+		_numberOfParams = PQnparams(result);
+		_paramTypes = calloc(_numberOfParams, sizeof(Oid));
+		_encoders = calloc(_numberOfParams, sizeof(PGParameterEncoder));
+
+		for (int i = 0; i < _numberOfParams; i++) {
+			_paramTypes[i] = PQparamtype(result, i);
+			((PGParameterEncoder *)_encoders)[i] = PGParameterEncoderForType(_paramTypes[i]);
+		}
+
+		// results are requested in binary; the description reports text
+		_resultDescriptor = [[PGResultDescriptor alloc] initWithResult:result format:1];
+	}
+	else {
+		// Not fatal: values are bound by class and results describe themselves
+		syslog(LOG_ERR, "DESCRIBE %s: %s", _name.UTF8String, PQresultErrorMessage(result));
+	}
+	PQclear(result);
+
+	_parameters = [[PGQueryParameters alloc] initWithValues:nil];
+}
+
+- (NSUInteger)numberOfParameters
+{
+	return _numberOfParams;
+}
+
+- (PGQueryParameterType)typeOfParameterAtIndex:(NSUInteger)index
+{
+	if (index >= _numberOfParams)
+		[NSException raise:NSRangeException format:@"parameter index %lu beyond count %d", (unsigned long)index, _numberOfParams];
+
+	return _paramTypes[index];
+}
+
+- (NSArray *)fieldNames
+{
+	return _resultDescriptor ? _resultDescriptor.fieldNames : @[];
+}
+
 - (id)initWithName:(NSString *)name query:(NSString *)query types:(NSArray *)paramTypes connection:(PGConnection *)conn
 {
 	PGQueryParameterType *types = calloc(paramTypes.count, sizeof(PGQueryParameterType));
@@ -101,24 +155,26 @@
 - (PGResult *)executeWithValues:(NSArray *)values;
 {
 	PGresult *result;
-	PGQueryParameters *params;
-
+	PGResult *retval;
 	NSInteger nParams;
-	unsigned int *types;
-	const char **valrefs;
-	int *lengths;
-	int *formats;
-
-	if ((params = [PGQueryParameters queryParametersWithValues:values]) == nil)
-		return nil;
+	CFAbsoluteTime start = _connection.recorder ? CFAbsoluteTimeGetCurrent() : 0;
 
-	nParams = [params getNumberOfTypes:&types values:&valrefs lengths:&lengths formats:&formats];
+	nParams = [_parameters _bindValues:values types:_paramTypes encoders:_encoders count:_numberOfParams];
 	if (nParams < 0)
 		return nil;
 
-	result = PQexecPrepared(_connection.conn, _name.UTF8String, nParams, valrefs, lengths, formats, 1);
+	result = PQexecPrepared(_connection.conn, _name.UTF8String, nParams, _parameters.valueRefs, _parameters.lengths, _parameters.formats, 1);
+
+	if (start) [_connection _recordQuery:_query values:values parameters:_parameters count:nParams flags:kPGWorkloadEventPrepared start:start status:PQresultStatus(result)];
+
+	retval = [_connection _resultWithResult:result];
+	if (_resultDescriptor && retval.status == kPGResultTuplesOK)
+		[retval _setDescriptor:_resultDescriptor];
+
+	// drop references to the caller's values until the next execution
+	[_parameters.params removeAllObjects];
 
-	return [PGResult _resultWithResult:result];
+	return retval;
 }
 
 @end
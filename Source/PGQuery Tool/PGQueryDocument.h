@@ -9,7 +9,7 @@
 #import <Cocoa/Cocoa.h>
 
 @class PGConnection;
-@class PGResult;
+@class PGQueryResultModel;
 
 @interface PGQueryDocument : NSDocument 
 {
@@ -20,7 +20,8 @@
 	IBOutlet NSObjectController *ownerController;
 	
 	NSString *_query;
-	PGResult *_result;
+	PGQueryResultModel *_resultModel;
+	dispatch_queue_t _queryQueue;		// serializes use of _connection by result models
 	
 	NSString *_username;
 	NSString *_password;
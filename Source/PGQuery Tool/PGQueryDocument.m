@@ -8,6 +8,7 @@
 
 #import "PGQueryDocument.h"
 #import <PGCocoa/PGCocoa.h>
+#import "PGQueryResultModel.h"
 
 
 @implementation PGQueryDocument
@@ -57,16 +58,43 @@
 - (IBAction)executeQuery:(id)sender;
 {
 	[ownerController commitEditing];
-	
-	PGResult *result = [_connection executeQuery:_query];
-	if ([result status] == PGRES_TUPLES_OK) {
-		[_result autorelease];
-		_result = [result retain];
-		[self _rebuildTableView];
-	}
-	else {
-		[NSApp presentError:[result error]];
-	}
+
+	if (!_queryQueue)
+		_queryQueue = dispatch_queue_create("PGQueryDocument.query", DISPATCH_QUEUE_SERIAL);
+
+	// Re-running cancels the previous query's fetch and closes its cursor.
+	[_resultModel close];
+	[_resultModel release];
+
+	_resultModel = [[PGQueryResultModel alloc] initWithConnection:_connection query:_query queue:_queryQueue pageSize:200];
+
+	// Not retained by the handler, which the model owns; closing the model removes it.
+	__block PGQueryDocument *document = self;
+	__block PGQueryResultModel *model = _resultModel;
+
+	[_resultModel setChangeHandler:^{
+		if (model.error) {
+			[NSApp presentError:model.error];
+			return;
+		}
+		[document _rebuildTableView];
+		[document _updateVisibleRange:nil];
+	}];
+
+	[[tableView enclosingScrollView].contentView setPostsBoundsChangedNotifications:YES];
+	[[NSNotificationCenter defaultCenter] removeObserver:self name:NSViewBoundsDidChangeNotification object:nil];
+	[[NSNotificationCenter defaultCenter] addObserver:self
+											 selector:@selector(_updateVisibleRange:)
+												 name:NSViewBoundsDidChangeNotification
+											   object:[tableView enclosingScrollView].contentView];
+
+	[self _rebuildTableView];
+	[_resultModel start];
+}
+
+- (void)_updateVisibleRange:(NSNotification *)note
+{
+	[_resultModel setVisibleRange:[tableView rowsInRect:[tableView visibleRect]]];
 }
 
 - (void)connectPanelDidEnd:(NSPanel *)panel returnCode:(int)code context:(void *)ctx
@@ -105,16 +133,22 @@
 
 - (void)_rebuildTableView;
 {
-	NSArray *headers = [_result fieldNames];
+	NSArray *headers = [_resultModel fieldNames];
+
+	if ([headers isEqual:[[tableView tableColumns] valueForKey:@"identifier"]]) {
+		[tableView noteNumberOfRowsChanged];
+		[tableView reloadData];
+		return;
+	}
 
 	// remove extra columns
 	NSArray *oldColumns = [tableView tableColumns];
-	for (int i = [headers count]; i < [oldColumns count]; i++)
+	for (int i = [oldColumns count] - 1; i >= (int)[headers count]; i--)
 		[tableView removeTableColumn:[oldColumns objectAtIndex:i]];
 
 	NSTableColumn *col;
 	
-	for (int i = 0; i < [_result numberOfFields]; i++) {
+	for (int i = 0; i < [headers count]; i++) {
 		if (i < [oldColumns count]) {
 			col = [oldColumns objectAtIndex:i];
 			[col setIdentifier:[headers objectAtIndex:i]];
@@ -133,27 +167,31 @@
 
 - (NSInteger)numberOfRowsInTableView:(NSTableView *)tv
 {
-	return _result ? [_result numberOfRows] : 0;
+	return _resultModel ? [_resultModel numberOfRows] : 0;
 }
 
 - (id)tableView:(NSTableView *)tv objectValueForTableColumn:(NSTableColumn *)tc row:(int)rowIndex
 {
     id value = nil;
 	
-    NSParameterAssert(rowIndex >= 0 && rowIndex < [_result numberOfRows]);
+    NSParameterAssert(rowIndex >= 0 && rowIndex < [_resultModel numberOfRows]);
 	
-    NSInteger fieldNum = [[_result fieldNames] indexOfObject:[tc identifier]];
+    NSUInteger fieldNum = [_resultModel columnIndexForIdentifier:[tc identifier]];
 	
 	if (fieldNum == NSNotFound)
 		value = nil;
 	else
-		value = [_result valueAtRowIndex:rowIndex fieldIndex:fieldNum];
+		value = [_resultModel valueAtRow:rowIndex column:fieldNum];
 
     return value;
 }
 
 - (void)dealloc
 {
+	[[NSNotificationCenter defaultCenter] removeObserver:self];
+	[_resultModel close];
+	[_resultModel release];
+	if (_queryQueue) dispatch_release(_queryQueue);
 	[_connection release];
 	[super dealloc];
 }
@@ -0,0 +1,105 @@
+//
+//  PGQueryResultModel.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class PGConnection;
+@class PGResult;
+
+/** A read-only view of a query's rows that fetches pages on demand through a server-side
+ *  cursor.
+ * @discussion The query is run in a read-only transaction as a scrollable cursor. Pages
+ *             of pageSize rows are fetched on a serial queue shared with other users of
+ *             the connection. The pages around the visible range are fetched first. At most
+ *             maxCachedPages decoded pages are kept, evicting the least recently used
+ *             pages outside the visible range. Between page fetches, the rows are counted
+ *             by moving through the cursor a chunk at a time, so a requested page waits
+ *             for at most one chunk. The model has no AppKit dependencies.
+ *
+ *             Statements other than SELECT, VALUES, TABLE and WITH, and queries that can't
+ *             be declared as a read-only cursor (e.g., SELECT ... FOR UPDATE), are executed
+ *             once outside a transaction, and their whole result is kept.
+ *
+ *             The public methods may be called from any thread. changeHandler is invoked
+ *             on callbackQueue (the main queue by default) whenever rows, the row count,
+ *             the field names or the error change.
+ */
+@interface PGQueryResultModel : NSObject
+{
+	PGConnection *_connection;
+	NSString *_query;
+	NSString *_cursorName;
+	dispatch_queue_t _fetchQueue;
+	dispatch_queue_t _callbackQueue;
+	void (^_changeHandler)(void);
+
+	NSUInteger _pageSize;
+	NSUInteger _maxCachedPages;
+
+	NSArray *_fieldNames;
+	NSDictionary *_columnIndexes;	// field name -> NSNumber index, first occurrence wins
+	NSUInteger _numberOfRows;
+	BOOL _rowCountKnown;
+	NSError *_error;
+	PGResult *_result;				// the complete result of a statement run without a cursor
+	NSUInteger _countedRows;		// rows counted by moving through the cursor
+
+	NSMutableDictionary *_pages;	// NSNumber page -> NSArray of rows, each an NSArray of values
+	NSMutableArray *_pageOrder;		// cached page numbers, least recently used first
+	NSMutableIndexSet *_requestedPages;
+	NSInteger _inflightPage;		// page being fetched, or -1
+	NSRange _visibleRange;
+
+	BOOL _fetching;
+	BOOL _cursorOpen;
+	BOOL _closed;
+}
+
+@property (readonly) NSString *query;
+@property (readonly) NSArray *fieldNames;
+@property (readonly) NSUInteger numberOfFields;
+
+/** The number of rows fetched so far until the total is known, then the total. */
+@property (readonly) NSUInteger numberOfRows;
+@property (readonly, getter=isRowCountKnown) BOOL rowCountKnown;
+@property (readonly) NSError *error;
+
+@property NSUInteger maxCachedPages;		///< default 50
+@property (readonly) NSUInteger pageSize;
+@property (copy) void (^changeHandler)(void);
+@property (assign) dispatch_queue_t callbackQueue;
+
+/** The designated initializer.
+ * @param conn a connection that is only used on queue
+ * @param queue the serial queue on which all commands for the connection are performed
+ * @param pageSize the number of rows per FETCH
+ */
+- (id)initWithConnection:(PGConnection *)conn query:(NSString *)query queue:(dispatch_queue_t)queue pageSize:(NSUInteger)pageSize;
+
+/** Open the cursor and fetch the first page. */
+- (void)start;
+
+/** Cancel any fetch in progress and close the cursor. The model returns no further rows
+ *  and invokes no further callbacks.
+ */
+- (void)close;
+
+/** The visible rows. Pages covering them and one page to either side are fetched, and a
+ *  fetch in progress for a page outside that window is cancelled.
+ */
+- (void)setVisibleRange:(NSRange)range;
+
+/** The value at a row and field, or nil if its page has not been fetched yet, in which
+ *  case the page is requested.
+ */
+- (id)valueAtRow:(NSUInteger)row column:(NSUInteger)column;
+
+/** The index of the first field named identifier, or NSNotFound. */
+- (NSUInteger)columnIndexForIdentifier:(id)identifier;
+
+@end
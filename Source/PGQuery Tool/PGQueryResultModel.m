@@ -0,0 +1,527 @@
+//
+//  PGQueryResultModel.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGQueryResultModel.h"
+#import <PGCocoa/PGCocoa.h>
+#import <libkern/OSAtomic.h>
+
+static NSInteger const kPGNoPage = -1;
+static NSInteger const kPGCountPage = -2;	// counting the rows, which is not cancelled by scrolling
+static NSUInteger const kPGCountChunkSize = 10000;
+
+@implementation PGQueryResultModel
+
+@synthesize query = _query;
+@synthesize pageSize = _pageSize;
+
+- (id)initWithConnection:(PGConnection *)conn query:(NSString *)query queue:(dispatch_queue_t)queue pageSize:(NSUInteger)pageSize
+{
+	if (self = [super init]) {
+		static int32_t sCursorCount = 0;
+
+		_connection = [conn retain];
+		_query = [query copy];
+		_cursorName = [[NSString alloc] initWithFormat:@"pgquery_cursor_%d", OSAtomicIncrement32(&sCursorCount)];
+		_fetchQueue = queue;
+		dispatch_retain(_fetchQueue);
+		_callbackQueue = dispatch_get_main_queue();
+		_pageSize = pageSize ? pageSize : 200;
+		_maxCachedPages = 50;
+
+		_pages = [[NSMutableDictionary alloc] init];
+		_pageOrder = [[NSMutableArray alloc] init];
+		_requestedPages = [[NSMutableIndexSet alloc] init];
+		_inflightPage = kPGNoPage;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[_connection release];
+	[_query release];
+	[_cursorName release];
+	dispatch_release(_fetchQueue);
+	[_changeHandler release];
+	[_fieldNames release];
+	[_columnIndexes release];
+	[_error release];
+	[_result release];
+	[_pages release];
+	[_pageOrder release];
+	[_requestedPages release];
+	[super dealloc];
+}
+
+#pragma mark Properties
+
+- (NSArray *)fieldNames
+{
+	@synchronized(self) {
+		return [[_fieldNames retain] autorelease];
+	}
+}
+
+- (NSUInteger)numberOfFields
+{
+	return self.fieldNames.count;
+}
+
+- (NSUInteger)numberOfRows
+{
+	@synchronized(self) {
+		return _numberOfRows;
+	}
+}
+
+- (BOOL)isRowCountKnown
+{
+	@synchronized(self) {
+		return _rowCountKnown;
+	}
+}
+
+- (NSError *)error
+{
+	@synchronized(self) {
+		return [[_error retain] autorelease];
+	}
+}
+
+- (NSUInteger)maxCachedPages
+{
+	@synchronized(self) {
+		return _maxCachedPages;
+	}
+}
+
+- (void)setMaxCachedPages:(NSUInteger)count
+{
+	@synchronized(self) {
+		_maxCachedPages = MAX(count, 1);
+	}
+}
+
+- (void (^)(void))changeHandler
+{
+	@synchronized(self) {
+		return [[_changeHandler retain] autorelease];
+	}
+}
+
+- (void)setChangeHandler:(void (^)(void))handler
+{
+	@synchronized(self) {
+		[_changeHandler release];
+		_changeHandler = [handler copy];
+	}
+}
+
+- (dispatch_queue_t)callbackQueue
+{
+	@synchronized(self) {
+		return _callbackQueue;
+	}
+}
+
+- (void)setCallbackQueue:(dispatch_queue_t)queue
+{
+	@synchronized(self) {
+		_callbackQueue = queue;
+	}
+}
+
+#pragma mark Access
+
+- (NSUInteger)columnIndexForIdentifier:(id)identifier
+{
+	NSNumber *index;
+
+	@synchronized(self) {
+		index = _columnIndexes[identifier];
+	}
+	return index ? index.unsignedIntegerValue : NSNotFound;
+}
+
+- (id)valueAtRow:(NSUInteger)row column:(NSUInteger)column
+{
+	NSNumber *page = @(row / _pageSize);
+	NSArray *rows;
+
+	@synchronized(self) {
+		if (_closed) return nil;
+
+		if (_result) {
+			if (row >= _result.numberOfRows || column >= _result.numberOfFields)
+				return nil;
+			return [_result valueAtRowIndex:row fieldIndex:column];
+		}
+
+		if ((rows = _pages[page]) != nil) {
+			if (![_pageOrder.lastObject isEqual:page]) {
+				[_pageOrder removeObject:page];
+				[_pageOrder addObject:page];
+			}
+		}
+		else if (_inflightPage != page.integerValue) {
+			[_requestedPages addIndex:page.unsignedIntegerValue];
+		}
+	}
+
+	if (!rows) {
+		[self _scheduleFetch];
+		return nil;
+	}
+
+	NSUInteger offset = row % _pageSize;
+	if (offset >= rows.count || column >= [rows[offset] count])
+		return nil;
+
+	return rows[offset][column];
+}
+
+- (void)setVisibleRange:(NSRange)range
+{
+	BOOL cancel = NO;
+
+	@synchronized(self) {
+		if (_closed) return;
+
+		_visibleRange = range;
+
+		// Prefetch a page on either side and forget requests that scrolled out of view.
+		NSIndexSet *wanted = [self _wantedPages];
+		[_requestedPages removeAllIndexes];
+		[wanted enumerateIndexesUsingBlock:^(NSUInteger page, BOOL *stop) {
+			if (!_result && !_pages[@(page)] && _inflightPage != (NSInteger)page)
+				[_requestedPages addIndex:page];
+		}];
+
+		cancel = (_inflightPage >= 0 && ![wanted containsIndex:_inflightPage]);
+	}
+
+	if (cancel)
+		[_connection cancel];
+
+	[self _scheduleFetch];
+}
+
+- (void)start
+{
+	@synchronized(self) {
+		[_requestedPages addIndex:0];
+	}
+	[self _scheduleFetch];
+}
+
+- (void)close
+{
+	BOOL cancel;
+
+	@synchronized(self) {
+		if (_closed) return;
+
+		_closed = YES;
+		cancel = (_inflightPage != kPGNoPage);
+		[_changeHandler release];
+		_changeHandler = nil;
+		[_requestedPages removeAllIndexes];
+		[_pages removeAllObjects];
+		[_pageOrder removeAllObjects];
+	}
+
+	if (cancel)
+		[_connection cancel];
+
+	dispatch_async(_fetchQueue, ^{
+		if (_cursorOpen) {
+			[_connection rollbackTransaction];
+			_cursorOpen = NO;
+		}
+	});
+}
+
+#pragma mark Fetching (on the fetch queue)
+
+/** Pages covering the visible range and one page to either side. Call with the lock held. */
+- (NSIndexSet *)_wantedPages
+{
+	NSUInteger first = _visibleRange.location / _pageSize;
+	NSUInteger last = (NSMaxRange(_visibleRange) + _pageSize - 1) / _pageSize;
+
+	if (first > 0) first--;
+	last++;
+	if (_rowCountKnown)
+		last = MIN(last, (_numberOfRows + _pageSize - 1) / _pageSize);
+
+	return [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(first, last > first ? last - first : 1)];
+}
+
+- (void)_scheduleFetch
+{
+	@synchronized(self) {
+		if (_fetching || _closed || _error || (_requestedPages.count == 0 && (_rowCountKnown || !_pages.count)))
+			return;
+		_fetching = YES;
+	}
+
+	[self retain];
+	dispatch_async(_fetchQueue, ^{
+		@autoreleasepool {
+			[self _fetchLoop];
+		}
+		[self release];
+	});
+}
+
+- (void)_notify
+{
+	// The handler is looked up when the callback runs, so none is invoked after -close.
+	[self retain];
+	dispatch_async(self.callbackQueue, ^{
+		void (^handler)(void) = self.changeHandler;
+		if (handler) handler();
+		[self release];
+	});
+}
+
+/** Whether a statement can be declared as a cursor, judged by its first keyword. */
+static BOOL PGStatementReturnsRows(NSString *query)
+{
+	NSScanner *scanner = [NSScanner scannerWithString:query];
+	NSString *keyword = nil;
+
+	[scanner scanCharactersFromSet:[NSCharacterSet letterCharacterSet] intoString:&keyword];
+	keyword = keyword.uppercaseString;
+
+	return [keyword isEqualToString:@"SELECT"] || [keyword isEqualToString:@"VALUES"] ||
+		   [keyword isEqualToString:@"TABLE"] || [keyword isEqualToString:@"WITH"];
+}
+
+- (BOOL)_openCursor
+{
+	NSCharacterSet *trim = [NSCharacterSet characterSetWithCharactersInString:@"; \t\r\n"];
+	NSString *query = [_query stringByTrimmingCharactersInSet:trim];
+	NSString *sql;
+	PGResult *result = nil;
+
+	// A cancelled fetch leaves the transaction aborted and the cursor unusable.
+	if (_connection.transactionStatus != kPGTransactionIdle)
+		[_connection rollbackTransaction];
+
+	if (PGStatementReturnsRows(query)) {
+		sql = [NSString stringWithFormat:@"BEGIN READ ONLY; DECLARE %@ SCROLL CURSOR FOR %@", _cursorName, query];
+
+		result = [[_connection executeBatch:sql] lastObject];
+		_cursorOpen = (result.status == kPGResultCommandOK);
+		if (_cursorOpen)
+			return YES;
+
+		[_connection rollbackTransaction];
+	}
+
+	// Run anything else once, as typed; a failed DECLARE didn't run the query.
+	if (!_result) {
+		result = [_connection executeQuery:query];
+		if (result.status == kPGResultTuplesOK || result.status == kPGResultCommandOK)
+			[self _setResult:result];
+	}
+
+	@synchronized(self) {
+		if (!_result) {
+			[_error release];
+			_error = [result.error retain];
+		}
+		[_requestedPages removeAllIndexes];
+	}
+	[self _notify];
+
+	return NO;
+}
+
+- (void)_setResult:(PGResult *)result
+{
+	NSArray *fieldNames = result.fieldNames;
+	NSUInteger fieldCount = fieldNames.count;
+	NSMutableDictionary *indexes = [NSMutableDictionary dictionaryWithCapacity:fieldCount];
+
+	for (NSUInteger f = fieldCount; f > 0; f--)
+		indexes[fieldNames[f - 1]] = @(f - 1);
+
+	@synchronized(self) {
+		_result = [result retain];
+		_fieldNames = [fieldNames copy];
+		_columnIndexes = [indexes copy];
+		_numberOfRows = result.numberOfRows;
+		_rowCountKnown = YES;
+	}
+}
+
+- (NSInteger)_nextPage
+{
+	@synchronized(self) {
+		if (_closed)
+			return kPGNoPage;
+
+		if (_requestedPages.count) {
+			// prefer a visible page
+			NSIndexSet *wanted = [self _wantedPages];
+			NSUInteger page = [_requestedPages indexPassingTest:^BOOL(NSUInteger idx, BOOL *stop) {
+				return [wanted containsIndex:idx];
+			}];
+			if (page == NSNotFound)
+				page = _requestedPages.firstIndex;
+
+			[_requestedPages removeIndex:page];
+			_inflightPage = page;
+		}
+		else if (!_rowCountKnown && !_error && _pages.count) {
+			// -_fetchLoop reopens the cursor if a cancelled fetch closed it
+			_inflightPage = kPGCountPage;
+		}
+		else {
+			_fetching = NO;
+		}
+		return _inflightPage;
+	}
+}
+
+- (void)_fetchLoop
+{
+	NSInteger page;
+
+	while ((page = [self _nextPage]) != kPGNoPage) {
+		@autoreleasepool {
+			if (!_cursorOpen && ![self _openCursor]) {
+				@synchronized(self) {
+					_inflightPage = kPGNoPage;
+				}
+				continue;
+			}
+
+			if (page == kPGCountPage)
+				[self _countRows];
+			else
+				[self _fetchPage:page];
+		}
+	}
+}
+
+- (void)_countRows
+{
+	// One chunk at a time, so requested pages are fetched between chunks.
+	NSString *sql = [NSString stringWithFormat:@"MOVE ABSOLUTE %lu IN %@; MOVE FORWARD %lu IN %@",
+					 (unsigned long)_countedRows, _cursorName, (unsigned long)kPGCountChunkSize, _cursorName];
+	PGResult *result = [[_connection executeBatch:sql] lastObject];
+
+	@synchronized(self) {
+		_inflightPage = kPGNoPage;
+
+		if (result.status == kPGResultCommandOK) {
+			NSUInteger moved = result.numberOfAffectedRows;
+
+			_countedRows += moved;
+			_numberOfRows = MAX(_numberOfRows, _countedRows);
+			if (moved < kPGCountChunkSize) {
+				_numberOfRows = _countedRows;
+				_rowCountKnown = YES;
+			}
+		}
+		else {
+			_cursorOpen = NO;
+
+			// a cancelled count resumes on a reopened cursor; any other failure is reported
+			if (result.error.code != kPGSQLStateQueryCanceled) {
+				[_error release];
+				_error = [result.error retain];
+				[_requestedPages removeAllIndexes];
+			}
+		}
+	}
+	[self _notify];
+}
+
+- (void)_fetchPage:(NSInteger)page
+{
+	NSString *sql = [NSString stringWithFormat:@"MOVE ABSOLUTE %lu IN %@; FETCH FORWARD %lu FROM %@",
+					 (unsigned long)(page * _pageSize), _cursorName, (unsigned long)_pageSize, _cursorName];
+	PGResult *result = [[_connection executeBatch:sql] lastObject];
+
+	if (result.status != kPGResultTuplesOK) {
+		@synchronized(self) {
+			_inflightPage = kPGNoPage;
+			_cursorOpen = NO;
+
+			if (result.error.code == kPGSQLStateQueryCanceled) {
+				// scrolled away; fetch it again later if it is wanted
+				if (!_closed && [[self _wantedPages] containsIndex:page])
+					[_requestedPages addIndex:page];
+			}
+			else {
+				[_error release];
+				_error = [result.error retain];
+				[_requestedPages removeAllIndexes];
+			}
+		}
+		[self _notify];
+		return;
+	}
+
+	// Decode the page once; the table view asks for each visible cell on every redraw.
+	NSUInteger rowCount = result.numberOfRows, fieldCount = result.numberOfFields;
+	NSMutableArray *rows = [NSMutableArray arrayWithCapacity:rowCount];
+
+	for (NSUInteger r = 0; r < rowCount; r++) {
+		NSMutableArray *values = [NSMutableArray arrayWithCapacity:fieldCount];
+		for (NSUInteger f = 0; f < fieldCount; f++)
+			[values addObject:[result valueAtRowIndex:r fieldIndex:f]];
+		[rows addObject:values];
+	}
+
+	@synchronized(self) {
+		_inflightPage = kPGNoPage;
+		if (_closed) return;
+
+		if (!_fieldNames) {
+			_fieldNames = [result.fieldNames copy];
+
+			NSMutableDictionary *indexes = [NSMutableDictionary dictionaryWithCapacity:fieldCount];
+			for (NSUInteger f = fieldCount; f > 0; f--)
+				indexes[_fieldNames[f - 1]] = @(f - 1);
+			_columnIndexes = [indexes copy];
+		}
+
+		_pages[@(page)] = rows;
+		[_pageOrder removeObject:@(page)];
+		[_pageOrder addObject:@(page)];
+
+		NSUInteger end = page * _pageSize + rowCount;
+		if (!_rowCountKnown) {
+			_numberOfRows = MAX(_numberOfRows, end);
+			if (rowCount < _pageSize) {
+				_numberOfRows = end;
+				_rowCountKnown = YES;
+			}
+		}
+
+		// Evict the least recently used pages, keeping those in view.
+		NSIndexSet *wanted = [self _wantedPages];
+		for (NSUInteger i = 0; _pages.count > _maxCachedPages && i < _pageOrder.count; ) {
+			NSNumber *candidate = _pageOrder[i];
+			if ([wanted containsIndex:candidate.unsignedIntegerValue]) {
+				i++;
+				continue;
+			}
+			[_pages removeObjectForKey:candidate];
+			[_pageOrder removeObjectAtIndex:i];
+		}
+	}
+	[self _notify];
+}
+
+@end
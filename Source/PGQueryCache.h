@@ -0,0 +1,89 @@
+//
+//  PGQueryCache.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class PGConnection;
+@class PGResult;
+
+/** A thread-safe cache of query results, shared by any number of connections.
+ * @discussion Entries are keyed by the SQL text and the exact bytes of the bound parameters,
+ *             and are evicted least-recently-used first when the total memorySize of the
+ *             cached results exceeds maxBytes. Each entry may be tagged, typically with the
+ *             names of the tables it reads, and invalidated by tag. A dedicated connection
+ *             can be given to the cache to LISTEN on a channel; each notification invalidates
+ *             the tag named by its payload, or by the channel if the payload is empty.
+ *             If the listener's connection is lost, every entry is removed, since
+ *             notifications may have been missed, and the connection is reopened. If it
+ *             can't be, nothing more is cached until listening is started again.
+ *
+ *             Only results of read-only statements should be cached. Cached results are
+ *             shared, so they must be treated as immutable.
+ */
+@interface PGQueryCache : NSObject
+{
+	NSMutableDictionary *_entries;		// key -> entry
+	NSMutableDictionary *_tags;			// tag -> NSMutableSet of keys
+	NSMutableDictionary *_generations;	// tag -> NSNumber, incremented by each invalidation
+	NSUInteger _generation;				// incremented by removeAllResults
+	id _head, _tail;					// most and least recently used entries
+	NSUInteger _totalBytes;
+	NSUInteger _maxBytes;
+	NSTimeInterval _timeToLive;
+	NSUInteger _hits, _misses;
+
+	PGConnection *_listener;
+	NSString *_channel;
+	dispatch_queue_t _listenerQueue;
+	dispatch_source_t _listenerSource;
+	BOOL _listenerFailed;
+}
+
+/** The limit on the total memorySize of cached results. */
+@property NSUInteger maxBytes;
+
+/** The time after which an entry is no longer returned; 0 means entries do not expire. */
+@property NSTimeInterval timeToLive;
+
+@property (readonly) NSUInteger totalBytes;
+@property (readonly) NSUInteger count;
+@property (readonly) NSUInteger hits;
+@property (readonly) NSUInteger misses;
+
+- (id)initWithMaxBytes:(NSUInteger)maxBytes timeToLive:(NSTimeInterval)ttl;
+
+/** Return the unexpired result for a key, or nil. */
+- (PGResult *)resultForKey:(NSData *)key;
+
+/** Cache a result under a key with optional tags, replacing any existing entry. */
+- (void)setResult:(PGResult *)result forKey:(NSData *)key tags:(NSArray *)tags;
+
+/** A value that changes whenever any of the tags is invalidated or all results are removed.
+ * @discussion Take it before executing a query, and pass it to
+ *             setResult:forKey:tags:generation: so a result read before an invalidation
+ *             that arrived while the query ran is not cached.
+ */
+- (NSUInteger)generationForTags:(NSArray *)tags;
+
+/** Cache a result unless its tags have been invalidated since generation was taken. */
+- (void)setResult:(PGResult *)result forKey:(NSData *)key tags:(NSArray *)tags generation:(NSUInteger)generation;
+
+- (void)invalidateTag:(NSString *)tag;
+- (void)removeAllResults;
+
+/** Take ownership of a connected, otherwise unused connection, LISTEN on channel, and
+ *  invalidate tags as notifications arrive. A cache has at most one listener.
+ * @return NO if LISTEN failed.
+ */
+- (BOOL)startListeningWithConnection:(PGConnection *)conn channel:(NSString *)channel;
+- (void)stopListening;
+
+/** Build the key for a query and its encoded parameter values. */
++ (NSData *)keyForQuery:(NSString *)query encodedValues:(NSData *)encodedValues;
+
+@end
@@ -0,0 +1,366 @@
+//
+//  PGQueryCache.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGQueryCache.h"
+#import "PGConnection.h"
+#import "PGResult.h"
+#import "PGInternal.h"
+
+@interface PGQueryCacheEntry : NSObject
+{
+@public
+	NSData *key;
+	PGResult *result;
+	NSArray *tags;
+	NSUInteger size;
+	CFAbsoluteTime expiration;
+	PGQueryCacheEntry *prev;	// not retained; the dictionary owns entries
+	PGQueryCacheEntry *next;
+}
+@end
+
+@implementation PGQueryCacheEntry
+
+- (void)dealloc
+{
+	[key release];
+	[result release];
+	[tags release];
+	[super dealloc];
+}
+
+@end
+
+#pragma mark -
+
+@implementation PGQueryCache
+
+@synthesize timeToLive = _timeToLive;
+
+- (id)init
+{
+	return [self initWithMaxBytes:64 * 1024 * 1024 timeToLive:0];
+}
+
+- (id)initWithMaxBytes:(NSUInteger)maxBytes timeToLive:(NSTimeInterval)ttl
+{
+	if (self = [super init]) {
+		_entries = [[NSMutableDictionary alloc] init];
+		_tags = [[NSMutableDictionary alloc] init];
+		_generations = [[NSMutableDictionary alloc] init];
+		_maxBytes = maxBytes;
+		_timeToLive = ttl;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self stopListening];
+	[_entries release];
+	[_tags release];
+	[_generations release];
+	[super dealloc];
+}
+
++ (NSData *)keyForQuery:(NSString *)query encodedValues:(NSData *)encodedValues
+{
+	const char *sql = query.UTF8String;
+	NSMutableData *key = [NSMutableData dataWithCapacity:strlen(sql) + 1 + encodedValues.length];
+
+	[key appendBytes:sql length:strlen(sql) + 1];
+	if (encodedValues)
+		[key appendData:encodedValues];
+
+	return key;
+}
+
+#pragma mark LRU List (callers must hold the lock)
+
+- (void)_unlinkEntry:(PGQueryCacheEntry *)entry
+{
+	if (entry->prev) entry->prev->next = entry->next;
+	else _head = entry->next;
+
+	if (entry->next) entry->next->prev = entry->prev;
+	else _tail = entry->prev;
+
+	entry->prev = entry->next = nil;
+}
+
+- (void)_pushEntry:(PGQueryCacheEntry *)entry
+{
+	entry->prev = nil;
+	entry->next = _head;
+	if (_head) ((PGQueryCacheEntry *)_head)->prev = entry;
+	_head = entry;
+	if (!_tail) _tail = entry;
+}
+
+- (void)_removeEntry:(PGQueryCacheEntry *)entry
+{
+	[self _unlinkEntry:entry];
+	_totalBytes -= entry->size;
+
+	for (NSString *tag in entry->tags) {
+		NSMutableSet *keys = _tags[tag];
+		[keys removeObject:entry->key];
+		if (keys.count == 0) [_tags removeObjectForKey:tag];
+	}
+	[_entries removeObjectForKey:entry->key];
+}
+
+- (void)_evictToSize:(NSUInteger)size
+{
+	while (_tail && _totalBytes > size)
+		[self _removeEntry:_tail];
+}
+
+- (NSUInteger)_generationForTags:(NSArray *)tags
+{
+	// Generations only increase, so their sum changes whenever any of them does.
+	NSUInteger generation = _generation;
+
+	for (NSString *tag in tags)
+		generation += [_generations[tag] unsignedIntegerValue];
+
+	return generation;
+}
+
+#pragma mark Public
+
+- (PGResult *)resultForKey:(NSData *)key
+{
+	@synchronized(self) {
+		PGQueryCacheEntry *entry = _entries[key];
+
+		if (entry && entry->expiration && entry->expiration < CFAbsoluteTimeGetCurrent()) {
+			[self _removeEntry:entry];
+			entry = nil;
+		}
+
+		if (!entry) {
+			_misses++;
+			return nil;
+		}
+
+		_hits++;
+		if (_head != entry) {
+			[self _unlinkEntry:entry];
+			[self _pushEntry:entry];
+		}
+		return [[entry->result retain] autorelease];
+	}
+}
+
+- (NSUInteger)generationForTags:(NSArray *)tags
+{
+	@synchronized(self) {
+		return [self _generationForTags:tags];
+	}
+}
+
+- (void)setResult:(PGResult *)result forKey:(NSData *)key tags:(NSArray *)tags
+{
+	[self setResult:result forKey:key tags:tags generation:NSNotFound];
+}
+
+- (void)setResult:(PGResult *)result forKey:(NSData *)key tags:(NSArray *)tags generation:(NSUInteger)generation
+{
+	NSUInteger size = result.memorySize + key.length;
+	PGQueryCacheEntry *entry = [[PGQueryCacheEntry alloc] init];
+	entry->key = [key copy];
+	entry->result = [result retain];
+	entry->tags = [tags copy];
+	entry->size = size;
+	entry->expiration = _timeToLive > 0 ? CFAbsoluteTimeGetCurrent() + _timeToLive : 0;
+
+	@synchronized(self) {
+		if (size > _maxBytes || _listenerFailed ||
+			(generation != NSNotFound && generation != [self _generationForTags:tags])) {
+			[entry release];
+			return;
+		}
+
+		PGQueryCacheEntry *existing = _entries[entry->key];
+		if (existing)
+			[self _removeEntry:existing];
+
+		[self _evictToSize:_maxBytes - size];
+
+		_entries[entry->key] = entry;
+		[self _pushEntry:entry];
+		_totalBytes += size;
+
+		for (NSString *tag in entry->tags) {
+			NSMutableSet *keys = _tags[tag];
+			if (!keys) {
+				keys = [NSMutableSet set];
+				_tags[tag] = keys;
+			}
+			[keys addObject:entry->key];
+		}
+	}
+	[entry release];
+}
+
+- (void)invalidateTag:(NSString *)tag
+{
+	@synchronized(self) {
+		_generations[tag] = @([_generations[tag] unsignedIntegerValue] + 1);
+
+		NSArray *keys = [_tags[tag] allObjects];
+
+		for (NSData *key in keys) {
+			PGQueryCacheEntry *entry = _entries[key];
+			if (entry) [self _removeEntry:entry];
+		}
+	}
+}
+
+- (void)removeAllResults
+{
+	@synchronized(self) {
+		[_entries removeAllObjects];
+		[_tags removeAllObjects];
+		_head = _tail = nil;
+		_generation++;
+		_totalBytes = 0;
+	}
+}
+
+- (NSUInteger)maxBytes
+{
+	@synchronized(self) {
+		return _maxBytes;
+	}
+}
+
+- (void)setMaxBytes:(NSUInteger)maxBytes
+{
+	@synchronized(self) {
+		_maxBytes = maxBytes;
+		[self _evictToSize:maxBytes];
+	}
+}
+
+- (NSUInteger)totalBytes
+{
+	@synchronized(self) {
+		return _totalBytes;
+	}
+}
+
+- (NSUInteger)count
+{
+	@synchronized(self) {
+		return _entries.count;
+	}
+}
+
+- (NSUInteger)hits
+{
+	@synchronized(self) {
+		return _hits;
+	}
+}
+
+- (NSUInteger)misses
+{
+	@synchronized(self) {
+		return _misses;
+	}
+}
+
+#pragma mark Invalidation (on the listener queue)
+
+- (void)_startListenerSource
+{
+	_listenerSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, PQsocket(_listener.conn), 0, _listenerQueue);
+
+	// The source's blocks do not retain the cache; -stopListening cancels it before dealloc.
+	__block PGQueryCache *cache = self;
+	dispatch_source_set_event_handler(_listenerSource, ^{
+		[cache _processNotifications];
+	});
+	dispatch_resume(_listenerSource);
+}
+
+- (void)_listenerDidDisconnect
+{
+	// The source would fire continuously for the closed socket.
+	dispatch_source_cancel(_listenerSource);
+	dispatch_release(_listenerSource);
+	_listenerSource = NULL;
+
+	// Notifications may have been missed while disconnected.
+	BOOL reconnected = [_listener connect] && [_listener listen:_channel];
+
+	@synchronized(self) {
+		_listenerFailed = !reconnected;
+		[self removeAllResults];
+	}
+
+	if (reconnected)
+		[self _startListenerSource];
+}
+
+- (void)_processNotifications
+{
+	for (NSDictionary *notification in [_listener consumeNotifications]) {
+		NSString *payload = notification[PGNotificationPayloadKey];
+		[self invalidateTag:payload.length ? payload : notification[PGNotificationChannelKey]];
+	}
+
+	if (_listener.status != kPGConnectionOK)
+		[self _listenerDidDisconnect];
+}
+
+- (BOOL)startListeningWithConnection:(PGConnection *)conn channel:(NSString *)channel
+{
+	[self stopListening];
+
+	if ([conn listen:channel] == NO)
+		return NO;
+
+	_listener = [conn retain];
+	_channel = [channel copy];
+
+	@synchronized(self) {
+		_listenerFailed = NO;
+	}
+
+	_listenerQueue = dispatch_queue_create("PGQueryCache.listener", DISPATCH_QUEUE_SERIAL);
+	dispatch_sync(_listenerQueue, ^{
+		[self _startListenerSource];
+	});
+
+	return YES;
+}
+
+- (void)stopListening
+{
+	if (_listenerQueue) {
+		// on the listener queue, after a running handler finishes, since it may replace the source
+		dispatch_sync(_listenerQueue, ^{
+			if (_listenerSource) {
+				dispatch_source_cancel(_listenerSource);
+				dispatch_release(_listenerSource);
+				_listenerSource = NULL;
+			}
+		});
+		dispatch_release(_listenerQueue);
+		_listenerQueue = NULL;
+	}
+	[_listener release];
+	_listener = nil;
+	[_channel release];
+	_channel = nil;
+}
+
+@end
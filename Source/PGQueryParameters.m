@@ -10,6 +10,120 @@
 #import "PGQueryParameters_Private.h"
 #import "PGInternal.h"
 
+#pragma mark Encoders
+
+static BOOL PGNumberIsIntegral(id value)
+{
+	if (![value isKindOfClass:NSNumber.class]) return NO;
+
+	char type = [value objCType][0];
+	if (type != 'f' && type != 'd') return YES;
+
+	return [value doubleValue] == (double)[value longLongValue];
+}
+
+static BOOL PGEncodeBool(id value, pg_value_t *storage, const char **ref, int *length)
+{
+	if (![value isKindOfClass:NSNumber.class]) return NO;
+
+	storage->val8 = [value boolValue];
+	*length = 1;
+	return YES;
+}
+
+static BOOL PGEncodeInt16(id value, pg_value_t *storage, const char **ref, int *length)
+{
+	if (!PGNumberIsIntegral(value)) return NO;
+
+	long long n = [value longLongValue];
+	if (n < INT16_MIN || n > INT16_MAX) return NO;
+
+	storage->val16 = NSSwapHostShortToBig((int16_t)n);
+	*length = 2;
+	return YES;
+}
+
+static BOOL PGEncodeInt32(id value, pg_value_t *storage, const char **ref, int *length)
+{
+	if (!PGNumberIsIntegral(value)) return NO;
+
+	long long n = [value longLongValue];
+	if (n < INT32_MIN || n > INT32_MAX) return NO;
+
+	storage->val32 = NSSwapHostIntToBig((int32_t)n);
+	*length = 4;
+	return YES;
+}
+
+static BOOL PGEncodeInt64(id value, pg_value_t *storage, const char **ref, int *length)
+{
+	if (!PGNumberIsIntegral(value)) return NO;
+
+	storage->val64 = NSSwapHostLongLongToBig([value longLongValue]);
+	*length = 8;
+	return YES;
+}
+
+static BOOL PGEncodeFloat(id value, pg_value_t *storage, const char **ref, int *length)
+{
+	if (![value isKindOfClass:NSNumber.class] || [value isKindOfClass:NSDecimalNumber.class]) return NO;
+
+	storage->f = [value floatValue];
+	storage->val32 = NSSwapHostIntToBig(storage->val32);
+	*length = 4;
+	return YES;
+}
+
+static BOOL PGEncodeDouble(id value, pg_value_t *storage, const char **ref, int *length)
+{
+	if (![value isKindOfClass:NSNumber.class] || [value isKindOfClass:NSDecimalNumber.class]) return NO;
+
+	storage->d = [value doubleValue];
+	storage->val64 = NSSwapHostLongLongToBig(storage->val64);
+	*length = 8;
+	return YES;
+}
+
+static BOOL PGEncodeTimestamp(id value, pg_value_t *storage, const char **ref, int *length)
+{
+	if (![value isKindOfClass:NSDate.class]) return NO;
+
+	// Assumes integer_datetimes, as -_bindValue:atIndex: does
+	long double interval = [value timeIntervalSinceReferenceDate];
+	interval += 31622400.0;
+	interval *= 1000000.0;
+	storage->val64 = NSSwapHostLongLongToBig((int64_t)interval);
+	*length = 8;
+	return YES;
+}
+
+static BOOL PGEncodeBytea(id value, pg_value_t *storage, const char **ref, int *length)
+{
+	if (![value isKindOfClass:NSData.class] || [value length] > INT_MAX) return NO;
+
+	*ref = [value bytes];
+	*length = (int)[value length];
+	return YES;
+}
+
+PGParameterEncoder PGParameterEncoderForType(Oid type)
+{
+	switch (type) {
+		case kPGQryParamBool:        return PGEncodeBool;
+		case kPGQryParamData:        return PGEncodeBytea;
+		case kPGQryParamInt16:       return PGEncodeInt16;
+		case kPGQryParamInt32:       return PGEncodeInt32;
+		case kPGQryParamInt64:       return PGEncodeInt64;
+		case kPGQryParamFloat:       return PGEncodeFloat;
+		case kPGQryParamDouble:      return PGEncodeDouble;
+		case kPGQryParamTimestamp:
+		case kPGQryParamTimestampTZ: return PGEncodeTimestamp;
+		default:                     return NULL;
+	}
+}
+
+#pragma mark -
+
 @implementation PGQueryParameters
 
 
@@ -42,7 +156,7 @@
 -(id)initWithValues:(NSArray *)values
 {
 	if (self = [super init]) {
-		_params = [values mutableCopy];
+		_params = values ? [values mutableCopy] : [[NSMutableArray alloc] init];
 	}
 
 	return self;
@@ -88,7 +202,12 @@
 		_formats[i] = 1;
 	}
 	else if ([value isKindOfClass:NSData.class]) {
+		// The bytes are referenced rather than copied here, but libpq copies the whole value
+		// into its outgoing message, so even a mapped NSData is held in memory in full while
+		// it is sent. Use PGLargeObject to transfer large values one chunk at a time.
 		NSData *data = (NSData *)value;
+		if (data.length > INT_MAX)
+			[NSException raise:NSInvalidArgumentException format:@"bytea parameter exceeds the protocol limit of %d bytes", INT_MAX];
 		_types[i] = kPGQryParamData;  // bytea
 		_valueRefs[i] = data.bytes;
 		_lengths[i] = data.length;
@@ -199,6 +318,64 @@
 	return _nparams;
 }
 
+- (NSInteger)_bindValues:(NSArray *)values types:(const Oid *)types encoders:(const PGParameterEncoder *)encoders count:(NSUInteger)count
+{
+	[_params setArray:values ? values : @[]];
+
+	if ([self _allocArraysWithCapacity:_params.count] == NO)
+		return -1;
+
+	for (NSUInteger i = 0; i < _params.count; i++) {
+		id value = _params[i];
+		Oid type = (i < count) ? types[i] : 0;
+
+		if (type == 0 || value == NSNull.null) {
+			[self _bindValue:value atIndex:i];
+			continue;
+		}
+
+		_types[i] = type;
+		_valueRefs[i] = _values[i].bytes;
+
+		if (encoders[i] && encoders[i](value, &_values[i], &_valueRefs[i], &_lengths[i])) {
+			_formats[i] = 1;
+		}
+		else if ([value isKindOfClass:NSString.class] || [value isKindOfClass:NSNumber.class]) {
+			// Let the server convert the text to the parameter's type, or report why it can't
+			NSString *valString = [value description];
+			[_params replaceObjectAtIndex:i withObject:valString];
+			_valueRefs[i] = valString.UTF8String;
+			_lengths[i] = 0;  // ignored
+			_formats[i] = 0;
+		}
+		else {
+			[self _bindValue:value atIndex:i];
+		}
+	}
+
+	return _params.count;
+}
+
+- (void)_appendEncodedValuesToData:(NSMutableData *)data
+{
+	for (int i = 0; i < _nparams; i++) {
+		int32_t length;
+
+		if (_valueRefs[i] == NULL)
+			length = -1;
+		else if (_formats[i] == 0)
+			length = (int32_t)strlen(_valueRefs[i]);  // text lengths are ignored by libpq
+		else
+			length = _lengths[i];
+
+		[data appendBytes:&_types[i] length:sizeof(_types[i])];
+		[data appendBytes:&_formats[i] length:sizeof(_formats[i])];
+		[data appendBytes:&length length:sizeof(length)];
+		if (length > 0)
+			[data appendBytes:_valueRefs[i] length:length];
+	}
+}
+
 //- (void)setObject:(id)anObject atIndexedSubscript:(NSUInteger)index
 //{
 //	_params[index] = anObject;
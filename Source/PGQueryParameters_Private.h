@@ -9,6 +9,15 @@
 #import "PGQueryParameters.h"
 #import "PGInternal.h"
 
+/** Encodes a value in the binary format of one server type. Returns NO if the value
+ *  cannot be represented exactly, in which case it is sent as text for the server to
+ *  convert or reject. Most encoders write to storage; bytea references the value's bytes.
+ */
+typedef BOOL (*PGParameterEncoder)(id value, pg_value_t *storage, const char **ref, int *length);
+
+/** The binary encoder for a parameter type, or NULL if the type is sent as text. */
+PGParameterEncoder PGParameterEncoderForType(Oid type);
+
 @interface PGQueryParameters ()
 
 @property (nonatomic, readonly) NSMutableArray *params;
@@ -18,6 +27,20 @@
 @property (nonatomic, readonly) int *lengths;
 @property (nonatomic, readonly) int *formats;
 
+/** Append the bound types, formats, lengths and value bytes, which identify the values
+ *  exactly, e.g., for a cache key. Valid after getNumberOfTypes:values:lengths:formats:.
+ */
+- (void)_appendEncodedValuesToData:(NSMutableData *)data;
+
+/** Bind values for a statement whose parameter types are known, e.g., a described prepared
+ *  statement, reusing the arrays from the previous execution.
+ * @param types the server's type for each parameter; 0 where unknown
+ * @param encoders the encoder for each type, from PGParameterEncoderForType()
+ * @param count the number of elements in types and encoders
+ * @return the number of parameters bound, or -1 on error
+ */
+- (NSInteger)_bindValues:(NSArray *)values types:(const Oid *)types encoders:(const PGParameterEncoder *)encoders count:(NSUInteger)count;
+
 @end
 
 
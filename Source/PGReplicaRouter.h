@@ -0,0 +1,79 @@
+//
+//  PGReplicaRouter.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <PGCocoa/PGConnection.h>
+
+/** Routes statements between a primary server and its streaming replicas.
+ * @discussion The router holds one connection per server and detects each server's role
+ *             with pg_is_in_recovery() when connecting. Writes and read-write transactions
+ *             go to the primary. Read-only statements and transactions go to the replica
+ *             with the fewest outstanding requests, skipping replicas whose replay position
+ *             trails the primary by more than maxReplicaLagBytes. Lag is measured on a
+ *             separate monitoring connection to each server, opened when first needed, so
+ *             busy servers are measured too. A replica whose lag hasn't been measured, or
+ *             not within three check intervals, is skipped as well. If no replica is
+ *             eligible, reads go to the primary.
+ *
+ *             The router may be used from any number of threads. Each connection serves one
+ *             request at a time, so requests for a busy server wait for it.
+ */
+@interface PGReplicaRouter : NSObject
+{
+	NSArray *_nodeParams;
+	id _primary;
+	NSArray *_replicas;
+	uint64_t _maxReplicaLagBytes;
+	NSTimeInterval _lagCheckInterval;
+	CFAbsoluteTime _lastLagCheck;
+	NSLock *_lagLock;			// serializes use of the monitoring connections
+}
+
+/** The largest replay lag, in bytes of WAL, at which a replica receives reads. 0 means
+ *  lag is not checked.
+ */
+@property uint64_t maxReplicaLagBytes;
+
+/** How often replica lag is measured. Defaults to 1 second. */
+@property NSTimeInterval lagCheckInterval;
+
+@property (readonly) PGConnection *primaryConnection;
+@property (readonly) NSArray *replicaConnections;
+
+/** Initialize with the connection parameters for each server, in any order. */
+- (id)initWithNodeParameters:(NSArray *)params;
+
+/** Connect to every server and detect its role. Servers that fail to connect are skipped.
+ * @return NO if no server is a primary
+ */
+- (BOOL)connect:(NSError **)error;
+- (void)disconnect;
+
+/** Execute a statement on the primary, or on a replica if readOnly is YES. */
+- (PGResult *)executeQuery:(NSString *)query values:(NSArray *)values readOnly:(BOOL)readOnly;
+
+/** Perform a transaction block on the primary, or as a READ ONLY transaction on a replica
+ *  if the options include kPGTransactionOptionReadOnly.
+ */
+- (BOOL)performTransactionWithIsolation:(PGIsolationLevel)level options:(PGTransactionOptions)options block:(PGTransactionBlock)block error:(NSError **)error;
+
+/** Perform arbitrary work with exclusive use of a routed connection. */
+- (void)performWithConnectionReadOnly:(BOOL)readOnly block:(void (^)(PGConnection *conn))block;
+
+/** Measure each replica's lag now rather than waiting for lagCheckInterval. */
+- (void)refreshReplicaLag;
+
+/** The primary's current WAL position, measured on its monitoring connection, or 0 if the
+ *  query fails.
+ */
+- (uint64_t)_primaryLSN;
+
+@end
+
+/** Parse a WAL location such as "16/B374D848" to a byte position. */
+uint64_t PGLSNFromString(NSString *location);
@@ -0,0 +1,388 @@
+//
+//  PGReplicaRouter.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGReplicaRouter.h"
+#import "PGConnection.h"
+#import "PGResult.h"
+#import "PGRow.h"
+#import <libkern/OSAtomic.h>
+
+/** Measurements older than this many check intervals, and at least a second, are stale. */
+#define kPGLagStaleIntervals 3
+
+@interface PGReplicaNode : NSObject
+{
+@public
+	NSDictionary *params;
+	PGConnection *connection;
+	NSLock *lock;				// held while a request uses the connection
+	volatile int32_t outstanding;	// requests waiting for or holding the lock
+	PGConnection *monitor;		// measures lag; only used under the router's _lagLock
+
+	// guarded by @synchronized(router)
+	uint64_t lagBytes;
+	CFAbsoluteTime measuredAt;	// when lagBytes was measured, or 0 if never
+	BOOL available;
+}
+@end
+
+@implementation PGReplicaNode
+
+- (id)initWithConnection:(PGConnection *)conn params:(NSDictionary *)nodeParams
+{
+	if (self = [super init]) {
+		params = [nodeParams copy];
+		connection = [conn retain];
+		lock = [[NSLock alloc] init];
+		available = YES;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[monitor disconnect];
+	[monitor release];
+	[params release];
+	[connection release];
+	[lock release];
+	[super dealloc];
+}
+
+@end
+
+#pragma mark -
+
+uint64_t PGLSNFromString(NSString *location)
+{
+	unsigned int high = 0, low = 0;
+
+	if (!location || sscanf(location.UTF8String, "%X/%X", &high, &low) != 2) return 0;
+
+	return ((uint64_t)high << 32) | low;
+}
+
+static NSString *PGQueryForSingleValue(PGConnection *conn, NSString *query)
+{
+	PGResult *result = [conn executeQuery:query];
+
+	if (result.status != kPGResultTuplesOK || result.numberOfRows != 1) return nil;
+
+	id value = [result valueAtRowIndex:0 fieldIndex:0];
+	return [value isKindOfClass:[NSNull class]] ? nil : [value description];
+}
+
+/** The node's monitoring connection, opened on first use and reopened after it fails.
+ *  Call with the router's _lagLock held.
+ */
+static PGConnection *PGMonitorConnection(PGReplicaNode *node)
+{
+	if (node->monitor && node->monitor.status != kPGConnectionOK) {
+		[node->monitor disconnect];
+		[node->monitor release];
+		node->monitor = nil;
+	}
+
+	if (!node->monitor) {
+		PGConnection *conn = [[PGConnection alloc] initWithParameters:node->params];
+
+		if (![conn connect]) {
+			[conn release];
+			return nil;
+		}
+		node->monitor = conn;
+	}
+	return node->monitor;
+}
+
+@implementation PGReplicaRouter
+
+@synthesize maxReplicaLagBytes = _maxReplicaLagBytes;
+@synthesize lagCheckInterval = _lagCheckInterval;
+
+- (id)initWithNodeParameters:(NSArray *)params
+{
+	if (self = [super init]) {
+		_nodeParams = [params copy];
+		_replicas = [[NSArray alloc] init];
+		_lagCheckInterval = 1.0;
+		_lagLock = [[NSLock alloc] init];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self disconnect];
+	[_nodeParams release];
+	[_primary release];
+	[_replicas release];
+	[_lagLock release];
+	[super dealloc];
+}
+
+- (PGConnection *)primaryConnection
+{
+	return ((PGReplicaNode *)_primary)->connection;
+}
+
+- (NSArray *)replicaConnections
+{
+	NSMutableArray *connections = [NSMutableArray arrayWithCapacity:_replicas.count];
+
+	for (PGReplicaNode *node in _replicas)
+		[connections addObject:node->connection];
+
+	return connections;
+}
+
+- (BOOL)connect:(NSError **)error
+{
+	PGReplicaNode *primary = nil;
+	NSMutableArray *replicas = [NSMutableArray array];
+	NSError *lastError = nil;
+
+	for (NSDictionary *params in _nodeParams) {
+		PGConnection *conn = [[[PGConnection alloc] initWithParameters:params] autorelease];
+
+		if (![conn connect]) {
+			lastError = conn.error;
+			continue;
+		}
+
+		NSString *inRecovery = PGQueryForSingleValue(conn, @"SELECT pg_is_in_recovery()");
+		if (!inRecovery) {
+			lastError = conn.error;
+			[conn disconnect];
+			continue;
+		}
+
+		PGReplicaNode *node = [[[PGReplicaNode alloc] initWithConnection:conn params:params] autorelease];
+
+		if ([inRecovery boolValue])
+			[replicas addObject:node];
+		else if (!primary)
+			primary = node;
+		else
+			[conn disconnect];	// a second primary; never route to it
+	}
+
+	@synchronized(self) {
+		[_primary release];
+		_primary = [primary retain];
+		[_replicas release];
+		_replicas = [replicas copy];
+		_lastLagCheck = 0;
+	}
+
+	if (!primary) {
+		if (error) {
+			NSMutableDictionary *info = [NSMutableDictionary dictionaryWithObject:@"No primary server is available." forKey:NSLocalizedDescriptionKey];
+			if (lastError) [info setObject:lastError forKey:NSUnderlyingErrorKey];
+			*error = [NSError errorWithDomain:PostgreSQLErrorDomain code:-1 userInfo:info];
+		}
+		return NO;
+	}
+	return YES;
+}
+
+- (void)disconnect
+{
+	// _lagLock is always taken before the router's lock, never inside it
+	[_lagLock lock];
+	@synchronized(self) {
+		NSMutableArray *nodes = [NSMutableArray arrayWithArray:_replicas];
+		if (_primary) [nodes addObject:_primary];
+
+		for (PGReplicaNode *node in nodes) {
+			[node->lock lock];
+			[node->connection disconnect];
+			node->available = NO;
+			[node->lock unlock];
+
+			[node->monitor disconnect];
+			[node->monitor release];
+			node->monitor = nil;
+		}
+	}
+	[_lagLock unlock];
+}
+
+#pragma mark Lag
+
+// The LSN functions return pg_lsn on 10 and later, which has no binary decoder; cast them
+// to text so the location parses.
+- (NSString *)_currentLocationQuery:(PGConnection *)conn
+{
+	return (conn.serverVersion >= 100000) ? @"SELECT pg_current_wal_lsn()::text" : @"SELECT pg_current_xlog_location()::text";
+}
+
+- (NSString *)_replayLocationQuery:(PGConnection *)conn
+{
+	return (conn.serverVersion >= 100000) ? @"SELECT pg_last_wal_replay_lsn()::text" : @"SELECT pg_last_xlog_replay_location()::text";
+}
+
+/** Call with _lagLock held. */
+- (uint64_t)_measurePrimaryLSN
+{
+	PGReplicaNode *primary;
+
+	@synchronized(self) {
+		primary = [[_primary retain] autorelease];
+	}
+
+	PGConnection *monitor = primary ? PGMonitorConnection(primary) : nil;
+	if (!monitor) return 0;
+
+	return PGLSNFromString(PGQueryForSingleValue(monitor, [self _currentLocationQuery:monitor]));
+}
+
+- (uint64_t)_primaryLSN
+{
+	[_lagLock lock];
+	uint64_t lsn = [self _measurePrimaryLSN];
+	[_lagLock unlock];
+
+	return lsn;
+}
+
+// Lag is measured on each server's monitoring connection, so a server busy with a long
+// query is still measured, and routing never waits for it. The queries run without the
+// router's lock, so routing continues on the previous measurements while a slow server
+// answers. A replica that can't be measured keeps its old measurement until it is stale.
+- (void)refreshReplicaLag
+{
+	NSArray *replicas;
+
+	@synchronized(self) {
+		replicas = [[_replicas retain] autorelease];
+	}
+
+	[_lagLock lock];
+
+	uint64_t primaryLSN = [self _measurePrimaryLSN];
+
+	for (PGReplicaNode *node in replicas) {
+		if (!primaryLSN) break;
+
+		PGConnection *monitor = PGMonitorConnection(node);
+		NSString *location = monitor ? PGQueryForSingleValue(monitor, [self _replayLocationQuery:monitor]) : nil;
+		if (!location) continue;
+
+		uint64_t replayLSN = PGLSNFromString(location);
+
+		@synchronized(self) {
+			node->lagBytes = (primaryLSN > replayLSN) ? primaryLSN - replayLSN : 0;
+			node->measuredAt = CFAbsoluteTimeGetCurrent();
+		}
+	}
+
+	[_lagLock unlock];
+
+	@synchronized(self) {
+		_lastLagCheck = CFAbsoluteTimeGetCurrent();
+	}
+}
+
+#pragma mark Routing
+
+- (PGReplicaNode *)_checkOutNodeReadOnly:(BOOL)readOnly
+{
+	PGReplicaNode *chosen = nil;
+	BOOL refresh = NO;
+
+	if (readOnly && _maxReplicaLagBytes) {
+		// Claim the check, so concurrent requests route on the previous measurement
+		// rather than waiting for this one
+		@synchronized(self) {
+			CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+			if (_replicas.count && now - _lastLagCheck >= _lagCheckInterval) {
+				_lastLagCheck = now;
+				refresh = YES;
+			}
+		}
+		if (refresh) [self refreshReplicaLag];
+	}
+
+	@synchronized(self) {
+		if (readOnly) {
+			// A replica never measured, or not measured lately, may be arbitrarily far behind
+			CFAbsoluteTime staleBefore = CFAbsoluteTimeGetCurrent() - MAX(_lagCheckInterval * kPGLagStaleIntervals, 1.0);
+
+			for (PGReplicaNode *node in _replicas) {
+				if (!node->available) continue;
+				if (_maxReplicaLagBytes && (node->measuredAt == 0 || node->measuredAt < staleBefore)) continue;
+				if (_maxReplicaLagBytes && node->lagBytes > _maxReplicaLagBytes) continue;
+				if (!chosen || node->outstanding < chosen->outstanding)
+					chosen = node;
+			}
+		}
+		if (!chosen) chosen = _primary;
+
+		if (!chosen) return nil;
+
+		OSAtomicIncrement32Barrier(&chosen->outstanding);
+	}
+
+	[chosen->lock lock];
+	return chosen;
+}
+
+- (void)_checkInNode:(PGReplicaNode *)node
+{
+	if (node->connection.status != kPGConnectionOK && node != _primary) {
+		@synchronized(self) {
+			node->available = NO;
+		}
+	}
+
+	[node->lock unlock];
+	OSAtomicDecrement32Barrier(&node->outstanding);
+}
+
+- (void)performWithConnectionReadOnly:(BOOL)readOnly block:(void (^)(PGConnection *conn))block
+{
+	PGReplicaNode *node = [self _checkOutNodeReadOnly:readOnly];
+	if (!node) return;
+
+	@try {
+		block(node->connection);
+	}
+	@finally {
+		[self _checkInNode:node];
+	}
+}
+
+- (PGResult *)executeQuery:(NSString *)query values:(NSArray *)values readOnly:(BOOL)readOnly
+{
+	__block PGResult *result = nil;
+
+	[self performWithConnectionReadOnly:readOnly block:^(PGConnection *conn) {
+		result = [[conn executeQuery:query values:values] retain];
+	}];
+
+	return [result autorelease];
+}
+
+- (BOOL)performTransactionWithIsolation:(PGIsolationLevel)level options:(PGTransactionOptions)options block:(PGTransactionBlock)block error:(NSError **)error
+{
+	__block BOOL success = NO;
+	__block NSError *blockError = nil;
+
+	[self performWithConnectionReadOnly:(options & kPGTransactionOptionReadOnly) != 0 block:^(PGConnection *conn) {
+		success = [conn performTransactionWithIsolation:level options:options block:block error:&blockError];
+		[blockError retain];
+	}];
+
+	if (!success && error) *error = blockError;
+	[blockError autorelease];
+
+	return success;
+}
+
+@end
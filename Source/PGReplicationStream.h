@@ -0,0 +1,141 @@
+//
+//  PGReplicationStream.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class PGConnection;
+@class PGChange;
+
+/** The output plugin that decodes the slot's changes. */
+typedef enum {
+	kPGReplicationPluginTestDecoding = 0,	///< test_decoding, included with the server since 9.4
+	kPGReplicationPluginPgoutput			///< pgoutput, the built-in plugin since 10; needs publications
+} PGReplicationPlugin;
+
+typedef enum {
+	kPGChangeBegin = 0,
+	kPGChangeCommit,
+	kPGChangeInsert,
+	kPGChangeUpdate,
+	kPGChangeDelete,
+	kPGChangeTruncate
+} PGChangeType;
+
+/** Receives each decoded change. Setting stop ends streaming after the change. */
+typedef void (^PGChangeHandler)(PGChange *change, BOOL *stop);
+
+/** One change decoded from the replication stream. Values are in their text format. */
+@interface PGChange : NSObject
+{
+@public
+	PGChangeType _type;
+	uint64_t _lsn;
+	uint32_t _transactionID;
+	NSDate *_commitTime;
+	NSString *_schema;
+	NSString *_table;
+	NSDictionary *_values;
+	NSDictionary *_oldValues;
+}
+
+@property (readonly) PGChangeType type;
+@property (readonly) uint64_t lsn;				///< the WAL position of the change
+@property (readonly) uint32_t transactionID;	///< 0 if the plugin doesn't report it
+@property (readonly) NSDate *commitTime;		///< for begin and commit, if the plugin reports it
+@property (readonly) NSString *schema;
+@property (readonly) NSString *table;
+
+/** The new row of an insert or update, by column name: NSStrings, or NSNull for NULL.
+ *  Unchanged TOASTed values of an update are omitted.
+ */
+@property (readonly) NSDictionary *values;
+
+/** For an update or delete, the replica identity columns of the old row, or the whole row
+ *  with REPLICA IDENTITY FULL; nil if the server didn't send them.
+ */
+@property (readonly) NSDictionary *oldValues;
+
+@end
+
+/** Consumes changes from a logical replication slot.
+ * @discussion The stream opens its own connection with replication=database, creates or
+ *             attaches to a slot and reads the COPY BOTH stream that START_REPLICATION
+ *             begins. Each message is decoded into PGChanges, passed to the handler and
+ *             freed before the next is read, so memory stays bounded however far behind
+ *             the consumer is; the server waits when the socket's buffers fill.
+ *
+ *             Standby status updates report the position received and the position
+ *             confirmed, which lets the server discard WAL the slot no longer needs. By
+ *             default a change is confirmed once the handler returns; a consumer that
+ *             applies changes asynchronously turns automaticallyConfirms off and calls
+ *             confirmLSN: once they are durable.
+ */
+@interface PGReplicationStream : NSObject
+{
+	PGConnection *_connection;
+	NSString *_slotName;
+	PGReplicationPlugin _plugin;
+	NSArray *_publications;
+	NSTimeInterval _statusInterval;
+	BOOL _automaticallyConfirms;
+
+	volatile int64_t _receivedLSN;
+	volatile int64_t _confirmedLSN;
+	volatile int32_t _stopped;
+	BOOL _inTransaction;
+	uint32_t _transactionID;
+	NSMutableDictionary *_relations;	// pgoutput relation messages, by relation id
+}
+
+@property (readonly) PGConnection *connection;
+@property (readonly) NSString *slotName;
+@property (readonly) PGReplicationPlugin plugin;
+
+/** The publications pgoutput streams. Required for kPGReplicationPluginPgoutput. */
+@property (copy) NSArray *publications;
+
+/** The longest time between status updates. Defaults to 10 seconds, matching the
+ *  server's default wal_receiver_status_interval.
+ */
+@property NSTimeInterval statusInterval;
+
+/** Confirm each change once the handler returns for it. Defaults to YES. */
+@property BOOL automaticallyConfirms;
+
+@property (readonly) uint64_t receivedLSN;
+@property (readonly) uint64_t confirmedLSN;
+
+/** Initialize for a slot.
+ * @param params the connection parameters; replication=database is added
+ */
+- (id)initWithParameters:(NSDictionary *)params slotName:(NSString *)slotName plugin:(PGReplicationPlugin)plugin;
+
+- (BOOL)connect:(NSError **)error;
+- (void)disconnect;
+
+/** Create the slot with the stream's plugin. Succeeds if the slot already exists. */
+- (BOOL)createSlot:(NSError **)error;
+- (BOOL)dropSlot:(NSError **)error;
+
+/** Stream changes to the handler on the calling thread until the handler stops, -stop is
+ *  called or the connection fails.
+ * @param lsn where to start; 0 for the slot's confirmed position
+ * @return NO on error; streaming can be resumed by calling this again
+ */
+- (BOOL)streamChangesFromLSN:(uint64_t)lsn error:(NSError **)error handler:(PGChangeHandler)handler;
+
+/** Confirm that changes up to and including lsn are durable. May be called from any thread. */
+- (void)confirmLSN:(uint64_t)lsn;
+
+/** End streaming from another thread. Streaming stops within a quarter second. */
+- (void)stop;
+
+@end
+
+/** Format a byte position as a WAL location such as "16/B374D848". */
+NSString *PGStringFromLSN(uint64_t lsn);
@@ -0,0 +1,711 @@
+//
+//  PGReplicationStream.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGReplicationStream.h"
+#import "PGConnection.h"
+#import "PGResult.h"
+#import "PGError.h"
+#import "PGReplicaRouter.h"
+#import "PGInternal.h"
+#import <libkern/OSAtomic.h>
+#import <sys/select.h>
+
+#define kPGStatusUpdateLength 34	// 'r', three positions, the clock and the reply flag
+#define kPGStreamPollInterval 0.25	// the longest wait before checking -stop
+
+NSString *PGStringFromLSN(uint64_t lsn)
+{
+	return [NSString stringWithFormat:@"%X/%X", (uint32_t)(lsn >> 32), (uint32_t)lsn];
+}
+
+/** The server's clock: microseconds since 2000-01-01. */
+static int64_t PGCurrentTimestamp(void)
+{
+	return (int64_t)((CFAbsoluteTimeGetCurrent() + 31622400.0) * 1000000.0);
+}
+
+static NSDate *PGDateFromTimestamp(int64_t timestamp)
+{
+	return [NSDate dateWithTimeIntervalSinceReferenceDate:timestamp / 1000000.0 - 31622400.0];
+}
+
+#pragma mark Message reading
+
+/** Reads big-endian values from a message, failing once it runs out of data. */
+typedef struct {
+	const uint8_t *bytes;
+	const uint8_t *end;
+	BOOL failed;
+} PGMessageReader;
+
+static const uint8_t *PGMessageReadBytes(PGMessageReader *reader, size_t length)
+{
+	if (reader->failed || (size_t)(reader->end - reader->bytes) < length) {
+		reader->failed = YES;
+		return NULL;
+	}
+	const uint8_t *bytes = reader->bytes;
+	reader->bytes += length;
+	return bytes;
+}
+
+static uint8_t PGMessageReadByte(PGMessageReader *reader)
+{
+	const uint8_t *bytes = PGMessageReadBytes(reader, 1);
+	return bytes ? *bytes : 0;
+}
+
+static uint16_t PGMessageReadUInt16(PGMessageReader *reader)
+{
+	const uint8_t *bytes = PGMessageReadBytes(reader, 2);
+	return bytes ? OSReadBigInt16(bytes, 0) : 0;
+}
+
+static uint32_t PGMessageReadUInt32(PGMessageReader *reader)
+{
+	const uint8_t *bytes = PGMessageReadBytes(reader, 4);
+	return bytes ? OSReadBigInt32(bytes, 0) : 0;
+}
+
+static uint64_t PGMessageReadUInt64(PGMessageReader *reader)
+{
+	const uint8_t *bytes = PGMessageReadBytes(reader, 8);
+	return bytes ? OSReadBigInt64(bytes, 0) : 0;
+}
+
+static NSString *PGMessageReadString(PGMessageReader *reader)
+{
+	const uint8_t *nul = reader->failed ? NULL : memchr(reader->bytes, 0, reader->end - reader->bytes);
+
+	if (!nul) {
+		reader->failed = YES;
+		return nil;
+	}
+	NSString *string = [NSString stringWithUTF8String:(const char *)reader->bytes];
+	reader->bytes = nul + 1;
+	return string;
+}
+
+#pragma mark -
+
+@implementation PGChange
+
+@synthesize type = _type;
+@synthesize lsn = _lsn;
+@synthesize transactionID = _transactionID;
+@synthesize commitTime = _commitTime;
+@synthesize schema = _schema;
+@synthesize table = _table;
+@synthesize values = _values;
+@synthesize oldValues = _oldValues;
+
+- (void)dealloc
+{
+	[_commitTime release];
+	[_schema release];
+	[_table release];
+	[_values release];
+	[_oldValues release];
+	[super dealloc];
+}
+
+- (NSString *)description
+{
+	static NSString *const names[] = { @"BEGIN", @"COMMIT", @"INSERT", @"UPDATE", @"DELETE", @"TRUNCATE" };
+
+	return [NSString stringWithFormat:@"%@ %@ xid %u %@%@%@ %@", PGStringFromLSN(_lsn), names[_type], _transactionID,
+			_schema ? _schema : @"", _schema ? @"." : @"", _table ? _table : @"", _values ? _values : @""];
+}
+
+@end
+
+/** A table described by a pgoutput relation message. */
+@interface PGReplicationRelation : NSObject
+{
+@public
+	NSString *schema;
+	NSString *table;
+	NSArray *columns;
+}
+@end
+
+@implementation PGReplicationRelation
+
+- (void)dealloc
+{
+	[schema release];
+	[table release];
+	[columns release];
+	[super dealloc];
+}
+
+@end
+
+#pragma mark test_decoding
+
+/** Read an identifier as quote_identifier() writes it. */
+static NSString *PGScanIdentifier(const char **p, const char *end, const char *terminators)
+{
+	const char *s = *p;
+	NSMutableData *name = [NSMutableData data];
+
+	if (s < end && *s == '"') {
+		for (s++; s < end; s++) {
+			if (*s == '"') {
+				if (s + 1 < end && s[1] == '"') s++;	// a doubled quote
+				else { s++; break; }
+			}
+			[name appendBytes:s length:1];
+		}
+	}
+	else {
+		const char *start = s;
+		while (s < end && !strchr(terminators, *s)) s++;
+		[name appendBytes:start length:s - start];
+	}
+
+	*p = s;
+	return [[[NSString alloc] initWithData:name encoding:NSUTF8StringEncoding] autorelease];
+}
+
+/** Read columns written as name[type]:value until the end or the next section's label. */
+static NSDictionary *PGScanTestDecodingTuple(const char **p, const char *end)
+{
+	NSMutableDictionary *values = [NSMutableDictionary dictionary];
+	const char *s = *p;
+
+	while (s < end) {
+		while (s < end && *s == ' ') s++;
+		if (s >= end || (end - s >= 10 && memcmp(s, "new-tuple:", 10) == 0) || *s == '(')
+			break;	// the next section, or "(no-tuple-data)"
+
+		NSString *column = PGScanIdentifier(&s, end, "[");
+
+		// the type name may itself contain brackets, e.g., integer[]
+		const char *close = s;
+		while (close + 1 < end && !(close[0] == ']' && close[1] == ':')) close++;
+		if (close + 1 >= end) break;
+		s = close + 2;
+
+		id value;
+		if (s < end && *s == '\'') {
+			NSMutableData *text = [NSMutableData data];
+			for (s++; s < end; s++) {
+				if (*s == '\'') {
+					if (s + 1 < end && s[1] == '\'') s++;
+					else { s++; break; }
+				}
+				[text appendBytes:s length:1];
+			}
+			value = [[[NSString alloc] initWithData:text encoding:NSUTF8StringEncoding] autorelease];
+		}
+		else {
+			const char *start = s;
+			while (s < end && *s != ' ') s++;
+			value = [[[NSString alloc] initWithBytes:start length:s - start encoding:NSUTF8StringEncoding] autorelease];
+			if ([value isEqualToString:@"null"])
+				value = NSNull.null;
+			else if ([value isEqualToString:@"unchanged-toast-datum"])
+				value = nil;
+		}
+
+		if (column && value) values[column] = value;
+	}
+
+	*p = s;
+	return values;
+}
+
+#pragma mark -
+
+@implementation PGReplicationStream
+
+@synthesize connection = _connection;
+@synthesize slotName = _slotName;
+@synthesize plugin = _plugin;
+@synthesize publications = _publications;
+@synthesize statusInterval = _statusInterval;
+@synthesize automaticallyConfirms = _automaticallyConfirms;
+
+- (id)initWithParameters:(NSDictionary *)params slotName:(NSString *)slotName plugin:(PGReplicationPlugin)plugin
+{
+	if (self = [super init]) {
+		NSMutableDictionary *replicationParams = [[params mutableCopy] autorelease];
+		replicationParams[PGConnectionParameterReplicationKey] = @"database";
+
+		_connection = [[PGConnection alloc] initWithParameters:replicationParams];
+		_slotName = [slotName copy];
+		_plugin = plugin;
+		_statusInterval = 10.0;
+		_automaticallyConfirms = YES;
+		_relations = [[NSMutableDictionary alloc] init];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[_connection release];
+	[_slotName release];
+	[_publications release];
+	[_relations release];
+	[super dealloc];
+}
+
+- (uint64_t)receivedLSN
+{
+	return (uint64_t)OSAtomicAdd64Barrier(0, &_receivedLSN);
+}
+
+- (uint64_t)confirmedLSN
+{
+	return (uint64_t)OSAtomicAdd64Barrier(0, &_confirmedLSN);
+}
+
+/** Raise a position to lsn; positions never move backward. */
+static void PGAdvanceLSN(volatile int64_t *position, uint64_t lsn)
+{
+	int64_t current;
+
+	do {
+		current = *position;
+		if ((uint64_t)current >= lsn) return;
+	} while (!OSAtomicCompareAndSwap64Barrier(current, (int64_t)lsn, position));
+}
+
+- (void)confirmLSN:(uint64_t)lsn
+{
+	PGAdvanceLSN(&_confirmedLSN, lsn);
+}
+
+- (void)stop
+{
+	OSAtomicCompareAndSwap32Barrier(0, 1, &_stopped);
+}
+
+#pragma mark Connection and slot
+
+- (BOOL)connect:(NSError **)error
+{
+	if ([_connection connect])
+		return YES;
+
+	if (error) *error = _connection.error;
+	return NO;
+}
+
+- (void)disconnect
+{
+	[_connection disconnect];
+}
+
+- (NSString *)_quotedSlotName
+{
+	const char *name = _slotName.UTF8String;
+	char *identifier = PQescapeIdentifier(_connection.conn, name, strlen(name));
+	if (!identifier) return nil;
+
+	NSString *quoted = [NSString stringWithUTF8String:identifier];
+	PQfreemem(identifier);
+	return quoted;
+}
+
+- (BOOL)createSlot:(NSError **)error
+{
+	NSString *plugin = (_plugin == kPGReplicationPluginPgoutput) ? @"pgoutput" : @"test_decoding";
+	NSString *command = [NSString stringWithFormat:@"CREATE_REPLICATION_SLOT %@ LOGICAL %@", [self _quotedSlotName], plugin];
+	PGResult *result = [_connection _resultWithResult:PQexec(_connection.conn, command.UTF8String)];
+
+	if (result.status == kPGResultTuplesOK || result.error.sqlState == kPGSQLStateDuplicateObject)
+		return YES;
+
+	if (error) *error = result.error;
+	return NO;
+}
+
+- (BOOL)dropSlot:(NSError **)error
+{
+	NSString *command = [@"DROP_REPLICATION_SLOT " stringByAppendingString:[self _quotedSlotName]];
+	PGResult *result = [_connection _resultWithResult:PQexec(_connection.conn, command.UTF8String)];
+
+	if (result.status == kPGResultCommandOK)
+		return YES;
+
+	if (error) *error = result.error;
+	return NO;
+}
+
+- (NSString *)_pluginOptions
+{
+	if (_plugin == kPGReplicationPluginTestDecoding)
+		return @" (\"include-xids\" '1', \"skip-empty-xacts\" '1')";
+
+	NSString *names = [self.publications componentsJoinedByString:@","];
+	char *literal = PQescapeLiteral(_connection.conn, names.UTF8String, strlen(names.UTF8String));
+	if (!literal) return nil;
+
+	NSString *options = [NSString stringWithFormat:@" (proto_version '1', publication_names %s)", literal];
+	PQfreemem(literal);
+	return options;
+}
+
+#pragma mark Streaming
+
+- (BOOL)streamChangesFromLSN:(uint64_t)lsn error:(NSError **)outError handler:(PGChangeHandler)handler
+{
+	PGconn *conn = _connection.conn;
+	NSString *options = [self _pluginOptions];
+	NSError *error = nil;
+	BOOL success = YES, stop = NO;
+
+	if (!options) {
+		if (outError) *outError = _connection.error;
+		return NO;
+	}
+
+	NSString *command = [NSString stringWithFormat:@"START_REPLICATION SLOT %@ LOGICAL %@%@", [self _quotedSlotName], PGStringFromLSN(lsn), options];
+	PGresult *start = PQexec(conn, command.UTF8String);
+
+	if (PQresultStatus(start) != PGRES_COPY_BOTH) {
+		if (outError) *outError = [_connection _resultWithResult:start].error;
+		return NO;
+	}
+	PQclear(start);
+
+	PGAdvanceLSN(&_receivedLSN, lsn);
+	_stopped = 0;
+	_inTransaction = NO;
+	[_relations removeAllObjects];	// the server sends relations again for a new stream
+
+	CFAbsoluteTime lastStatus = 0;	// report the starting position right away
+
+	while (!stop && !_stopped) {
+		char *buffer = NULL;
+		BOOL replyRequested = NO;
+		int length = PQgetCopyData(conn, &buffer, 1);
+
+		if (length > 0) {
+			@autoreleasepool {
+				stop = ![self _handleMessage:(const uint8_t *)buffer length:length replyRequested:&replyRequested handler:handler];
+			}
+			PQfreemem(buffer);
+		}
+		else if (length == 0) {
+			// Wait for data, but wake to send a status update or to notice -stop
+			NSTimeInterval wait = MIN(kPGStreamPollInterval, MAX(0.0, lastStatus + _statusInterval - CFAbsoluteTimeGetCurrent()));
+			struct timeval timeout = { (time_t)wait, (suseconds_t)((wait - (time_t)wait) * 1000000) };
+			fd_set readSet;
+			int socket = PQsocket(conn);
+
+			FD_ZERO(&readSet);
+			FD_SET(socket, &readSet);
+			if (select(socket + 1, &readSet, NULL, NULL, &timeout) < 0 && errno != EINTR) {
+				success = NO;
+				break;
+			}
+			if (!PQconsumeInput(conn)) {
+				success = NO;
+				break;
+			}
+		}
+		else {
+			break;	// -1: the server ended the stream; -2: the connection failed
+		}
+
+		if (replyRequested || CFAbsoluteTimeGetCurrent() - lastStatus >= _statusInterval) {
+			if (![self _sendStatus]) {
+				success = NO;
+				break;
+			}
+			lastStatus = CFAbsoluteTimeGetCurrent();
+		}
+	}
+
+	if (success && PQstatus(conn) == CONNECTION_OK) {
+		// Report what was confirmed, end the stream and discard what the server sent meanwhile
+		[self _sendStatus];
+		PQputCopyEnd(conn, NULL);
+
+		char *buffer;
+		while (PQgetCopyData(conn, &buffer, 0) > 0)
+			PQfreemem(buffer);
+	}
+
+	PGresult *result;
+	while ((result = PQgetResult(conn))) {
+		if (PQresultStatus(result) == PGRES_FATAL_ERROR && !error)
+			error = [_connection _resultWithResult:result].error;
+		else
+			PQclear(result);
+	}
+
+	if (!error && (!success || PQstatus(conn) != CONNECTION_OK))
+		error = _connection.error;
+
+	if (error && outError) *outError = error;
+	return error == nil;
+}
+
+- (BOOL)_sendStatus
+{
+	uint8_t message[kPGStatusUpdateLength];
+	uint64_t confirmed = self.confirmedLSN;
+
+	message[0] = 'r';
+	OSWriteBigInt64(message, 1, MAX(self.receivedLSN, confirmed));	// written
+	OSWriteBigInt64(message, 9, confirmed);							// flushed
+	OSWriteBigInt64(message, 17, confirmed);						// applied
+	OSWriteBigInt64(message, 25, PGCurrentTimestamp());
+	message[33] = 0;	// no reply requested
+
+	return PQputCopyData(_connection.conn, (const char *)message, sizeof(message)) == 1 && PQflush(_connection.conn) == 0;
+}
+
+/** Decode one CopyData message. Returns NO if the handler stopped. */
+- (BOOL)_handleMessage:(const uint8_t *)bytes length:(int)length replyRequested:(BOOL *)replyRequested handler:(PGChangeHandler)handler
+{
+	PGMessageReader reader = { bytes + 1, bytes + length, NO };
+
+	if (bytes[0] == 'k') {
+		// Primary keepalive: the end of WAL, the server's clock and whether to reply now
+		uint64_t walEnd = PGMessageReadUInt64(&reader);
+		PGMessageReadUInt64(&reader);
+		*replyRequested = PGMessageReadByte(&reader) != 0;
+
+		// Between transactions, nothing unconfirmed precedes walEnd, so the slot may advance
+		// past WAL that holds no changes for it
+		if (_automaticallyConfirms && !_inTransaction && !reader.failed && self.confirmedLSN == self.receivedLSN) {
+			PGAdvanceLSN(&_receivedLSN, walEnd);
+			[self confirmLSN:walEnd];
+		}
+		return YES;
+	}
+
+	if (bytes[0] != 'w')
+		return YES;
+
+	// XLogData: the WAL position of the data, the end of WAL and the server's clock
+	uint64_t lsn = PGMessageReadUInt64(&reader);
+	PGMessageReadUInt64(&reader);
+	PGMessageReadUInt64(&reader);
+	if (reader.failed) return YES;
+
+	PGAdvanceLSN(&_receivedLSN, lsn);
+
+	NSMutableArray *changes = [NSMutableArray arrayWithCapacity:1];
+	if (_plugin == kPGReplicationPluginPgoutput)
+		[self _decodePgoutput:&reader lsn:lsn changes:changes];
+	else
+		[self _decodeTestDecoding:(const char *)reader.bytes length:reader.end - reader.bytes lsn:lsn changes:changes];
+
+	BOOL stop = NO;
+	for (PGChange *change in changes) {
+		handler(change, &stop);
+		if (_automaticallyConfirms) [self confirmLSN:lsn];
+		if (stop) break;
+	}
+
+	// A message with nothing to report, e.g., a relation, needs no further handling
+	if (!changes.count && _automaticallyConfirms && !_inTransaction)
+		[self confirmLSN:lsn];
+
+	return !stop;
+}
+
+- (PGChange *)_changeOfType:(PGChangeType)type lsn:(uint64_t)lsn
+{
+	PGChange *change = [[[PGChange alloc] init] autorelease];
+	change->_type = type;
+	change->_lsn = lsn;
+	change->_transactionID = _transactionID;
+	return change;
+}
+
+- (void)_decodeTestDecoding:(const char *)text length:(size_t)length lsn:(uint64_t)lsn changes:(NSMutableArray *)changes
+{
+	const char *s = text, *end = text + length;
+
+	if (length >= 5 && memcmp(s, "BEGIN", 5) == 0) {
+		_transactionID = (uint32_t)strtoul(s + 5, NULL, 10);	// PQgetCopyData() terminates the data
+		_inTransaction = YES;
+		[changes addObject:[self _changeOfType:kPGChangeBegin lsn:lsn]];
+		return;
+	}
+
+	if (length >= 6 && memcmp(s, "COMMIT", 6) == 0) {
+		[changes addObject:[self _changeOfType:kPGChangeCommit lsn:lsn]];
+		_inTransaction = NO;
+		return;
+	}
+
+	// table schema.name: ACTION: columns
+	if (length < 6 || memcmp(s, "table ", 6) != 0)
+		return;
+	s += 6;
+
+	NSString *schema = PGScanIdentifier(&s, end, ".");
+	if (s >= end || *s++ != '.') return;
+	NSString *table = PGScanIdentifier(&s, end, ":");
+	if (end - s < 2 || memcmp(s, ": ", 2) != 0) return;
+	s += 2;
+
+	const char *action = s;
+	while (s < end && *s != ':') s++;
+	size_t actionLength = s - action;
+	if (s < end) s++;
+
+	PGChangeType type;
+	if (actionLength == 6 && memcmp(action, "INSERT", 6) == 0)        type = kPGChangeInsert;
+	else if (actionLength == 6 && memcmp(action, "UPDATE", 6) == 0)   type = kPGChangeUpdate;
+	else if (actionLength == 6 && memcmp(action, "DELETE", 6) == 0)   type = kPGChangeDelete;
+	else if (actionLength == 8 && memcmp(action, "TRUNCATE", 8) == 0) type = kPGChangeTruncate;
+	else return;
+
+	PGChange *change = [self _changeOfType:type lsn:lsn];
+	change->_schema = [schema retain];
+	change->_table = [table retain];
+
+	while (s < end && *s == ' ') s++;
+
+	if (type == kPGChangeUpdate && end - s >= 8 && memcmp(s, "old-key:", 8) == 0) {
+		s += 8;
+		change->_oldValues = [PGScanTestDecodingTuple(&s, end) retain];
+		while (s < end && *s == ' ') s++;
+		if (end - s >= 10 && memcmp(s, "new-tuple:", 10) == 0) s += 10;
+	}
+
+	if (type == kPGChangeInsert || type == kPGChangeUpdate)
+		change->_values = [PGScanTestDecodingTuple(&s, end) retain];
+	else if (type == kPGChangeDelete && s < end && *s != '(')
+		change->_oldValues = [PGScanTestDecodingTuple(&s, end) retain];
+
+	[changes addObject:change];
+}
+
+- (NSDictionary *)_readPgoutputTuple:(PGMessageReader *)reader relation:(PGReplicationRelation *)relation
+{
+	uint16_t count = PGMessageReadUInt16(reader);
+	NSMutableDictionary *values = [NSMutableDictionary dictionaryWithCapacity:count];
+
+	for (uint16_t i = 0; i < count && !reader->failed; i++) {
+		NSString *column = (relation && i < relation->columns.count) ? relation->columns[i] : [NSString stringWithFormat:@"column%u", i + 1];
+
+		switch (PGMessageReadByte(reader)) {
+			case 'n':
+				values[column] = NSNull.null;
+				break;
+			case 't': {
+				uint32_t length = PGMessageReadUInt32(reader);
+				const uint8_t *bytes = PGMessageReadBytes(reader, length);
+				NSString *value = bytes ? [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding] : nil;
+				if (value) values[column] = value;
+				[value release];
+				break;
+			}
+			default:	// 'u', an unchanged TOASTed value
+				break;
+		}
+	}
+	return values;
+}
+
+- (void)_decodePgoutput:(PGMessageReader *)reader lsn:(uint64_t)lsn changes:(NSMutableArray *)changes
+{
+	uint8_t kind = PGMessageReadByte(reader);
+	PGReplicationRelation *relation;
+	PGChange *change;
+
+	switch (kind) {
+		case 'B': {
+			PGMessageReadUInt64(reader);	// the final LSN of the transaction
+			int64_t commitTime = PGMessageReadUInt64(reader);
+			_transactionID = PGMessageReadUInt32(reader);
+			_inTransaction = YES;
+
+			change = [self _changeOfType:kPGChangeBegin lsn:lsn];
+			change->_commitTime = [PGDateFromTimestamp(commitTime) retain];
+			[changes addObject:change];
+			break;
+		}
+		case 'C': {
+			PGMessageReadByte(reader);		// flags
+			PGMessageReadUInt64(reader);	// the commit's LSN
+			PGMessageReadUInt64(reader);	// the end of the transaction
+			int64_t commitTime = PGMessageReadUInt64(reader);
+
+			change = [self _changeOfType:kPGChangeCommit lsn:lsn];
+			change->_commitTime = [PGDateFromTimestamp(commitTime) retain];
+			[changes addObject:change];
+			_inTransaction = NO;
+			break;
+		}
+		case 'R': {
+			uint32_t relationID = PGMessageReadUInt32(reader);
+			relation = [[[PGReplicationRelation alloc] init] autorelease];
+			relation->schema = [PGMessageReadString(reader) retain];
+			relation->table = [PGMessageReadString(reader) retain];
+			PGMessageReadByte(reader);		// replica identity
+
+			uint16_t count = PGMessageReadUInt16(reader);
+			NSMutableArray *columns = [NSMutableArray arrayWithCapacity:count];
+			for (uint16_t i = 0; i < count && !reader->failed; i++) {
+				PGMessageReadByte(reader);		// flags
+				NSString *name = PGMessageReadString(reader);
+				PGMessageReadUInt32(reader);	// type
+				PGMessageReadUInt32(reader);	// type modifier
+				if (name) [columns addObject:name];
+			}
+			relation->columns = [columns copy];
+
+			if (!reader->failed)
+				_relations[@(relationID)] = relation;
+			break;
+		}
+		case 'I':
+		case 'U':
+		case 'D': {
+			relation = _relations[@(PGMessageReadUInt32(reader))];
+			change = [self _changeOfType:(kind == 'I' ? kPGChangeInsert : kind == 'U' ? kPGChangeUpdate : kPGChangeDelete) lsn:lsn];
+			if (relation) {
+				change->_schema = [relation->schema retain];
+				change->_table = [relation->table retain];
+			}
+
+			uint8_t section = PGMessageReadByte(reader);
+			if (section == 'K' || section == 'O') {
+				change->_oldValues = [[self _readPgoutputTuple:reader relation:relation] retain];
+				if (kind == 'U') section = PGMessageReadByte(reader);
+			}
+			if (section == 'N')
+				change->_values = [[self _readPgoutputTuple:reader relation:relation] retain];
+
+			if (!reader->failed)
+				[changes addObject:change];
+			break;
+		}
+		case 'T': {
+			uint32_t count = PGMessageReadUInt32(reader);
+			PGMessageReadByte(reader);		// CASCADE and RESTART IDENTITY
+
+			for (uint32_t i = 0; i < count && !reader->failed; i++) {
+				relation = _relations[@(PGMessageReadUInt32(reader))];
+				change = [self _changeOfType:kPGChangeTruncate lsn:lsn];
+				if (relation) {
+					change->_schema = [relation->schema retain];
+					change->_table = [relation->table retain];
+				}
+				[changes addObject:change];
+			}
+			break;
+		}
+		default:	// types, origins and messages
+			break;
+	}
+}
+
+@end
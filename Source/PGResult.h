@@ -9,6 +9,9 @@
 #import <Cocoa/Cocoa.h>
 
 @class PGRow;
+@class PGError;
+@class PGMemoryAccount;
+@class PGResultDescriptor;
 struct pg_result;
 
 /** Mapped directly to ExecStatusType */
@@ -26,30 +29,63 @@ typedef enum {
 								 * backend */
 	kPGResultNonFatalError,		/**< notice or warning message */
 	kPGResultFatalError,		/**< query failed */
-	kPGResultCopyBoth			/**< Copy In/Out data transfer in progress */
+	kPGResultCopyBoth,			/**< Copy In/Out data transfer in progress */
+	kPGResultSingleTuple		/**< single tuple from larger resultset */
 } PGExecStatusType;
 
 @interface PGResult : NSObject <NSFastEnumeration>
 {
 	struct pg_result *_result;
-	NSArray *_fieldNames;
+	PGResultDescriptor *_descriptor;
+
+	size_t _memorySize;
+	PGMemoryAccount *_account;
+	NSString *_errorMessage;
 }
 
 @property (readonly) NSArray *fieldNames;
 @property (readonly) NSUInteger numberOfFields;
 @property (readonly) NSUInteger numberOfRows;
+@property (readonly) NSUInteger numberOfAffectedRows;	///< rows affected or moved by the command
 @property (readonly) NSArray *rows;
 @property (readonly) PGExecStatusType status;
-@property (readonly) NSError *error;
+@property (readonly) PGError *error;
+
+/** An estimate of the bytes held by the underlying PGresult: the cell values plus
+ *  libpq's per-cell and per-field bookkeeping.
+ */
+@property (readonly) NSUInteger memorySize;
 
 + (instancetype)_resultWithResult:(struct pg_result *)result;
 
 - (id)_initWithResult:(struct pg_result *)result;
 
+/** Use a descriptor built in advance, e.g., by a prepared query, instead of describing
+ *  the result on first access. Ignored if the field count differs.
+ */
+- (void)_setDescriptor:(PGResultDescriptor *)descriptor;
+- (PGResultDescriptor *)_descriptor;
+
+/** The bytes of a cell as libpq returned them, terminated with a NUL, or NULL if the
+ *  value is NULL or out of range.
+ */
+- (const char *)_bytesAtRowIndex:(NSUInteger)rowNum fieldIndex:(NSUInteger)fieldNum length:(int *)length;
+
+/** A message for a failure detected by the client, which the error reports in place of
+ *  the server's message.
+ */
+- (void)_setErrorMessage:(NSString *)message;
+- (NSString *)_errorMessage;
+
+/** Charge the result's memorySize to an account until the result is deallocated. */
+- (void)_setMemoryAccount:(PGMemoryAccount *)account;
+
 - (PGRow *)rowAtIndex:(NSUInteger)index;
 - (PGRow *)objectAtIndexedSubscript:(NSUInteger)idx;
 
 - (id)valueAtRowIndex:(NSUInteger)rowNum fieldIndex:(NSUInteger)fieldNum;
 - (NSUInteger)indexForFieldName:(NSString *)name;
 
+- (struct pg_result *)pgresult;
+
 @end
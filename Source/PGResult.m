@@ -10,7 +10,9 @@
 #import "PGConnection.h"
 #import "PGRow.h"
 #import "PGInternal.h"
-#import <syslog.h>
+#import "PGError.h"
+#import "PGMemoryAccount.h"
+#import "PGResultDescriptor.h"
 
 #pragma mark - Prototypes
 
@@ -18,8 +20,6 @@
 void NSDecimalInit(NSDecimal *dcm, uint64_t mantissa, int8_t exp, BOOL isNegative);
 void SwapBigBinaryNumericToHost(pg_numeric_t *pgdata);
 NSDecimalNumber * NSDecimalNumberFromBinaryNumeric(pg_numeric_t *pgval);
-NSString * NSStringFromPGresultStatus(ExecStatusType status);
-NSError * NSErrorFromPGresult(PGresult *result);
 
 #pragma mark -
 
@@ -46,23 +46,63 @@ NSError * NSErrorFromPGresult(PGresult *result);
 	return self;
 }
 
-- (NSArray *)fieldNames
+- (void)_setDescriptor:(PGResultDescriptor *)descriptor
 {
+	if (descriptor->_numberOfFields != PQnfields(_result)) return;
+
 	@synchronized(self) {
-		if (_fieldNames) return _fieldNames;
-		
-		int count = PQnfields(_result);
-		NSMutableArray *names = [[NSMutableArray alloc] initWithCapacity:count];
-		
-		for (int i = 0; i < count; i++) {
-			//		printf("Field: %s  type: %i\n", PQfname(result, i), PQftype(result, i));
-			NSString *name = [[NSString alloc] initWithCString:PQfname(_result, i) encoding:NSUTF8StringEncoding];
-			[names addObject:name];
-		}
-		_fieldNames = [names copy];
-		[names release];
-	}	
-	return _fieldNames;
+		[_descriptor release];
+		_descriptor = [descriptor retain];
+	}
+}
+
+- (PGResultDescriptor *)_descriptor
+{
+	if (_descriptor) return _descriptor;
+
+	@synchronized(self) {
+		if (!_descriptor)
+			_descriptor = [[PGResultDescriptor alloc] initWithResult:_result];
+	}
+	return _descriptor;
+}
+
+- (void)_setErrorMessage:(NSString *)message
+{
+	if (message == _errorMessage) return;
+
+	[_errorMessage release];
+	_errorMessage = [message copy];
+}
+
+- (NSString *)_errorMessage
+{
+	return _errorMessage;
+}
+
+- (void)_setMemoryAccount:(PGMemoryAccount *)account
+{
+	if (_account == account) return;
+
+	NSUInteger size = self.memorySize;
+
+	[_account addBytes:-(int64_t)size];
+	[_account release];
+	_account = [account retain];
+	[_account addBytes:size];
+}
+
+- (NSUInteger)memorySize
+{
+	if (_memorySize == 0 && _result)
+		_memorySize = PGresultMemorySize(_result);
+
+	return _memorySize;
+}
+
+- (NSArray *)fieldNames
+{
+	return self._descriptor.fieldNames;
 }
 
 - (NSUInteger)numberOfFields
@@ -75,6 +115,11 @@ NSError * NSErrorFromPGresult(PGresult *result);
 	return (NSUInteger)PQntuples(_result);
 }
 
+- (NSUInteger)numberOfAffectedRows
+{
+	return (NSUInteger)strtoul(PQcmdTuples(_result), NULL, 10);
+}
+
 - (PGRow *)rowAtIndex:(NSUInteger)index
 {
 	return [[[PGRow alloc] _initWithResult:self rowNumber:index] autorelease];
@@ -101,33 +146,28 @@ NSError * NSErrorFromPGresult(PGresult *result);
 
 - (NSUInteger)indexForFieldName:(NSString *)name
 {
-	return PQfnumber(_result, name.UTF8String);
+	return [self._descriptor indexForFieldName:name result:_result];
+}
+
+- (const char *)_bytesAtRowIndex:(NSUInteger)rowNum fieldIndex:(NSUInteger)fieldNum length:(int *)length
+{
+	if (PQgetisnull(_result, rowNum, fieldNum))
+		return NULL;
+
+	*length = PQgetlength(_result, rowNum, fieldNum);
+	return PQgetvalue(_result, rowNum, fieldNum);
 }
 
 - (id)valueAtRowIndex:(NSUInteger)rowNum fieldIndex:(NSUInteger)fieldNum
 {
-	id value;
-	char *pgval;
-	int length;
-	Oid oid;
-	BOOL isBinary;
+	PGResultDescriptor *descriptor = self._descriptor;
 
 	if (PQgetisnull(_result, rowNum, fieldNum))
 		return [NSNull null];
-	
-	pgval = PQgetvalue(_result, rowNum, fieldNum);
-	isBinary = PQfformat(_result, fieldNum);
-
-	if (isBinary) {
-		// get Oid types with "SELECT oid, typname from pg_type;"
-		length = PQgetlength(_result, rowNum, fieldNum);
-		oid = PQftype(_result, fieldNum);
-		value = NSObjectFromPGBinaryValue(pgval, length, oid);
-	}
-	else
-		value = [NSString stringWithCString:pgval encoding:NSUTF8StringEncoding];
-	
-	return value;
+
+	// get Oid types with "SELECT oid, typname from pg_type;"
+	return descriptor->_decoders[fieldNum](self, PQgetvalue(_result, rowNum, fieldNum),
+										   PQgetlength(_result, rowNum, fieldNum), descriptor->_types[fieldNum]);
 }
 
 - (PGExecStatusType)status
@@ -140,7 +180,7 @@ NSError * NSErrorFromPGresult(PGresult *result);
 	NSUInteger i, maxLen, index;
 	
 	index = state->state;
-	maxLen = PQntuples(_result);
+	maxLen = self.numberOfRows;
 	
 	for (i = 0; i < len && index < maxLen ; i++, index++) {
 		stackbuf[i] = [[[PGRow alloc] _initWithResult:self rowNumber:index] autorelease];
@@ -152,14 +192,22 @@ NSError * NSErrorFromPGresult(PGresult *result);
 	return i;
 }
 
-- (NSError *)error
+- (PGError *)error
 {
-	return NSErrorFromPGresult(_result);
+	return [PGError errorWithResult:self];
+}
+
+- (struct pg_result *)pgresult
+{
+	return _result;
 }
 			
 - (void)dealloc
 {
-	[_fieldNames release];
+	[_descriptor release];
+	[_account addBytes:-(int64_t)_memorySize];
+	[_account release];
+	[_errorMessage release];
 	if (_result) PQclear(_result);
 	[super dealloc];
 }
@@ -167,99 +215,6 @@ NSError * NSErrorFromPGresult(PGresult *result);
 @end
 
 
-NSString * NSStringFromPGresultStatus(ExecStatusType status)
-{
-	NSString *desc;	
-	
-	switch (status) {
-		case PGRES_EMPTY_QUERY:
-			desc = @"The string sent to the server was empty.";
-			break;
-		case PGRES_COMMAND_OK:
-			desc = @"Successful completion of a command returning no data.";
-			break;
-		case PGRES_TUPLES_OK:
-			desc = @"Successful completion of a command returning data (such as a SELECT or SHOW).";
-			break;
-		case PGRES_COPY_OUT:
-			desc = @"Copy Out (from server) data transfer started.";
-			break;
-		case PGRES_COPY_IN:
-			desc = @"Copy In (to server) data transfer started.";
-			break;
-		case PGRES_BAD_RESPONSE:
-			desc = @"The server's response was not understood.";
-			break;
-		case PGRES_NONFATAL_ERROR:
-			desc = @"A nonfatal error (a notice or warning) occurred.";
-			break;
-		case PGRES_FATAL_ERROR:
-			desc = @"A fatal error occurred.";
-			break;
-		default:
-			desc = @"Unknown database error";
-	}
-	return desc;	
-}
-
-NSError * NSErrorFromPGresult(PGresult *result)
-{
-	NSError *error;
-	ExecStatusType status = PQresultStatus(result);
-
-	char *severity = PQresultErrorField(result, PG_DIAG_SEVERITY);         // always present
-	char *primary  = PQresultErrorField(result, PG_DIAG_MESSAGE_PRIMARY);  // always present
-	char *sqlstate = PQresultErrorField(result, PG_DIAG_SQLSTATE);         // always present
-	char *detail   = PQresultErrorField(result, PG_DIAG_MESSAGE_DETAIL);
-	char *hint     = PQresultErrorField(result, PG_DIAG_MESSAGE_HINT);
-
-	int level;
-	if (!severity)
-		level = LOG_INFO;
-	else if (!strncmp(severity, "ERROR", 3))
-		level = LOG_ERR;
-	else if (!strncmp(severity, "FATAL", 3))
-		level = LOG_CRIT;
-	else if (!strncmp(severity, "PANIC", 3))
-		level = LOG_CRIT;
-	else if (!strncmp(severity, "WARNING", 3))
-		level = LOG_WARNING;
-	else if (!strncmp(severity, "NOTICE", 3))
-		level = LOG_NOTICE;
-	else if (!strncmp(severity, "DEBUG", 3))
-		level = LOG_DEBUG;
-	else if (!strncmp(severity, "INFO", 3))
-		level = LOG_INFO;
-	else if (!strncmp(severity, "LOG", 3))
-		level = LOG_DEBUG;
-	else if (status == PGRES_NONFATAL_ERROR)
-		level = LOG_WARNING;
-	else if (status == PGRES_FATAL_ERROR)
-		level = LOG_ERR;
-	else
-		level = LOG_INFO;
-
-	NSMutableDictionary *info = [NSMutableDictionary dictionary];
-
-	if (primary)
-		[info setValue:[NSString stringWithUTF8String:primary] forKey:NSLocalizedDescriptionKey];
-	else
-		[info setValue:NSStringFromPGresultStatus(status) forKey:NSLocalizedDescriptionKey];
-
-	if (sqlstate && detail)
-	[info setValue:[NSString stringWithFormat:@"[SQLSTATE: %s] %s", sqlstate, (detail ? detail : "")]
-			forKey:NSLocalizedFailureReasonErrorKey];
-
-	if (hint)
-		[info setValue:[NSString stringWithUTF8String:hint] forKey:NSLocalizedRecoverySuggestionErrorKey];
-
-	error = [NSError errorWithDomain:PostgreSQLErrorDomain code:status userInfo:info];
-
-	syslog(level, "%s", error.localizedDescription.UTF8String);
-
-	return error;
-}
-
 ///* Accessor functions for PGresult objects */
 //extern ExecStatusType PQresultStatus(const PGresult *res);
 //extern char *PQresStatus(ExecStatusType status);
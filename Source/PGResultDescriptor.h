@@ -0,0 +1,51 @@
+//
+//  PGResultDescriptor.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "PGInternal.h"
+
+@class PGResult;
+
+/** Converts one non-NULL cell of a result to an object. */
+typedef id (*PGValueDecoder)(PGResult *owner, char *bytes, int length, Oid type);
+
+/** The shape of a result: its field names, types and formats, with the decoder for each
+ *  field and an index of field names chosen once.
+ * @discussion A result builds its own descriptor the first time it is needed. A prepared
+ *             query builds one when it is prepared and shares it with every result it
+ *             returns, so those results do no metadata work of their own.
+ */
+@interface PGResultDescriptor : NSObject
+{
+@public
+	int _numberOfFields;
+	Oid *_types;
+	int *_formats;
+	PGValueDecoder *_decoders;
+	NSArray *_fieldNames;
+	NSDictionary *_fieldIndexes;
+}
+
+/** Describe a result from its field metadata. */
+- (id)initWithResult:(PGresult *)result;
+
+/** Describe a result, overriding the formats it reports. PQdescribePrepared() reports
+ *  text for every field because the format is chosen at execution.
+ * @param format 0 for text, 1 for binary
+ */
+- (id)initWithResult:(PGresult *)result format:(int)format;
+
+/** The designated initializer, for a result that is not a PGresult, e.g., a snapshot. */
+- (id)initWithFieldNames:(NSArray *)names types:(const Oid *)types formats:(const int *)formats;
+
+@property (readonly) NSArray *fieldNames;
+
+/** The index of a field by exact name, then by PQfnumber()'s rules; -1 if not found. */
+- (NSInteger)indexForFieldName:(NSString *)name result:(PGresult *)result;
+
+@end
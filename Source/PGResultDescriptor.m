@@ -0,0 +1,159 @@
+//
+//  PGResultDescriptor.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGResultDescriptor.h"
+#import "PGResult.h"
+#import "PGResultString.h"
+
+/** A bytea value wrapped in place in its result, which it retains. Copies are ordinary
+ *  NSData, so they don't keep the result alive.
+ */
+@interface PGResultData : NSData
+{
+	PGResult *_owner;
+	const void *_bytes;
+	NSUInteger _length;
+}
+- (id)_initWithBytes:(const void *)bytes length:(NSUInteger)length owner:(PGResult *)owner;
+@end
+
+@implementation PGResultData
+
+- (id)_initWithBytes:(const void *)bytes length:(NSUInteger)length owner:(PGResult *)owner
+{
+	if (self = [super init]) {
+		_owner = [owner retain];
+		_bytes = bytes;
+		_length = length;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[_owner release];
+	[super dealloc];
+}
+
+- (NSUInteger)length      { return _length; }
+- (const void *)bytes     { return _bytes; }
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	return [[NSData allocWithZone:zone] initWithBytes:_bytes length:_length];
+}
+
+@end
+
+#pragma mark Decoders
+
+static id PGDecodeString(PGResult *owner, char *bytes, int length, Oid type)
+{
+	return [PGResultString _stringWithBytes:bytes length:length owner:owner];
+}
+
+static id PGDecodeBytea(PGResult *owner, char *bytes, int length, Oid type)
+{
+	// wrapped in place; the data keeps the result alive
+	return [[[PGResultData alloc] _initWithBytes:bytes length:length owner:owner] autorelease];
+}
+
+static id PGDecodeBinary(PGResult *owner, char *bytes, int length, Oid type)
+{
+	return NSObjectFromPGBinaryValue(bytes, length, type);
+}
+
+static PGValueDecoder PGValueDecoderForType(Oid type, int format)
+{
+	if (format == 0) return PGDecodeString;
+
+	switch (type) {
+		case 25:   // text
+		case 1043: // varchar
+			return PGDecodeString;
+		case 17:   // bytea
+			return PGDecodeBytea;
+		default:
+			return PGDecodeBinary;
+	}
+}
+
+#pragma mark -
+
+@implementation PGResultDescriptor
+
+@synthesize fieldNames = _fieldNames;
+
+- (id)initWithResult:(PGresult *)result
+{
+	return [self initWithResult:result format:-1];
+}
+
+- (id)initWithResult:(PGresult *)result format:(int)format
+{
+	int count = PQnfields(result);
+	Oid types[count ? count : 1];
+	int formats[count ? count : 1];
+	NSMutableArray *names = [NSMutableArray arrayWithCapacity:count];
+
+	for (int i = 0; i < count; i++) {
+		types[i] = PQftype(result, i);
+		formats[i] = (format < 0) ? PQfformat(result, i) : format;
+		[names addObject:[NSString stringWithUTF8String:PQfname(result, i)]];
+	}
+
+	return [self initWithFieldNames:names types:types formats:formats];
+}
+
+- (id)initWithFieldNames:(NSArray *)names types:(const Oid *)types formats:(const int *)formats
+{
+	if (self = [super init]) {
+		_numberOfFields = (int)names.count;
+		_types = calloc(_numberOfFields, sizeof(Oid));
+		_formats = calloc(_numberOfFields, sizeof(int));
+		_decoders = calloc(_numberOfFields, sizeof(PGValueDecoder));
+		_fieldNames = [names copy];
+
+		NSMutableDictionary *indexes = [[NSMutableDictionary alloc] initWithCapacity:_numberOfFields];
+
+		for (int i = 0; i < _numberOfFields; i++) {
+			_types[i] = types[i];
+			_formats[i] = formats[i];
+			_decoders[i] = PGValueDecoderForType(_types[i], _formats[i]);
+
+			NSString *name = names[i];
+			if (![indexes objectForKey:name])	// PQfnumber() also finds the first of duplicates
+				[indexes setObject:@(i) forKey:name];
+		}
+		_fieldIndexes = [indexes copy];
+		[indexes release];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	free(_types);
+	free(_formats);
+	free(_decoders);
+	[_fieldNames release];
+	[_fieldIndexes release];
+	[super dealloc];
+}
+
+- (NSInteger)indexForFieldName:(NSString *)name result:(PGresult *)result
+{
+	NSNumber *index = [_fieldIndexes objectForKey:name];
+
+	if (index) return index.integerValue;
+
+	// quoted or mixed-case names are folded by libpq
+	return result ? PQfnumber(result, name.UTF8String) : -1;
+}
+
+@end
@@ -0,0 +1,45 @@
+//
+//  PGResultSnapshot.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <PGCocoa/PGResult.h>
+
+/** The version written by -writeSnapshotToFile:error: */
+#define PGResultSnapshotVersion 1
+
+/** Saving and loading results in a memory-mappable snapshot file.
+ * @discussion A snapshot holds the field names, types and formats, and each cell's bytes
+ *             exactly as libpq returned them, with an offset table and a NULL bitmap, all
+ *             in little-endian order. Loading maps the file and reads only the header and
+ *             field table, so a result of any size opens immediately; cells are paged in
+ *             as they are accessed. The loaded result supports the PGResult and PGRow
+ *             methods; -pgresult returns NULL.
+ *
+ *             Format, version 1:
+ *
+ *               header       "PGSNAP\0\0", uint32 version, uint32 field count, uint64 row
+ *                            count, and uint64 file offsets of the fields, cell offsets,
+ *                            cell lengths, NULL bitmap and data sections
+ *               fields       per field: uint32 type, uint32 format, uint32 name length,
+ *                            followed by the UTF-8 names
+ *               offsets      uint64 per cell, row-major, relative to the data section
+ *               lengths      uint32 per cell
+ *               nulls        a bit per cell, row-major; 1 for NULL
+ *               data         each value followed by a NUL, padded to 8 bytes
+ */
+@interface PGResult (PGResultSnapshot)
+
+/** Load a snapshot written by -writeSnapshotToFile:error:. */
++ (PGResult *)resultWithContentsOfSnapshotFile:(NSString *)path error:(NSError **)error;
+
+/** Write the result's rows to a snapshot file. The file is written to a temporary name and
+ *  renamed into place. Only results with status kPGResultTuplesOK can be written.
+ */
+- (BOOL)writeSnapshotToFile:(NSString *)path error:(NSError **)error;
+
+@end
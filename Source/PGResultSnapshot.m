@@ -0,0 +1,395 @@
+//
+//  PGResultSnapshot.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGResultSnapshot.h"
+#import "PGConnection.h"
+#import "PGResultDescriptor.h"
+#import "PGInternal.h"
+#import <libkern/OSByteOrder.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <fcntl.h>
+
+static const char PGSnapshotMagic[8] = "PGSNAP\0";
+
+typedef struct {
+	char     magic[8];
+	uint32_t version;
+	uint32_t numberOfFields;
+	uint64_t numberOfRows;
+	uint64_t fieldsOffset;
+	uint64_t offsetsOffset;
+	uint64_t lengthsOffset;
+	uint64_t nullsOffset;
+	uint64_t dataOffset;
+	uint64_t dataLength;
+} PGSnapshotHeader;
+
+#define PGSnapshotAlign(n) (((n) + 7) & ~(uint64_t)7)
+
+static NSError *PGSnapshotError(NSString *path, NSString *reason)
+{
+	NSDictionary *info = @{ NSLocalizedDescriptionKey : [NSString stringWithFormat:@"The snapshot \"%@\" could not be used.", path.lastPathComponent],
+							NSLocalizedFailureReasonErrorKey : reason,
+							NSFilePathErrorKey : path };
+
+	return [NSError errorWithDomain:PostgreSQLErrorDomain code:-1 userInfo:info];
+}
+
+#pragma mark -
+
+/** A file mapped read-only with mmap(), so its pages are always loaded on demand. */
+@interface PGMappedFileData : NSData
+{
+	void *_bytes;
+	NSUInteger _length;
+}
+- (id)_initWithContentsOfFile:(NSString *)path error:(NSError **)error;
+@end
+
+@implementation PGMappedFileData
+
+- (id)_initWithContentsOfFile:(NSString *)path error:(NSError **)error
+{
+	if (!(self = [super init])) return nil;
+
+	int fd = open(path.fileSystemRepresentation, O_RDONLY);
+	struct stat info;
+
+	if (fd >= 0 && fstat(fd, &info) == 0) {
+		_length = (NSUInteger)info.st_size;
+		_bytes = _length ? mmap(NULL, _length, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+	}
+	else {
+		_bytes = MAP_FAILED;
+	}
+
+	if (_bytes == MAP_FAILED) {
+		if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{ NSFilePathErrorKey : path }];
+		_bytes = NULL;
+		_length = 0;
+		if (fd >= 0) close(fd);
+		[self release];
+		return nil;
+	}
+
+	close(fd);	// the mapping outlives the descriptor
+	return self;
+}
+
+- (void)dealloc
+{
+	if (_bytes) munmap(_bytes, _length);
+	[super dealloc];
+}
+
+- (NSUInteger)length      { return _length; }
+- (const void *)bytes     { return _bytes; }
+
+@end
+
+#pragma mark -
+
+/** A result backed by a mapped snapshot file rather than a PGresult. */
+@interface PGSnapshotResult : PGResult
+{
+	NSData *_file;
+	const PGSnapshotHeader *_header;
+	NSUInteger _numberOfRows;
+	const uint64_t *_offsets;
+	const uint32_t *_lengths;
+	const uint8_t *_nulls;
+	char *_data;
+}
+
+- (id)_initWithMappedFile:(NSData *)file path:(NSString *)path error:(NSError **)error;
+
+@end
+
+@implementation PGSnapshotResult
+
+- (id)_initWithMappedFile:(NSData *)file path:(NSString *)path error:(NSError **)error
+{
+	if (!(self = [super _initWithResult:NULL])) return nil;
+
+	_file = [file retain];
+	_header = file.bytes;
+
+	uint64_t fileLength = file.length;
+	NSString *reason = nil;
+
+	if (fileLength < sizeof(PGSnapshotHeader) || memcmp(_header->magic, PGSnapshotMagic, sizeof(PGSnapshotMagic)) != 0)
+		reason = @"The file is not a result snapshot.";
+	else if (OSSwapLittleToHostInt32(_header->version) != PGResultSnapshotVersion)
+		reason = [NSString stringWithFormat:@"The snapshot version %u is not supported.", OSSwapLittleToHostInt32(_header->version)];
+
+	uint32_t numberOfFields = OSSwapLittleToHostInt32(_header->numberOfFields);
+	uint64_t numberOfRows = OSSwapLittleToHostInt64(_header->numberOfRows);
+	uint64_t fieldsOffset = OSSwapLittleToHostInt64(_header->fieldsOffset);
+	uint64_t offsetsOffset = OSSwapLittleToHostInt64(_header->offsetsOffset);
+	uint64_t lengthsOffset = OSSwapLittleToHostInt64(_header->lengthsOffset);
+	uint64_t nullsOffset = OSSwapLittleToHostInt64(_header->nullsOffset);
+	uint64_t dataOffset = OSSwapLittleToHostInt64(_header->dataOffset);
+	uint64_t dataLength = OSSwapLittleToHostInt64(_header->dataLength);
+	uint64_t cells = 0;
+
+	// Check the sections' bounds, not the cells, so opening never touches the data
+	if (!reason) {
+		if (numberOfFields > INT_MAX || (numberOfFields && numberOfRows > fileLength / numberOfFields))
+			reason = @"The snapshot is truncated or damaged.";
+		else {
+			cells = numberOfRows * numberOfFields;
+
+			if (!(sizeof(PGSnapshotHeader) <= fieldsOffset && fieldsOffset <= offsetsOffset && offsetsOffset <= lengthsOffset
+				  && lengthsOffset <= nullsOffset && nullsOffset <= dataOffset && dataOffset <= fileLength)
+				|| cells * 8 > lengthsOffset - offsetsOffset || cells * 4 > nullsOffset - lengthsOffset
+				|| (cells + 7) / 8 > dataOffset - nullsOffset || dataLength > fileLength - dataOffset
+				|| (offsetsOffset & 7) || (dataOffset & 7))
+				reason = @"The snapshot is truncated or damaged.";
+		}
+	}
+
+	if (reason) numberOfFields = 0;
+
+	NSMutableArray *names = [NSMutableArray arrayWithCapacity:numberOfFields];
+	Oid types[numberOfFields ? numberOfFields : 1];
+	int formats[numberOfFields ? numberOfFields : 1];
+	const uint8_t *field = (const uint8_t *)file.bytes + fieldsOffset;
+	const uint8_t *fieldsEnd = (const uint8_t *)file.bytes + offsetsOffset;
+
+	for (uint32_t i = 0; !reason && i < numberOfFields; i++) {
+		uint32_t entry[3];
+
+		if (field + sizeof(entry) > fieldsEnd) { reason = @"The field table is damaged."; break; }
+		memcpy(entry, field, sizeof(entry));
+		field += sizeof(entry);
+
+		types[i] = OSSwapLittleToHostInt32(entry[0]);
+		formats[i] = OSSwapLittleToHostInt32(entry[1]);
+		uint32_t nameLength = OSSwapLittleToHostInt32(entry[2]);
+
+		if (field + nameLength > fieldsEnd) { reason = @"The field table is damaged."; break; }
+
+		NSString *name = [[NSString alloc] initWithBytes:field length:nameLength encoding:NSUTF8StringEncoding];
+		[names addObject:name ? name : @""];
+		[name release];
+		field += nameLength;
+	}
+
+	if (reason) {
+		if (error) *error = PGSnapshotError(path, reason);
+		[self release];
+		return nil;
+	}
+
+	_descriptor = [[PGResultDescriptor alloc] initWithFieldNames:names types:types formats:formats];
+	_numberOfRows = (NSUInteger)numberOfRows;
+	_offsets = (const uint64_t *)((const char *)file.bytes + offsetsOffset);
+	_lengths = (const uint32_t *)((const char *)file.bytes + lengthsOffset);
+	_nulls = (const uint8_t *)file.bytes + nullsOffset;
+	_data = (char *)file.bytes + dataOffset;
+
+	return self;
+}
+
+- (void)dealloc
+{
+	[_file release];
+	[super dealloc];
+}
+
+- (NSUInteger)numberOfFields
+{
+	return _descriptor->_numberOfFields;
+}
+
+- (NSUInteger)numberOfRows
+{
+	return _numberOfRows;
+}
+
+- (NSUInteger)numberOfAffectedRows
+{
+	return _numberOfRows;
+}
+
+- (PGExecStatusType)status
+{
+	return kPGResultTuplesOK;
+}
+
+- (NSUInteger)memorySize
+{
+	return 0;	// mapped from the file, not allocated
+}
+
+- (const char *)_bytesAtRowIndex:(NSUInteger)rowNum fieldIndex:(NSUInteger)fieldNum length:(int *)length
+{
+	if (rowNum >= _numberOfRows || fieldNum >= (NSUInteger)_descriptor->_numberOfFields)
+		return NULL;  // as PQgetisnull() reports out-of-range cells
+
+	uint64_t cell = (uint64_t)rowNum * _descriptor->_numberOfFields + fieldNum;
+
+	if (_nulls[cell / 8] & (1 << (cell % 8)))
+		return NULL;
+
+	uint64_t offset = OSSwapLittleToHostInt64(_offsets[cell]);
+	uint32_t cellLength = OSSwapLittleToHostInt32(_lengths[cell]);
+
+	if (offset + cellLength >= OSSwapLittleToHostInt64(_header->dataLength) || cellLength > INT_MAX)
+		[NSException raise:NSInternalInconsistencyException format:@"snapshot cell (%lu, %lu) is out of bounds", (unsigned long)rowNum, (unsigned long)fieldNum];
+
+	*length = (int)cellLength;
+	return _data + offset;
+}
+
+- (id)valueAtRowIndex:(NSUInteger)rowNum fieldIndex:(NSUInteger)fieldNum
+{
+	int length;
+	const char *bytes = [self _bytesAtRowIndex:rowNum fieldIndex:fieldNum length:&length];
+
+	if (!bytes)
+		return [NSNull null];
+
+	return _descriptor->_decoders[fieldNum](self, (char *)bytes, length, _descriptor->_types[fieldNum]);
+}
+
+@end
+
+#pragma mark -
+
+@implementation PGResult (PGResultSnapshot)
+
++ (PGResult *)resultWithContentsOfSnapshotFile:(NSString *)path error:(NSError **)error
+{
+	NSData *file = [[[PGMappedFileData alloc] _initWithContentsOfFile:path error:error] autorelease];
+	if (!file) return nil;
+
+	return [[[PGSnapshotResult alloc] _initWithMappedFile:file path:path error:error] autorelease];
+}
+
+static BOOL PGSnapshotWrite(FILE *fp, const void *bytes, size_t length)
+{
+	return length == 0 || fwrite(bytes, length, 1, fp) == 1;
+}
+
+- (BOOL)writeSnapshotToFile:(NSString *)path error:(NSError **)error
+{
+	if (self.status != kPGResultTuplesOK || self.pgresult == NULL) {
+		if (error) *error = PGSnapshotError(path, @"Only results with rows received from the server can be saved.");
+		return NO;
+	}
+
+	PGResultDescriptor *descriptor = self._descriptor;
+	uint32_t numberOfFields = descriptor->_numberOfFields;
+	uint64_t numberOfRows = self.numberOfRows;
+	uint64_t cells = numberOfRows * numberOfFields;
+
+	// Field table
+
+	NSMutableData *fields = [NSMutableData data];
+	for (uint32_t i = 0; i < numberOfFields; i++) {
+		NSData *name = [descriptor->_fieldNames[i] dataUsingEncoding:NSUTF8StringEncoding];
+		uint32_t entry[3] = { OSSwapHostToLittleInt32(descriptor->_types[i]),
+							  OSSwapHostToLittleInt32(descriptor->_formats[i]),
+							  OSSwapHostToLittleInt32((uint32_t)name.length) };
+		[fields appendBytes:entry length:sizeof(entry)];
+		[fields appendData:name];
+	}
+
+	PGSnapshotHeader header = { { 0 } };
+	memcpy(header.magic, PGSnapshotMagic, sizeof(PGSnapshotMagic));
+	header.version = OSSwapHostToLittleInt32(PGResultSnapshotVersion);
+	header.numberOfFields = OSSwapHostToLittleInt32(numberOfFields);
+	header.numberOfRows = OSSwapHostToLittleInt64(numberOfRows);
+
+	uint64_t fieldsOffset = sizeof(header);
+	uint64_t offsetsOffset = PGSnapshotAlign(fieldsOffset + fields.length);
+	uint64_t lengthsOffset = offsetsOffset + cells * 8;
+	uint64_t nullsOffset = lengthsOffset + cells * 4;
+	uint64_t dataOffset = PGSnapshotAlign(nullsOffset + (cells + 7) / 8);
+
+	NSString *tempPath = [path stringByAppendingFormat:@".%d.tmp", getpid()];
+	FILE *fp = fopen(tempPath.fileSystemRepresentation, "w+");
+	if (!fp) {
+		if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{ NSFilePathErrorKey : tempPath }];
+		return NO;
+	}
+
+	PGresult *result = self.pgresult;
+	static const char padding[8] = { 0 };
+	BOOL success = (fseeko(fp, offsetsOffset, SEEK_SET) == 0);
+
+	// Offsets and lengths are computed from PQgetlength() without reading the data, then
+	// the data is written in a second pass.
+
+	uint64_t dataLength = 0;
+	for (uint64_t cell = 0; success && cell < cells; cell++) {
+		int row = (int)(cell / numberOfFields), field = (int)(cell % numberOfFields);
+		uint64_t offset = OSSwapHostToLittleInt64(dataLength);
+
+		success = PGSnapshotWrite(fp, &offset, sizeof(offset));
+		if (!PQgetisnull(result, row, field))
+			dataLength += PGSnapshotAlign((uint64_t)PQgetlength(result, row, field) + 1);
+	}
+	for (uint64_t cell = 0; success && cell < cells; cell++) {
+		uint32_t length = OSSwapHostToLittleInt32(PQgetlength(result, (int)(cell / numberOfFields), (int)(cell % numberOfFields)));
+		success = PGSnapshotWrite(fp, &length, sizeof(length));
+	}
+	for (uint64_t cell = 0; success && cell < cells; cell += 8) {
+		uint8_t bits = 0;
+		for (uint64_t bit = 0; bit < 8 && cell + bit < cells; bit++) {
+			if (PQgetisnull(result, (int)((cell + bit) / numberOfFields), (int)((cell + bit) % numberOfFields)))
+				bits |= 1 << bit;
+		}
+		success = PGSnapshotWrite(fp, &bits, 1);
+	}
+
+	success = success && fseeko(fp, dataOffset, SEEK_SET) == 0;
+
+	for (uint64_t cell = 0; success && cell < cells; cell++) {
+		int row = (int)(cell / numberOfFields), field = (int)(cell % numberOfFields);
+		if (PQgetisnull(result, row, field)) continue;
+
+		size_t length = PQgetlength(result, row, field);
+		success = PGSnapshotWrite(fp, PQgetvalue(result, row, field), length)
+			&& PGSnapshotWrite(fp, padding, PGSnapshotAlign(length + 1) - length);
+	}
+
+	// The header is written last, so an interrupted write never looks like a snapshot
+
+	header.fieldsOffset = OSSwapHostToLittleInt64(fieldsOffset);
+	header.offsetsOffset = OSSwapHostToLittleInt64(offsetsOffset);
+	header.lengthsOffset = OSSwapHostToLittleInt64(lengthsOffset);
+	header.nullsOffset = OSSwapHostToLittleInt64(nullsOffset);
+	header.dataOffset = OSSwapHostToLittleInt64(dataOffset);
+	header.dataLength = OSSwapHostToLittleInt64(dataLength);
+
+	success = success && fseeko(fp, 0, SEEK_SET) == 0
+		&& PGSnapshotWrite(fp, &header, sizeof(header))
+		&& PGSnapshotWrite(fp, fields.bytes, fields.length);
+
+	int writeErrno = errno;
+	if (fclose(fp) != 0 && success) {
+		success = NO;
+		writeErrno = errno;
+	}
+
+	if (success && rename(tempPath.fileSystemRepresentation, path.fileSystemRepresentation) != 0) {
+		success = NO;
+		writeErrno = errno;
+	}
+
+	if (!success) {
+		unlink(tempPath.fileSystemRepresentation);
+		if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:writeErrno userInfo:@{ NSFilePathErrorKey : path }];
+	}
+	return success;
+}
+
+@end
@@ -0,0 +1,38 @@
+//
+//  PGResultString.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class PGResult;
+
+/** An immutable string backed by a UTF-8 value inside a PGresult.
+ * @discussion The bytes are not copied; the string retains the owning PGResult so the
+ *             value remains valid. Values that are entirely ASCII are accessed directly.
+ *             Other values are transcoded to a backing NSString the first time their
+ *             characters are needed; bytes that aren't valid UTF-8 are read as ISO Latin 1.
+ *             Since each string keeps its result alive, copy a string that must outlive a
+ *             large result: the copy is an ordinary NSString.
+ */
+@interface PGResultString : NSString
+{
+	PGResult *_owner;
+	const char *_bytes;
+	NSUInteger _byteLength;
+	BOOL _isASCII;
+	NSString *_backing;		// created lazily for non-ASCII values
+	BOOL _isLatin1;			// the bytes aren't valid UTF-8
+}
+
++ (id)_stringWithBytes:(const char *)bytes length:(NSUInteger)length owner:(PGResult *)owner;
+
+- (id)_initWithBytes:(const char *)bytes length:(NSUInteger)length owner:(PGResult *)owner;
+
+@end
+
+/** Returns YES if none of the bytes has the high bit set. */
+BOOL PGBytesAreASCII(const char *bytes, NSUInteger length);
@@ -0,0 +1,165 @@
+//
+//  PGResultString.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGResultString.h"
+#import "PGResult.h"
+#import <libkern/OSAtomic.h>
+
+@implementation PGResultString
+
++ (id)_stringWithBytes:(const char *)bytes length:(NSUInteger)length owner:(PGResult *)owner
+{
+	return [[[PGResultString alloc] _initWithBytes:bytes length:length owner:owner] autorelease];
+}
+
+- (id)_initWithBytes:(const char *)bytes length:(NSUInteger)length owner:(PGResult *)owner
+{
+	if (self = [super init]) {
+		_owner = [owner retain];
+		_bytes = bytes;
+		_byteLength = length;
+		_isASCII = PGBytesAreASCII(bytes, length);
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[_backing release];
+	[_owner release];
+	[super dealloc];
+}
+
+- (NSString *)_backing
+{
+	NSString *backing = _backing;
+	if (backing) return backing;
+
+	backing = [[NSString alloc] initWithBytes:_bytes length:_byteLength encoding:NSUTF8StringEncoding];
+	if (!backing) {
+		// invalid UTF-8, e.g., from a SQL_ASCII database; every byte is a Latin 1 character
+		backing = [[NSString alloc] initWithBytes:_bytes length:_byteLength encoding:NSISOLatin1StringEncoding];
+		_isLatin1 = YES;
+	}
+
+	// Publish with a barrier, so another thread sees the string and _isLatin1 complete.
+	if (!OSAtomicCompareAndSwapPtrBarrier(nil, backing, (void * volatile *)&_backing))
+		[backing release];
+
+	return _backing;
+}
+
+/** Whether the bytes are something other than the string's UTF-8 representation. */
+- (BOOL)_isLatin1
+{
+	if (_isASCII) return NO;
+
+	[self _backing];
+	OSMemoryBarrier();
+	return _isLatin1;
+}
+
+#pragma mark NSString Primitives
+
+- (NSUInteger)length
+{
+	return _isASCII ? _byteLength : self._backing.length;
+}
+
+- (unichar)characterAtIndex:(NSUInteger)index
+{
+	if (!_isASCII)
+		return [self._backing characterAtIndex:index];
+
+	if (index >= _byteLength)
+		[NSException raise:NSRangeException format:@"Index %lu out of bounds; string length %lu", (unsigned long)index, (unsigned long)_byteLength];
+
+	return (unichar)_bytes[index];
+}
+
+- (void)getCharacters:(unichar *)buffer range:(NSRange)range
+{
+	if (!_isASCII) {
+		[self._backing getCharacters:buffer range:range];
+		return;
+	}
+
+	if (NSMaxRange(range) > _byteLength)
+		[NSException raise:NSRangeException format:@"Range %@ out of bounds; string length %lu", NSStringFromRange(range), (unsigned long)_byteLength];
+
+	const char *src = _bytes + range.location;
+	for (NSUInteger i = 0; i < range.length; i++)
+		buffer[i] = (unichar)src[i];
+}
+
+#pragma mark Fast Paths
+
+- (const char *)UTF8String
+{
+	if (self._isLatin1)
+		return self._backing.UTF8String;
+
+	// libpq terminates every value, so the bytes can be returned directly.
+	return _bytes;
+}
+
+- (NSUInteger)lengthOfBytesUsingEncoding:(NSStringEncoding)encoding
+{
+	if ((encoding == NSUTF8StringEncoding && !self._isLatin1) || (_isASCII && encoding == NSASCIIStringEncoding))
+		return _byteLength;
+
+	return [super lengthOfBytesUsingEncoding:encoding];
+}
+
+- (BOOL)isEqualToString:(NSString *)other
+{
+	if ([other isKindOfClass:PGResultString.class]) {
+		PGResultString *string = (PGResultString *)other;
+		if (!self._isLatin1 && !string._isLatin1)
+			return _byteLength == string->_byteLength && memcmp(_bytes, string->_bytes, _byteLength) == 0;
+	}
+	return [super isEqualToString:other];
+}
+
+- (BOOL)isEqual:(id)other
+{
+	if (other == self) return YES;
+	if (![other isKindOfClass:NSString.class]) return NO;
+
+	return [self isEqualToString:other];
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	// an ordinary string, which doesn't keep the result alive
+	if (_isASCII)
+		return [[NSString allocWithZone:zone] initWithBytes:_bytes length:_byteLength encoding:NSASCIIStringEncoding];
+
+	return [self._backing copyWithZone:zone];
+}
+
+@end
+
+BOOL PGBytesAreASCII(const char *bytes, NSUInteger length)
+{
+	const uint8_t *p = (const uint8_t *)bytes;
+	NSUInteger i = 0;
+
+	// Test a word at a time, then the remaining bytes.
+	for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, p + i, sizeof(word));
+		if (word & 0x8080808080808080ULL)
+			return NO;
+	}
+	for (; i < length; i++) {
+		if (p[i] & 0x80)
+			return NO;
+	}
+	return YES;
+}
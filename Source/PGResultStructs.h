@@ -0,0 +1,83 @@
+//
+//  PGResultStructs.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <PGCocoa/PGResult.h>
+#include <stddef.h>
+
+/** The C type of a struct member filled from a column. */
+typedef enum {
+	kPGStructFieldBool = 0,		///< bool; from bool
+	kPGStructFieldInt16,		///< int16_t; from int2
+	kPGStructFieldInt32,		///< int32_t; from int2 and int4
+	kPGStructFieldInt64,		///< int64_t; from int2, int4, int8 and oid
+	kPGStructFieldFloat,		///< float; from int2 and float4
+	kPGStructFieldDouble,		///< double; from int2, int4, int8, float4, float8 and numeric
+	kPGStructFieldTimeInterval,	///< NSTimeInterval since the reference date; from binary timestamp, timestamptz and date
+	kPGStructFieldString		///< char[size], NUL-terminated and truncated to fit; from any text value
+} PGStructFieldType;
+
+/** Marks a field without a NULL flag. */
+#define PGStructNoNullFlag ((size_t)-1)
+
+/** Maps one column to a member of the caller's struct. */
+typedef struct {
+	const char *name;			///< the column name, or NULL to use column
+	NSUInteger column;			///< the column index, if name is NULL
+	PGStructFieldType type;
+	size_t offset;				///< offsetof() the member
+	size_t size;				///< sizeof() the member; the capacity of a string
+	size_t nullOffset;			///< offsetof() a bool member set for NULL, or PGStructNoNullFlag
+} PGStructField;
+
+/** A field for a member that is zeroed for NULL. */
+#define PGStructFieldMake(columnName, structType, member, fieldType) \
+	{ (columnName), 0, (fieldType), offsetof(structType, member), sizeof(((structType *)0)->member), PGStructNoNullFlag }
+
+/** A field for a member whose NULLs also set a bool member. */
+#define PGStructFieldMakeNullable(columnName, structType, member, fieldType, nullMember) \
+	{ (columnName), 0, (fieldType), offsetof(structType, member), sizeof(((structType *)0)->member), offsetof(structType, nullMember) }
+
+/** Decoding rows into an array of C structs, without creating objects.
+ * @discussion Each field's column and conversion are chosen once per call, then every cell
+ *             is read from the result's bytes and written to its member with a typed store.
+ *             Binary values are byte-swapped in place; text values are parsed with strtoll()
+ *             and strtod(). A NULL zeroes its member and sets its flag, if it has one.
+ *
+ *             Decode in chunks of a few thousand rows into a reused buffer to iterate a
+ *             large result while touching little memory beyond the result itself:
+ *
+ *                 typedef struct { int64_t id; double price; bool priceIsNull; char name[32]; } Item;
+ *                 static const PGStructField fields[] = {
+ *                     PGStructFieldMake("id", Item, id, kPGStructFieldInt64),
+ *                     PGStructFieldMakeNullable("price", Item, price, kPGStructFieldDouble, priceIsNull),
+ *                     PGStructFieldMake("name", Item, name, kPGStructFieldString)
+ *                 };
+ *                 Item items[1024];
+ *
+ *                 for (NSUInteger row = 0; row < result.numberOfRows; row += 1024) {
+ *                     NSRange range = NSMakeRange(row, MIN(1024, result.numberOfRows - row));
+ *                     if (![result getStructs:items stride:sizeof(Item) range:range fields:fields count:3 error:&error])
+ *                         break;
+ *                     ...
+ *                 }
+ */
+@interface PGResult (PGResultStructs)
+
+/** Fill an array of structs from a range of rows.
+ * @param structs room for range.length structs
+ * @param stride the size of each struct, usually sizeof() it
+ * @param fields the members to fill; other members are not written
+ * @return NO if a column is missing, its type can't be converted to its member's, or a
+ *         member's size doesn't match its type. No struct is written.
+ * @throws NSRangeException if the range extends beyond the rows
+ */
+- (BOOL)getStructs:(void *)structs stride:(size_t)stride range:(NSRange)range
+			fields:(const PGStructField *)fields count:(NSUInteger)count error:(NSError **)error;
+
+@end
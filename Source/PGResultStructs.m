@@ -0,0 +1,327 @@
+//
+//  PGResultStructs.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGResultStructs.h"
+#import "PGResultDescriptor.h"
+#import "PGError.h"
+#import "PGInternal.h"
+#include <math.h>
+#include <stdbool.h>
+
+/** How a column's values are read. */
+typedef enum {
+	kPGStructSourceBinaryBool = 0,
+	kPGStructSourceBinaryInt16,
+	kPGStructSourceBinaryInt32,
+	kPGStructSourceBinaryInt64,
+	kPGStructSourceBinaryOid,		// unsigned, widened without sign extension
+	kPGStructSourceBinaryFloat,
+	kPGStructSourceBinaryDouble,
+	kPGStructSourceBinaryNumeric,
+	kPGStructSourceBinaryTimestamp,
+	kPGStructSourceBinaryDate,
+	kPGStructSourceTextInteger,		// parsed with strtoll()
+	kPGStructSourceTextFloat,		// parsed with strtod()
+	kPGStructSourceTextBool,
+	kPGStructSourceString			// copied
+} PGStructSource;
+
+typedef struct {
+	int column;
+	PGStructSource source;
+	PGStructFieldType type;
+	size_t offset;
+	size_t size;
+	size_t nullOffset;
+} PGStructBinding;
+
+#pragma mark -
+
+static NSError *PGStructError(NSString *reason)
+{
+	NSDictionary *info = @{ NSLocalizedDescriptionKey : @"The rows could not be decoded.",
+							NSLocalizedFailureReasonErrorKey : reason };
+
+	return [NSError errorWithDomain:PostgreSQLErrorDomain code:-1 userInfo:info];
+}
+
+static size_t PGStructFieldSize(PGStructFieldType type)
+{
+	switch (type) {
+		case kPGStructFieldBool:         return sizeof(bool);
+		case kPGStructFieldInt16:        return sizeof(int16_t);
+		case kPGStructFieldInt32:        return sizeof(int32_t);
+		case kPGStructFieldInt64:        return sizeof(int64_t);
+		case kPGStructFieldFloat:        return sizeof(float);
+		case kPGStructFieldDouble:       return sizeof(double);
+		case kPGStructFieldTimeInterval: return sizeof(NSTimeInterval);
+		case kPGStructFieldString:       return 0;	// any capacity
+	}
+	return 0;
+}
+
+/** The source for a column, or -1 if its type can't be stored to the member. */
+static int PGStructSourceForType(Oid type, int format, PGStructFieldType destination)
+{
+	if (destination == kPGStructFieldString) {
+		if (format == 0)
+			return kPGStructSourceString;
+
+		switch (type) {
+			case 19:    // name
+			case 25:    // text
+			case 114:   // json
+			case 1042:  // bpchar
+			case 1043:  // varchar
+				return kPGStructSourceString;
+			default:
+				return -1;
+		}
+	}
+
+	BOOL integer = NO, real = NO;
+
+	switch (destination) {
+		case kPGStructFieldBool:
+			if (type != 16) return -1;
+			return format ? kPGStructSourceBinaryBool : kPGStructSourceTextBool;
+		case kPGStructFieldInt16:
+			integer = (type == 21);
+			break;
+		case kPGStructFieldInt32:
+			integer = (type == 21 || type == 23);
+			break;
+		case kPGStructFieldInt64:
+			integer = (type == 20 || type == 21 || type == 23 || type == 26);
+			break;
+		case kPGStructFieldFloat:
+			integer = (type == 21);
+			real = (type == 700);
+			break;
+		case kPGStructFieldDouble:
+			integer = (type == 20 || type == 21 || type == 23);
+			real = (type == 700 || type == 701 || type == 1700);
+			break;
+		case kPGStructFieldTimeInterval:
+			// Text timestamps depend on DateStyle and TimeZone; only binary ones are read
+			if (format == 0) return -1;
+			if (type == 1114 || type == 1184) return kPGStructSourceBinaryTimestamp;
+			if (type == 1082) return kPGStructSourceBinaryDate;
+			return -1;
+		default:
+			return -1;
+	}
+
+	if (!integer && !real)
+		return -1;
+	if (format == 0)
+		return integer ? kPGStructSourceTextInteger : kPGStructSourceTextFloat;
+
+	switch (type) {
+		case 21:   return kPGStructSourceBinaryInt16;
+		case 23:   return kPGStructSourceBinaryInt32;
+		case 26:   return kPGStructSourceBinaryOid;
+		case 20:   return kPGStructSourceBinaryInt64;
+		case 700:  return kPGStructSourceBinaryFloat;
+		case 701:  return kPGStructSourceBinaryDouble;
+		case 1700: return kPGStructSourceBinaryNumeric;
+	}
+	return -1;
+}
+
+/** Approximate a binary numeric as a double: base 10000 digits, the first at 10000^weight. */
+static double PGDoubleFromNumeric(const pg_numeric_t *numeric)
+{
+	int16_t ndigits = NSSwapBigShortToHost(numeric->ndigits);
+	int16_t weight = NSSwapBigShortToHost(numeric->nweight);
+	uint16_t sign = NSSwapBigShortToHost(numeric->negative);
+	const uint16_t *digits = numeric->digits;	// ndigits long, which may exceed the declared array
+	double value = 0.0;
+
+	switch (sign) {
+		case 0xC000: return NAN;
+		case 0xD000: return INFINITY;	// PostgreSQL 14
+		case 0xF000: return -INFINITY;
+	}
+
+	for (int i = 0; i < ndigits; i++)
+		value = value * 10000.0 + NSSwapBigShortToHost(digits[i]);
+
+	value *= pow(10000.0, weight - ndigits + 1);
+
+	return (sign == 0x4000) ? -value : value;
+}
+
+static inline void PGStructStoreInteger(char *member, PGStructFieldType type, int64_t value)
+{
+	switch (type) {
+		case kPGStructFieldBool:   *(bool *)member = (value != 0); break;
+		case kPGStructFieldInt16:  *(int16_t *)member = (int16_t)value; break;
+		case kPGStructFieldInt32:  *(int32_t *)member = (int32_t)value; break;
+		case kPGStructFieldInt64:  *(int64_t *)member = value; break;
+		case kPGStructFieldFloat:  *(float *)member = (float)value; break;
+		case kPGStructFieldDouble: *(double *)member = (double)value; break;
+		default: break;
+	}
+}
+
+static inline void PGStructStoreDouble(char *member, PGStructFieldType type, double value)
+{
+	if (type == kPGStructFieldFloat)
+		*(float *)member = (float)value;
+	else
+		*(double *)member = value;
+}
+
+/** Choose each field's column and conversion, once per call. */
+static BOOL PGGetStructBindings(PGResult *result, PGStructBinding *bindings, const PGStructField *fields, NSUInteger count, NSError **error)
+{
+	PGResultDescriptor *descriptor = result._descriptor;
+
+	for (NSUInteger i = 0; i < count; i++) {
+		const PGStructField *field = &fields[i];
+		PGStructBinding *binding = &bindings[i];
+		NSInteger column = field->column;
+
+		if (field->name) {
+			NSString *name = [NSString stringWithUTF8String:field->name];
+			column = [descriptor indexForFieldName:name result:result.pgresult];
+		}
+		if (column < 0 || column >= descriptor->_numberOfFields) {
+			if (error) *error = PGStructError(field->name ? [NSString stringWithFormat:@"The result has no column \"%s\".", field->name]
+														  : [NSString stringWithFormat:@"The result has no column %lu.", (unsigned long)field->column]);
+			return NO;
+		}
+
+		size_t expected = PGStructFieldSize(field->type);
+		if ((expected && field->size != expected) || (field->type == kPGStructFieldString && field->size == 0)) {
+			if (error) *error = PGStructError([NSString stringWithFormat:@"The member for column %ld has the wrong size.", (long)column]);
+			return NO;
+		}
+
+		int source = PGStructSourceForType(descriptor->_types[column], descriptor->_formats[column], field->type);
+		if (source < 0) {
+			if (error) *error = PGStructError([NSString stringWithFormat:@"Column %ld, of type %u, can't be stored to its member.",
+											   (long)column, descriptor->_types[column]]);
+			return NO;
+		}
+
+		binding->column = (int)column;
+		binding->source = source;
+		binding->type = field->type;
+		binding->offset = field->offset;
+		binding->size = field->size;
+		binding->nullOffset = field->nullOffset;
+	}
+	return YES;
+}
+
+#pragma mark -
+
+@implementation PGResult (PGResultStructs)
+
+- (BOOL)getStructs:(void *)structs stride:(size_t)stride range:(NSRange)range
+			fields:(const PGStructField *)fields count:(NSUInteger)count error:(NSError **)error
+{
+	if (NSMaxRange(range) > self.numberOfRows)
+		[NSException raise:NSRangeException format:@"Range %@ extends beyond %lu rows", NSStringFromRange(range), (unsigned long)self.numberOfRows];
+
+	PGStructBinding *bindings = malloc((count ? count : 1) * sizeof(PGStructBinding));
+
+	if (!PGGetStructBindings(self, bindings, fields, count, error)) {
+		free(bindings);
+		return NO;
+	}
+
+	SEL getBytesSel = @selector(_bytesAtRowIndex:fieldIndex:length:);
+	const char *(*getBytes)(id, SEL, NSUInteger, NSUInteger, int *) = (void *)[self methodForSelector:getBytesSel];
+	char *record = structs;
+
+	for (NSUInteger row = range.location; row < NSMaxRange(range); row++, record += stride) {
+		for (NSUInteger i = 0; i < count; i++) {
+			const PGStructBinding *binding = &bindings[i];
+			char *member = record + binding->offset;
+			int length = 0;
+			const char *bytes = getBytes(self, getBytesSel, row, binding->column, &length);
+
+			if (binding->nullOffset != PGStructNoNullFlag)
+				*(bool *)(record + binding->nullOffset) = (bytes == NULL);
+
+			if (!bytes) {
+				memset(member, 0, binding->size);
+				continue;
+			}
+
+			const pg_valueref_t value = { .string = (char *)bytes };
+			int32_t tmp32;
+			int64_t tmp64;
+
+			switch (binding->source) {
+				case kPGStructSourceBinaryBool:
+					*(bool *)member = (value.bytes[0] != 0);
+					break;
+				case kPGStructSourceBinaryInt16:
+					PGStructStoreInteger(member, binding->type, (int16_t)NSSwapBigShortToHost(*value.val16));
+					break;
+				case kPGStructSourceBinaryInt32:
+					PGStructStoreInteger(member, binding->type, (int32_t)NSSwapBigIntToHost(*value.val32));
+					break;
+				case kPGStructSourceBinaryOid:
+					PGStructStoreInteger(member, binding->type, (uint32_t)NSSwapBigIntToHost(*value.val32));
+					break;
+				case kPGStructSourceBinaryInt64:
+					PGStructStoreInteger(member, binding->type, (int64_t)NSSwapBigLongLongToHost(*value.val64));
+					break;
+				case kPGStructSourceBinaryFloat:
+					tmp32 = NSSwapBigIntToHost(*value.val32);
+					PGStructStoreDouble(member, binding->type, *(float *)&tmp32);
+					break;
+				case kPGStructSourceBinaryDouble:
+					tmp64 = NSSwapBigLongLongToHost(*value.val64);
+					*(double *)member = *(double *)&tmp64;
+					break;
+				case kPGStructSourceBinaryNumeric:
+					*(double *)member = PGDoubleFromNumeric(value.numeric);
+					break;
+				case kPGStructSourceBinaryTimestamp:
+					// int64 microseconds since 1/1/2000; the extremes are infinity and -infinity
+					tmp64 = NSSwapBigLongLongToHost(*value.val64);
+					if (tmp64 == INT64_MAX)      *(double *)member = INFINITY;
+					else if (tmp64 == INT64_MIN) *(double *)member = -INFINITY;
+					else                         *(double *)member = tmp64 / 1000000.0 - 31622400.0;
+					break;
+				case kPGStructSourceBinaryDate:
+					// int32 days since 1/1/2000
+					tmp32 = NSSwapBigIntToHost(*value.val32);
+					if (tmp32 == INT32_MAX)      *(double *)member = INFINITY;
+					else if (tmp32 == INT32_MIN) *(double *)member = -INFINITY;
+					else                         *(double *)member = tmp32 * 86400.0 - 31622400.0;
+					break;
+				case kPGStructSourceTextInteger:
+					PGStructStoreInteger(member, binding->type, strtoll(bytes, NULL, 10));
+					break;
+				case kPGStructSourceTextFloat:
+					PGStructStoreDouble(member, binding->type, strtod(bytes, NULL));
+					break;
+				case kPGStructSourceTextBool:
+					*(bool *)member = (bytes[0] == 't');
+					break;
+				case kPGStructSourceString:
+					if ((size_t)length >= binding->size) length = (int)binding->size - 1;
+					memcpy(member, bytes, length);
+					member[length] = '\0';
+					break;
+			}
+		}
+	}
+
+	free(bindings);
+	return YES;
+}
+
+@end
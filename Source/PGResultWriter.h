@@ -0,0 +1,90 @@
+//
+//  PGResultWriter.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class PGConnection;
+@class PGResult;
+
+typedef enum {
+	kPGResultWriterCSV = 0,		///< RFC 4180, with a header line; NULL is empty and the empty string is ""
+	kPGResultWriterJSONLines,	///< one JSON object per row, keyed by column name
+	kPGResultWriterArrow		///< an Arrow IPC stream of record batches
+} PGResultWriterFormat;
+
+/** Writes the rows of results to a stream or file descriptor as CSV, JSON Lines or Arrow.
+ * @discussion Cells are formatted straight from the result's bytes: integers, floats,
+ *             numerics, booleans, timestamps and dates are converted from their binary
+ *             representation, and text is copied, without creating objects. Timestamps
+ *             are written in ISO 8601, in UTC for timestamptz. Values of other binary types
+ *             are written as their object's description.
+ *
+ *             Output is collected in a buffer of bufferSize bytes and written whenever it
+ *             fills, so memory use doesn't grow with the output. Arrow columns are
+ *             accumulated for rowsPerBatch rows, then written as one record batch; a
+ *             schema message precedes the first. Arrow types follow the column types:
+ *             bool, int2, int4, int8, oid, float4 and float8 map to their native types,
+ *             timestamp and timestamptz to microsecond timestamps, date to days, bytea to
+ *             binary and everything else to UTF-8.
+ *
+ *             Results may be written one after another, e.g., the single-row results of a
+ *             streamed query; the columns are taken from the first. Call -finish: after
+ *             the last. A writer is not thread-safe.
+ */
+@interface PGResultWriter : NSObject
+{
+@private
+	PGResultWriterFormat _format;
+	NSOutputStream *_stream;
+	int _fd;
+	NSUInteger _bufferSize;
+	NSUInteger _rowsPerBatch;
+	BOOL _includesHeader;
+
+	void *_output;				// PGWriterOutput, created with the first result
+	void *_columns;				// PGWriterColumn for each column
+	int _numberOfColumns;
+	NSUInteger _rowsInBatch;
+	NSUInteger _numberOfRows;
+	BOOL _finished;
+}
+
+@property (readonly) PGResultWriterFormat format;
+
+/** The size of the output buffer. Defaults to 64 KB; set before the first result. */
+@property NSUInteger bufferSize;
+
+/** The rows in each Arrow record batch. Defaults to 65536. */
+@property NSUInteger rowsPerBatch;
+
+/** Begin CSV with a line of column names. Defaults to YES. */
+@property BOOL includesHeader;
+
+/** The rows written so far. */
+@property (readonly) NSUInteger numberOfRows;
+
+/** Write to an open stream. The writer doesn't open or close it. */
+- (id)initWithOutputStream:(NSOutputStream *)stream format:(PGResultWriterFormat)format;
+
+/** Write to a file descriptor, such as a file, pipe or socket. The writer doesn't close it. */
+- (id)initWithFileDescriptor:(int)fd format:(PGResultWriterFormat)format;
+
+/** Write the rows of a result.
+ * @return NO if the result's columns differ from the first result's or writing fails
+ */
+- (BOOL)writeResult:(PGResult *)result error:(NSError **)error;
+
+/** Execute a query in single-row mode and write each row as it arrives, so neither the
+ *  result nor the output is held in memory. Doesn't call -finish:.
+ */
+- (BOOL)writeRowsOfQuery:(NSString *)query values:(NSArray *)values connection:(PGConnection *)conn error:(NSError **)error;
+
+/** Write the remaining buffered rows and, for Arrow, the end-of-stream marker. */
+- (BOOL)finish:(NSError **)error;
+
+@end
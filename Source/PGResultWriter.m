@@ -0,0 +1,1290 @@
+//
+//  PGResultWriter.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGResultWriter.h"
+#import "PGConnection.h"
+#import "PGResult.h"
+#import "PGRow.h"
+#import "PGResultDescriptor.h"
+#import "PGError.h"
+#import "PGInternal.h"
+#include <math.h>
+#include <unistd.h>
+
+/** How a column's cells are read. */
+typedef enum {
+	kPGCellText = 0,		// UTF-8: any text format value, and the binary text types
+	kPGCellBool,
+	kPGCellInt16,
+	kPGCellInt32,
+	kPGCellInt64,
+	kPGCellOid,
+	kPGCellFloat4,
+	kPGCellFloat8,
+	kPGCellNumeric,
+	kPGCellTimestamp,
+	kPGCellTimestampTZ,
+	kPGCellDate,
+	kPGCellBytea,
+	kPGCellTextBool,
+	kPGCellTextInteger,
+	kPGCellTextFloat,		// float4, float8 and numeric
+	kPGCellObject			// any other binary type, through NSObjectFromPGBinaryValue()
+} PGCellKind;
+
+/** How a formatted cell is written to JSON. */
+typedef enum {
+	kPGJSONString = 0,
+	kPGJSONNumber,
+	kPGJSONLiteral			// true or false
+} PGJSONKind;
+
+/** The members of Arrow's Type union that columns are written as. */
+typedef enum {
+	kPGArrowInt = 2,
+	kPGArrowFloatingPoint = 3,
+	kPGArrowBinary = 4,
+	kPGArrowUtf8 = 5,
+	kPGArrowBool = 6,
+	kPGArrowDate = 8,
+	kPGArrowTimestamp = 10
+} PGArrowType;
+
+/** Microseconds and days from the Unix epoch to PostgreSQL's, 1/1/2000. */
+#define PGUnixEpochOffsetMicroseconds 946684800000000LL
+#define PGUnixEpochOffsetDays 10957
+
+/** Arrow batches are written early once a column holds this much variable-width data, so
+ *  its 32-bit offsets can't overflow.
+ */
+#define PGArrowMaxDataLength (1U << 30)
+
+typedef struct {
+	char *bytes;
+	size_t length;
+	size_t capacity;
+} PGByteBuffer;
+
+typedef struct {
+	PGCellKind kind;
+	Oid type;
+	char *jsonKey;			// the escaped name and a colon
+	size_t jsonKeyLength;
+
+	PGArrowType arrowType;
+	int width;				// bytes per value of a fixed-width type
+	BOOL isSigned;
+	PGByteBuffer validity;
+	PGByteBuffer values;	// fixed-width values, bits for bool, or offsets into data
+	PGByteBuffer data;		// variable-width values
+	int64_t nullCount;
+} PGWriterColumn;
+
+typedef struct {
+	char *bytes;
+	size_t length;
+	size_t capacity;
+	NSOutputStream *stream;	// or
+	int fd;
+	NSError *error;			// the first write error, after which output is discarded
+	PGByteBuffer text;		// scratch space for formatted cells
+} PGWriterOutput;
+
+#pragma mark Buffers
+
+static NSError *PGWriterError(NSString *reason)
+{
+	NSDictionary *info = @{ NSLocalizedDescriptionKey : @"The rows could not be written.",
+							NSLocalizedFailureReasonErrorKey : reason };
+
+	return [NSError errorWithDomain:PostgreSQLErrorDomain code:-1 userInfo:info];
+}
+
+static void PGByteBufferGrow(PGByteBuffer *buffer, size_t additional)
+{
+	size_t capacity = MAX(MAX(buffer->capacity * 2, buffer->length + additional), 256);
+
+	buffer->bytes = realloc(buffer->bytes, capacity);
+	buffer->capacity = capacity;
+}
+
+static inline void PGByteBufferReserve(PGByteBuffer *buffer, size_t additional)
+{
+	if (buffer->length + additional > buffer->capacity)
+		PGByteBufferGrow(buffer, additional);
+}
+
+static inline void PGByteBufferAppend(PGByteBuffer *buffer, const void *bytes, size_t length)
+{
+	PGByteBufferReserve(buffer, length);
+	memcpy(buffer->bytes + buffer->length, bytes, length);
+	buffer->length += length;
+}
+
+/** Append an unsigned value of width bytes in little-endian order. */
+static inline void PGByteBufferAppendLittle(PGByteBuffer *buffer, uint64_t value, int width)
+{
+	PGByteBufferReserve(buffer, width);
+	for (int i = 0; i < width; i++)
+		buffer->bytes[buffer->length++] = (char)(value >> (8 * i));
+}
+
+static BOOL PGWriterOutputDrain(PGWriterOutput *out, const char *bytes, size_t length)
+{
+	while (length > 0 && !out->error) {
+		ssize_t written;
+
+		if (out->stream) {
+			written = [out->stream write:(const uint8_t *)bytes maxLength:length];
+			if (written <= 0)
+				out->error = [(out->stream.streamError ?: PGWriterError(@"The stream is closed or at capacity.")) retain];
+		}
+		else {
+			written = write(out->fd, bytes, length);
+			if (written < 0 && errno == EINTR)
+				continue;
+			if (written < 0)
+				out->error = [[NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil] retain];
+		}
+
+		if (written > 0) {
+			bytes += written;
+			length -= written;
+		}
+	}
+	return out->error == nil;
+}
+
+static void PGWriterOutputFlush(PGWriterOutput *out)
+{
+	PGWriterOutputDrain(out, out->bytes, out->length);
+	out->length = 0;
+}
+
+static void PGWriterOutputAppendSlow(PGWriterOutput *out, const void *bytes, size_t length)
+{
+	PGWriterOutputFlush(out);
+
+	if (length >= out->capacity) {
+		PGWriterOutputDrain(out, bytes, length);
+	}
+	else {
+		memcpy(out->bytes, bytes, length);
+		out->length = length;
+	}
+}
+
+static inline void PGWriterOutputAppend(PGWriterOutput *out, const void *bytes, size_t length)
+{
+	if (out->length + length > out->capacity) {
+		PGWriterOutputAppendSlow(out, bytes, length);
+		return;
+	}
+	memcpy(out->bytes + out->length, bytes, length);
+	out->length += length;
+}
+
+static inline void PGWriterOutputAppendByte(PGWriterOutput *out, char c)
+{
+	if (out->length == out->capacity)
+		PGWriterOutputFlush(out);
+	out->bytes[out->length++] = c;
+}
+
+static void PGWriterOutputAppendPadding(PGWriterOutput *out, size_t length)
+{
+	static const char zeros[8] = { 0 };
+	PGWriterOutputAppend(out, zeros, (8 - length % 8) % 8);
+}
+
+#pragma mark Formatting
+
+static size_t PGFormatInt64(char *buf, int64_t value)
+{
+	char digits[20];
+	uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+	size_t count = 0, length = 0;
+
+	do {
+		digits[count++] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude);
+
+	if (value < 0) buf[length++] = '-';
+	while (count) buf[length++] = digits[--count];
+
+	return length;
+}
+
+/** The fewest significant digits, from 15 (6 for float4), that read back as the same value,
+ *  with PostgreSQL's spellings of the non-finite values.
+ */
+static size_t PGFormatDouble(char *buf, double value, BOOL isFloat4)
+{
+	if (isnan(value)) return strlen(strcpy(buf, "NaN"));
+	if (isinf(value)) return strlen(strcpy(buf, value > 0 ? "Infinity" : "-Infinity"));
+
+	int maxPrecision = isFloat4 ? 9 : 17;
+	int length = 0;
+
+	for (int precision = isFloat4 ? 6 : 15; precision <= maxPrecision; precision++) {
+		length = snprintf(buf, 32, "%.*g", precision, value);
+		double check = strtod(buf, NULL);
+
+		if (isFloat4 ? (float)check == (float)value : check == value)
+			break;
+	}
+	return length;
+}
+
+/** Convert days since 1/1/1970 to a proleptic Gregorian date. */
+static void PGCivilFromDays(int64_t days, int64_t *year, unsigned *month, unsigned *day)
+{
+	days += 719468;
+	int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+	unsigned dayOfEra = (unsigned)(days - era * 146097);
+	unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+	unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	unsigned shiftedMonth = (5 * dayOfYear + 2) / 153;
+
+	*day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+	*month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+	*year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+static size_t PGFormatDate(char *buf, int32_t days)
+{
+	if (days == INT32_MAX) return strlen(strcpy(buf, "infinity"));
+	if (days == INT32_MIN) return strlen(strcpy(buf, "-infinity"));
+
+	int64_t year;
+	unsigned month, day;
+	PGCivilFromDays((int64_t)days + PGUnixEpochOffsetDays, &year, &month, &day);
+
+	return snprintf(buf, 32, "%04lld-%02u-%02u", (long long)year, month, day);
+}
+
+/** ISO 8601, with a trailing Z for timestamptz, which the server sends in UTC. */
+static size_t PGFormatTimestamp(char *buf, int64_t microseconds, BOOL utc)
+{
+	if (microseconds == INT64_MAX) return strlen(strcpy(buf, "infinity"));
+	if (microseconds == INT64_MIN) return strlen(strcpy(buf, "-infinity"));
+
+	const int64_t microsecondsPerDay = 86400000000LL;
+	int64_t days = microseconds / microsecondsPerDay;
+	int64_t time = microseconds % microsecondsPerDay;
+
+	if (time < 0) {
+		time += microsecondsPerDay;
+		days--;
+	}
+
+	int64_t year;
+	unsigned month, day;
+	PGCivilFromDays(days + PGUnixEpochOffsetDays, &year, &month, &day);
+
+	unsigned seconds = (unsigned)(time / 1000000), fraction = (unsigned)(time % 1000000);
+	size_t length = snprintf(buf, 48, "%04lld-%02u-%02uT%02u:%02u:%02u", (long long)year, month, day,
+							 seconds / 3600, seconds / 60 % 60, seconds % 60);
+	if (fraction) {
+		length += snprintf(buf + length, 8, ".%06u", fraction);
+		while (buf[length - 1] == '0') length--;
+	}
+	if (utc) buf[length++] = 'Z';
+
+	return length;
+}
+
+/** Format a binary numeric exactly, to its display scale. */
+static void PGFormatNumeric(PGByteBuffer *text, const pg_numeric_t *numeric)
+{
+	int16_t ndigits = NSSwapBigShortToHost(numeric->ndigits);
+	int16_t weight = NSSwapBigShortToHost(numeric->nweight);
+	uint16_t sign = NSSwapBigShortToHost(numeric->negative);
+	uint16_t dscale = NSSwapBigShortToHost(numeric->dscale);
+	const uint16_t *digits = numeric->digits;	// ndigits long, which may exceed the declared array
+
+	text->length = 0;
+
+	switch (sign) {
+		case 0xC000: PGByteBufferAppend(text, "NaN", 3); return;
+		case 0xD000: PGByteBufferAppend(text, "Infinity", 8); return;
+		case 0xF000: PGByteBufferAppend(text, "-Infinity", 9); return;
+	}
+
+	// Each base 10000 digit is four decimal digits; the last group may overshoot the scale
+	PGByteBufferReserve(text, (weight > 0 ? weight + 1 : 1) * 4 + dscale + 6);
+	char *p = text->bytes;
+
+	if (sign == 0x4000) *p++ = '-';
+
+	if (weight < 0) {
+		*p++ = '0';
+	}
+	else {
+		for (int d = 0; d <= weight; d++) {
+			unsigned digit = d < ndigits ? NSSwapBigShortToHost(digits[d]) : 0;
+
+			if (d == 0) {
+				p += PGFormatInt64(p, digit);
+			}
+			else {
+				p[0] = '0' + digit / 1000;
+				p[1] = '0' + digit / 100 % 10;
+				p[2] = '0' + digit / 10 % 10;
+				p[3] = '0' + digit % 10;
+				p += 4;
+			}
+		}
+	}
+
+	if (dscale > 0) {
+		*p++ = '.';
+		char *end = p + dscale;
+
+		for (int d = weight + 1; p < end; d++) {
+			unsigned digit = (d >= 0 && d < ndigits) ? NSSwapBigShortToHost(digits[d]) : 0;
+			p[0] = '0' + digit / 1000;
+			p[1] = '0' + digit / 100 % 10;
+			p[2] = '0' + digit / 10 % 10;
+			p[3] = '0' + digit % 10;
+			p += 4;
+		}
+		p = end;
+	}
+	text->length = p - text->bytes;
+}
+
+/** Format bytes as PostgreSQL's hex bytea output, e.g., \x0a0b. */
+static void PGFormatHex(PGByteBuffer *text, const uint8_t *bytes, size_t length)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	text->length = 0;
+	PGByteBufferReserve(text, 2 + length * 2);
+	text->bytes[text->length++] = '\\';
+	text->bytes[text->length++] = 'x';
+
+	for (size_t i = 0; i < length; i++) {
+		text->bytes[text->length++] = hex[bytes[i] >> 4];
+		text->bytes[text->length++] = hex[bytes[i] & 15];
+	}
+}
+
+/** NaN and the infinities are numbers in CSV, but strings in JSON. */
+static inline BOOL PGTextIsFinite(const char *text)
+{
+	return !(text[0] == 'N' || text[0] == 'I' || (text[0] == '-' && text[1] == 'I'));
+}
+
+/** Format a non-NULL cell as text, in the output's scratch space unless it already is text. */
+static PGJSONKind PGCellText(const PGWriterColumn *column, const char *bytes, int length, PGByteBuffer *scratch,
+							 const char **text, size_t *textLength)
+{
+	const pg_valueref_t value = { .string = (char *)bytes };
+	int32_t tmp32;
+	int64_t tmp64;
+	double real;
+
+	scratch->length = 0;
+	PGByteBufferReserve(scratch, 64);
+	*text = scratch->bytes;
+
+	switch (column->kind) {
+		case kPGCellText:
+			*text = bytes;
+			*textLength = length;
+			return kPGJSONString;
+		case kPGCellBool:
+		case kPGCellTextBool:
+			*text = (column->kind == kPGCellBool ? value.bytes[0] != 0 : bytes[0] == 't') ? "true" : "false";
+			*textLength = strlen(*text);
+			return kPGJSONLiteral;
+		case kPGCellInt16:
+			*textLength = PGFormatInt64(scratch->bytes, (int16_t)NSSwapBigShortToHost(*value.val16));
+			return kPGJSONNumber;
+		case kPGCellInt32:
+			*textLength = PGFormatInt64(scratch->bytes, (int32_t)NSSwapBigIntToHost(*value.val32));
+			return kPGJSONNumber;
+		case kPGCellInt64:
+			*textLength = PGFormatInt64(scratch->bytes, (int64_t)NSSwapBigLongLongToHost(*value.val64));
+			return kPGJSONNumber;
+		case kPGCellOid:
+			*textLength = PGFormatInt64(scratch->bytes, (uint32_t)NSSwapBigIntToHost(*value.val32));
+			return kPGJSONNumber;
+		case kPGCellFloat4:
+			tmp32 = NSSwapBigIntToHost(*value.val32);
+			real = *(float *)&tmp32;
+			*textLength = PGFormatDouble(scratch->bytes, real, YES);
+			return isfinite(real) ? kPGJSONNumber : kPGJSONString;
+		case kPGCellFloat8:
+			tmp64 = NSSwapBigLongLongToHost(*value.val64);
+			real = *(double *)&tmp64;
+			*textLength = PGFormatDouble(scratch->bytes, real, NO);
+			return isfinite(real) ? kPGJSONNumber : kPGJSONString;
+		case kPGCellNumeric:
+			PGFormatNumeric(scratch, value.numeric);
+			*text = scratch->bytes;
+			*textLength = scratch->length;
+			return PGTextIsFinite(scratch->bytes) ? kPGJSONNumber : kPGJSONString;
+		case kPGCellTimestamp:
+		case kPGCellTimestampTZ:
+			*textLength = PGFormatTimestamp(scratch->bytes, NSSwapBigLongLongToHost(*value.val64), column->kind == kPGCellTimestampTZ);
+			return kPGJSONString;
+		case kPGCellDate:
+			*textLength = PGFormatDate(scratch->bytes, NSSwapBigIntToHost(*value.val32));
+			return kPGJSONString;
+		case kPGCellBytea:
+			PGFormatHex(scratch, value.bytes, length);
+			*text = scratch->bytes;
+			*textLength = scratch->length;
+			return kPGJSONString;
+		case kPGCellTextInteger:
+			*text = bytes;
+			*textLength = length;
+			return kPGJSONNumber;
+		case kPGCellTextFloat:
+			*text = bytes;
+			*textLength = length;
+			return PGTextIsFinite(bytes) ? kPGJSONNumber : kPGJSONString;
+		case kPGCellObject:
+			break;
+	}
+
+	PGJSONKind kind = kPGJSONString;
+
+	@autoreleasepool {
+		id object = NSObjectFromPGBinaryValue((char *)bytes, length, column->type);
+
+		if ([object isKindOfClass:[NSData class]]) {
+			PGFormatHex(scratch, [object bytes], [object length]);
+		}
+		else {
+			const char *description = [object description].UTF8String;
+			scratch->length = 0;
+			PGByteBufferAppend(scratch, description, strlen(description));
+			if ([object isKindOfClass:[NSNumber class]]) kind = kPGJSONNumber;
+		}
+	}
+	*text = scratch->bytes;
+	*textLength = scratch->length;
+
+	return kind;
+}
+
+static PGCellKind PGCellKindForType(Oid type, int format)
+{
+	if (format == 0) {
+		switch (type) {
+			case 16:   return kPGCellTextBool;
+			case 20:
+			case 21:
+			case 23:   return kPGCellTextInteger;
+			case 700:
+			case 701:
+			case 1700: return kPGCellTextFloat;
+			default:   return kPGCellText;
+		}
+	}
+
+	switch (type) {
+		case 16:   return kPGCellBool;
+		case 17:   return kPGCellBytea;
+		case 20:   return kPGCellInt64;
+		case 21:   return kPGCellInt16;
+		case 23:   return kPGCellInt32;
+		case 26:   return kPGCellOid;
+		case 700:  return kPGCellFloat4;
+		case 701:  return kPGCellFloat8;
+		case 1082: return kPGCellDate;
+		case 1114: return kPGCellTimestamp;
+		case 1184: return kPGCellTimestampTZ;
+		case 1700: return kPGCellNumeric;
+		case 18:    // char
+		case 19:    // name
+		case 25:    // text
+		case 114:   // json
+		case 142:   // xml
+		case 1042:  // bpchar
+		case 1043:  // varchar
+			return kPGCellText;
+		default:
+			return kPGCellObject;
+	}
+}
+
+#pragma mark CSV and JSON
+
+static void PGWriteCSVField(PGWriterOutput *out, const char *text, size_t length)
+{
+	BOOL quote = (length == 0);	// distinguishes the empty string from NULL
+
+	for (size_t i = 0; i < length && !quote; i++) {
+		char c = text[i];
+		quote = (c == ',' || c == '"' || c == '\n' || c == '\r');
+	}
+
+	if (!quote) {
+		PGWriterOutputAppend(out, text, length);
+		return;
+	}
+
+	// Each quote is written twice: once ending a run, and again beginning the next
+	size_t start = 0;
+
+	PGWriterOutputAppendByte(out, '"');
+	for (size_t i = 0; i < length; i++) {
+		if (text[i] == '"') {
+			PGWriterOutputAppend(out, text + start, i + 1 - start);
+			start = i;
+		}
+	}
+	PGWriterOutputAppend(out, text + start, length - start);
+	PGWriterOutputAppendByte(out, '"');
+}
+
+static void PGWriteJSONString(PGWriterOutput *out, const char *text, size_t length)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t start = 0;
+
+	PGWriterOutputAppendByte(out, '"');
+
+	for (size_t i = 0; i < length; i++) {
+		unsigned char c = text[i];
+
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+
+		PGWriterOutputAppend(out, text + start, i - start);
+		start = i + 1;
+
+		switch (c) {
+			case '"':  PGWriterOutputAppend(out, "\\\"", 2); break;
+			case '\\': PGWriterOutputAppend(out, "\\\\", 2); break;
+			case '\n': PGWriterOutputAppend(out, "\\n", 2); break;
+			case '\r': PGWriterOutputAppend(out, "\\r", 2); break;
+			case '\t': PGWriterOutputAppend(out, "\\t", 2); break;
+			default: {
+				char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+				PGWriterOutputAppend(out, escape, 6);
+			}
+		}
+	}
+
+	PGWriterOutputAppend(out, text + start, length - start);
+	PGWriterOutputAppendByte(out, '"');
+}
+
+typedef const char *(*PGBytesFunction)(id, SEL, NSUInteger, NSUInteger, int *);
+
+static void PGWriteCSVRow(PGWriterOutput *out, PGWriterColumn *columns, int count, PGResult *result, NSUInteger row,
+						  PGBytesFunction getBytes, SEL getBytesSel)
+{
+	for (int i = 0; i < count; i++) {
+		int length = 0;
+		const char *bytes = getBytes(result, getBytesSel, row, i, &length);
+		const char *text;
+		size_t textLength;
+
+		if (i > 0)
+			PGWriterOutputAppendByte(out, ',');
+		if (!bytes)
+			continue;
+
+		if (PGCellText(&columns[i], bytes, length, &out->text, &text, &textLength) == kPGJSONString)
+			PGWriteCSVField(out, text, textLength);
+		else
+			PGWriterOutputAppend(out, text, textLength);
+	}
+	PGWriterOutputAppendByte(out, '\n');
+}
+
+static void PGWriteJSONRow(PGWriterOutput *out, PGWriterColumn *columns, int count, PGResult *result, NSUInteger row,
+						   PGBytesFunction getBytes, SEL getBytesSel)
+{
+	PGWriterOutputAppendByte(out, '{');
+
+	for (int i = 0; i < count; i++) {
+		int length = 0;
+		const char *bytes = getBytes(result, getBytesSel, row, i, &length);
+		const char *text;
+		size_t textLength;
+
+		if (i > 0)
+			PGWriterOutputAppendByte(out, ',');
+		PGWriterOutputAppend(out, columns[i].jsonKey, columns[i].jsonKeyLength);
+
+		if (!bytes) {
+			PGWriterOutputAppend(out, "null", 4);
+			continue;
+		}
+
+		if (PGCellText(&columns[i], bytes, length, &out->text, &text, &textLength) == kPGJSONString)
+			PGWriteJSONString(out, text, textLength);
+		else
+			PGWriterOutputAppend(out, text, textLength);
+	}
+	PGWriterOutputAppend(out, "}\n", 2);
+}
+
+#pragma mark Arrow
+
+/** A minimal FlatBuffers builder for Arrow's metadata. The buffer is filled from the end,
+ *  children before their parents, and objects are referred to by their distance from the
+ *  end, as the reference implementation does.
+ */
+typedef struct {
+	uint8_t *bytes;			// the data is the last size bytes
+	size_t capacity;
+	size_t size;
+} PGFlatBuilder;
+
+typedef struct {
+	int id;					// the field's index in its table's schema
+	int size;				// 1, 2, 4 or 8
+	BOOL isOffset;			// value is an object returned by the builder
+	uint64_t value;
+} PGFlatField;
+
+static void PGFlatPrepend(PGFlatBuilder *b, const void *bytes, size_t length)
+{
+	if (length == 0)
+		return;
+
+	if (b->size + length > b->capacity) {
+		size_t capacity = MAX(b->capacity * 2, b->size + length + 256);
+		uint8_t *grown = malloc(capacity);
+
+		if (b->bytes) {
+			memcpy(grown + capacity - b->size, b->bytes + b->capacity - b->size, b->size);
+			free(b->bytes);
+		}
+		b->bytes = grown;
+		b->capacity = capacity;
+	}
+	b->size += length;
+	memcpy(b->bytes + b->capacity - b->size, bytes, length);
+}
+
+static void PGFlatPrependScalar(PGFlatBuilder *b, uint64_t value, int size)
+{
+	uint8_t little[8];
+
+	for (int i = 0; i < size; i++)
+		little[i] = (uint8_t)(value >> (8 * i));
+	PGFlatPrepend(b, little, size);
+}
+
+/** Pad so that the next value of size align, after additional bytes, is aligned. */
+static void PGFlatAlign(PGFlatBuilder *b, size_t align, size_t additional)
+{
+	static const uint8_t zeros[8] = { 0 };
+	PGFlatPrepend(b, zeros, (align - (b->size + additional) % align) % align);
+}
+
+static void PGFlatPrependOffset(PGFlatBuilder *b, uint32_t object)
+{
+	PGFlatAlign(b, 4, 0);
+	PGFlatPrependScalar(b, b->size + 4 - object, 4);
+}
+
+static uint32_t PGFlatString(PGFlatBuilder *b, const char *string, size_t length)
+{
+	PGFlatAlign(b, 4, length + 1);
+	PGFlatPrependScalar(b, 0, 1);
+	PGFlatPrepend(b, string, length);
+	PGFlatPrependScalar(b, length, 4);
+	return (uint32_t)b->size;
+}
+
+static uint32_t PGFlatOffsetVector(PGFlatBuilder *b, const uint32_t *objects, size_t count)
+{
+	PGFlatAlign(b, 4, count * 4);
+	for (size_t i = count; i-- > 0;)
+		PGFlatPrependOffset(b, objects[i]);
+	PGFlatPrependScalar(b, count, 4);
+	return (uint32_t)b->size;
+}
+
+/** A vector of structs of two int64s, Arrow's FieldNode and Buffer. */
+static uint32_t PGFlatPairVector(PGFlatBuilder *b, const int64_t *pairs, size_t count)
+{
+	PGFlatAlign(b, 4, count * 16);
+	PGFlatAlign(b, 8, count * 16);
+	for (size_t i = count; i-- > 0;) {
+		PGFlatPrependScalar(b, pairs[i * 2 + 1], 8);
+		PGFlatPrependScalar(b, pairs[i * 2], 8);
+	}
+	PGFlatPrependScalar(b, count, 4);
+	return (uint32_t)b->size;
+}
+
+static uint32_t PGFlatTable(PGFlatBuilder *b, const PGFlatField *fields, int count)
+{
+	size_t start = b->size;
+	size_t positions[8] = { 0 };
+	int numberOfEntries = 0;
+
+	for (int i = 0; i < count; i++) {
+		const PGFlatField *field = &fields[i];
+
+		if (field->isOffset) {
+			PGFlatPrependOffset(b, (uint32_t)field->value);
+		}
+		else {
+			PGFlatAlign(b, field->size, 0);
+			PGFlatPrependScalar(b, field->value, field->size);
+		}
+		positions[field->id] = b->size;
+		numberOfEntries = MAX(numberOfEntries, field->id + 1);
+	}
+
+	// The table begins with the signed distance back to its vtable, which precedes it
+	PGFlatAlign(b, 4, 0);
+	PGFlatPrependScalar(b, 0, 4);
+	size_t table = b->size;
+
+	for (int id = numberOfEntries; id-- > 0;)
+		PGFlatPrependScalar(b, positions[id] ? table - positions[id] : 0, 2);
+	PGFlatPrependScalar(b, table - start, 2);
+	PGFlatPrependScalar(b, 4 + 2 * numberOfEntries, 2);
+
+	uint32_t vtableDistance = (uint32_t)(b->size - table);
+	uint8_t *soffset = b->bytes + b->capacity - table;
+	for (int i = 0; i < 4; i++)
+		soffset[i] = (uint8_t)(vtableDistance >> (8 * i));
+
+	return (uint32_t)table;
+}
+
+/** Write an encapsulated message: a continuation marker, the metadata length and the
+ *  Message flatbuffer padded to 8 bytes. The body follows.
+ */
+static void PGArrowWriteMessage(PGWriterOutput *out, PGFlatBuilder *b, uint8_t headerType, uint32_t header, int64_t bodyLength)
+{
+	const PGFlatField message[] = {
+		{ 3, 8, NO, (uint64_t)bodyLength },
+		{ 2, 4, YES, header },
+		{ 0, 2, NO, 4 },					// MetadataVersion V5
+		{ 1, 1, NO, headerType }
+	};
+	uint32_t root = PGFlatTable(b, message, 4);
+
+	PGFlatAlign(b, 8, 4);
+	PGFlatPrependOffset(b, root);
+
+	uint8_t prefix[8] = { 0xFF, 0xFF, 0xFF, 0xFF };
+	size_t length = (b->size + 7) & ~(size_t)7;
+	for (int i = 0; i < 4; i++)
+		prefix[4 + i] = (uint8_t)(length >> (8 * i));
+
+	PGWriterOutputAppend(out, prefix, 8);
+	PGWriterOutputAppend(out, b->bytes + b->capacity - b->size, b->size);
+	PGWriterOutputAppendPadding(out, b->size);
+}
+
+static void PGArrowSetTypeForColumn(PGWriterColumn *column)
+{
+	column->isSigned = YES;
+
+	switch (column->kind) {
+		case kPGCellBool:
+		case kPGCellTextBool:
+			column->arrowType = kPGArrowBool;
+			break;
+		case kPGCellInt16:
+		case kPGCellInt32:
+		case kPGCellInt64:
+		case kPGCellTextInteger:
+			column->arrowType = kPGArrowInt;
+			column->width = (column->type == 21) ? 2 : (column->type == 23) ? 4 : 8;
+			break;
+		case kPGCellOid:
+			column->arrowType = kPGArrowInt;
+			column->width = 4;
+			column->isSigned = NO;
+			break;
+		case kPGCellFloat4:
+		case kPGCellFloat8:
+			column->arrowType = kPGArrowFloatingPoint;
+			column->width = (column->kind == kPGCellFloat4) ? 4 : 8;
+			break;
+		case kPGCellTextFloat:
+			column->arrowType = (column->type == 1700) ? kPGArrowUtf8 : kPGArrowFloatingPoint;
+			column->width = (column->type == 700) ? 4 : 8;
+			break;
+		case kPGCellTimestamp:
+		case kPGCellTimestampTZ:
+			column->arrowType = kPGArrowTimestamp;
+			column->width = 8;
+			break;
+		case kPGCellDate:
+			column->arrowType = kPGArrowDate;
+			column->width = 4;
+			break;
+		case kPGCellBytea:
+			column->arrowType = kPGArrowBinary;
+			break;
+		default:
+			column->arrowType = kPGArrowUtf8;
+			break;
+	}
+}
+
+static inline BOOL PGArrowTypeIsVariable(PGArrowType type)
+{
+	return type == kPGArrowUtf8 || type == kPGArrowBinary;
+}
+
+static void PGArrowResetColumn(PGWriterColumn *column)
+{
+	column->validity.length = 0;
+	column->values.length = 0;
+	column->data.length = 0;
+	column->nullCount = 0;
+
+	if (PGArrowTypeIsVariable(column->arrowType))
+		PGByteBufferAppendLittle(&column->values, 0, 4);
+}
+
+static uint32_t PGArrowTypeTable(PGFlatBuilder *b, const PGWriterColumn *column)
+{
+	switch (column->arrowType) {
+		case kPGArrowInt: {
+			const PGFlatField fields[] = { { 0, 4, NO, column->width * 8 }, { 1, 1, NO, column->isSigned } };
+			return PGFlatTable(b, fields, 2);
+		}
+		case kPGArrowFloatingPoint: {
+			const PGFlatField fields[] = { { 0, 2, NO, column->width == 4 ? 1 : 2 } };	// SINGLE or DOUBLE
+			return PGFlatTable(b, fields, 1);
+		}
+		case kPGArrowTimestamp: {
+			if (column->kind == kPGCellTimestampTZ) {
+				uint32_t timezone = PGFlatString(b, "UTC", 3);
+				const PGFlatField fields[] = { { 1, 4, YES, timezone }, { 0, 2, NO, 2 } };	// MICROSECOND
+				return PGFlatTable(b, fields, 2);
+			}
+			const PGFlatField fields[] = { { 0, 2, NO, 2 } };
+			return PGFlatTable(b, fields, 1);
+		}
+		case kPGArrowDate: {
+			const PGFlatField fields[] = { { 0, 2, NO, 0 } };	// DAY
+			return PGFlatTable(b, fields, 1);
+		}
+		default:
+			return PGFlatTable(b, NULL, 0);		// Utf8, Binary and Bool have no fields
+	}
+}
+
+static void PGArrowWriteSchema(PGWriterOutput *out, PGWriterColumn *columns, int count, NSArray *names)
+{
+	PGFlatBuilder b = { NULL, 0, 0 };
+	uint32_t *fields = malloc((count ? count : 1) * sizeof(uint32_t));
+
+	for (int i = 0; i < count; i++) {
+		const char *name = [names[i] UTF8String];
+		uint32_t nameString = PGFlatString(&b, name, strlen(name));
+		uint32_t type = PGArrowTypeTable(&b, &columns[i]);
+		uint32_t children = PGFlatOffsetVector(&b, NULL, 0);
+		const PGFlatField field[] = {
+			{ 0, 4, YES, nameString },
+			{ 3, 4, YES, type },
+			{ 5, 4, YES, children },
+			{ 1, 1, NO, YES },				// nullable
+			{ 2, 1, NO, columns[i].arrowType }
+		};
+		fields[i] = PGFlatTable(&b, field, 5);
+	}
+
+	uint32_t vector = PGFlatOffsetVector(&b, fields, count);
+	const PGFlatField schema[] = { { 1, 4, YES, vector }, { 0, 2, NO, 0 } };	// little-endian
+	uint32_t header = PGFlatTable(&b, schema, 2);
+
+	PGArrowWriteMessage(out, &b, 1, header, 0);	// MessageHeader Schema
+
+	free(fields);
+	free(b.bytes);
+}
+
+static void PGArrowWriteRecordBatch(PGWriterOutput *out, PGWriterColumn *columns, int count, NSUInteger numberOfRows)
+{
+	PGFlatBuilder b = { NULL, 0, 0 };
+	int64_t *nodes = malloc((count ? count : 1) * 2 * sizeof(int64_t));
+	int64_t *buffers = malloc((count ? count : 1) * 3 * 2 * sizeof(int64_t));
+	PGByteBuffer **bodies = malloc((count ? count : 1) * 3 * sizeof(PGByteBuffer *));
+	size_t numberOfBuffers = 0;
+	int64_t bodyLength = 0;
+
+	for (int i = 0; i < count; i++) {
+		PGWriterColumn *column = &columns[i];
+		PGByteBuffer *parts[3] = { &column->validity, &column->values, &column->data };
+		int numberOfParts = PGArrowTypeIsVariable(column->arrowType) ? 3 : 2;
+
+		nodes[i * 2] = numberOfRows;
+		nodes[i * 2 + 1] = column->nullCount;
+
+		for (int part = 0; part < numberOfParts; part++) {
+			// A validity bitmap may be omitted when there are no NULLs
+			size_t length = (part == 0 && column->nullCount == 0) ? 0 : parts[part]->length;
+
+			buffers[numberOfBuffers * 2] = bodyLength;
+			buffers[numberOfBuffers * 2 + 1] = length;
+			bodies[numberOfBuffers++] = length ? parts[part] : NULL;
+			bodyLength += (length + 7) & ~(size_t)7;
+		}
+	}
+
+	uint32_t bufferVector = PGFlatPairVector(&b, buffers, numberOfBuffers);
+	uint32_t nodeVector = PGFlatPairVector(&b, nodes, count);
+	const PGFlatField batch[] = { { 0, 8, NO, numberOfRows }, { 1, 4, YES, nodeVector }, { 2, 4, YES, bufferVector } };
+	uint32_t header = PGFlatTable(&b, batch, 3);
+
+	PGArrowWriteMessage(out, &b, 3, header, bodyLength);	// MessageHeader RecordBatch
+
+	for (size_t i = 0; i < numberOfBuffers; i++) {
+		if (!bodies[i]) continue;
+		PGWriterOutputAppend(out, bodies[i]->bytes, bodies[i]->length);
+		PGWriterOutputAppendPadding(out, bodies[i]->length);
+	}
+
+	for (int i = 0; i < count; i++)
+		PGArrowResetColumn(&columns[i]);
+
+	free(nodes);
+	free(buffers);
+	free(bodies);
+	free(b.bytes);
+}
+
+/** Append a cell to a column for the batch's row, from binary or text. */
+static void PGArrowAppend(PGWriterColumn *column, NSUInteger row, const char *bytes, int length, PGByteBuffer *scratch)
+{
+	uint8_t bit = 1 << (row % 8);
+
+	if (row % 8 == 0) {
+		PGByteBufferAppendLittle(&column->validity, 0, 1);
+		if (column->arrowType == kPGArrowBool)
+			PGByteBufferAppendLittle(&column->values, 0, 1);
+	}
+
+	if (!bytes) {
+		column->nullCount++;
+		if (PGArrowTypeIsVariable(column->arrowType))
+			PGByteBufferAppendLittle(&column->values, column->data.length, 4);
+		else if (column->arrowType != kPGArrowBool)
+			PGByteBufferAppendLittle(&column->values, 0, column->width);
+		return;
+	}
+
+	column->validity.bytes[row / 8] |= bit;
+
+	const pg_valueref_t value = { .string = (char *)bytes };
+	const char *text;
+	size_t textLength;
+	int32_t tmp32;
+	int64_t tmp64;
+	double real;
+	float single;
+
+	switch (column->kind) {
+		case kPGCellBool:
+		case kPGCellTextBool:
+			if (column->kind == kPGCellBool ? value.bytes[0] != 0 : bytes[0] == 't')
+				column->values.bytes[row / 8] |= bit;
+			return;
+		case kPGCellInt16:
+		case kPGCellInt32:
+		case kPGCellInt64:
+		case kPGCellOid:
+		case kPGCellFloat4:
+		case kPGCellFloat8:
+			// Big-endian to little-endian, the same width
+			PGByteBufferReserve(&column->values, length);
+			for (int i = 0; i < length; i++)
+				column->values.bytes[column->values.length + i] = bytes[length - 1 - i];
+			column->values.length += length;
+			return;
+		case kPGCellTimestamp:
+		case kPGCellTimestampTZ:
+			tmp64 = NSSwapBigLongLongToHost(*value.val64);
+			if (tmp64 != INT64_MAX && tmp64 != INT64_MIN)
+				tmp64 += PGUnixEpochOffsetMicroseconds;
+			PGByteBufferAppendLittle(&column->values, tmp64, 8);
+			return;
+		case kPGCellDate:
+			tmp32 = NSSwapBigIntToHost(*value.val32);
+			if (tmp32 != INT32_MAX && tmp32 != INT32_MIN)
+				tmp32 += PGUnixEpochOffsetDays;
+			PGByteBufferAppendLittle(&column->values, (uint32_t)tmp32, 4);
+			return;
+		case kPGCellTextInteger:
+			PGByteBufferAppendLittle(&column->values, strtoll(bytes, NULL, 10), column->width);
+			return;
+		case kPGCellTextFloat:
+			if (column->arrowType != kPGArrowFloatingPoint)
+				break;
+			real = strtod(bytes, NULL);
+			if (column->width == 4) {
+				single = (float)real;
+				PGByteBufferAppendLittle(&column->values, *(uint32_t *)&single, 4);
+			}
+			else {
+				PGByteBufferAppendLittle(&column->values, *(uint64_t *)&real, 8);
+			}
+			return;
+		default:
+			break;
+	}
+
+	// Variable-width values
+	if (column->kind == kPGCellBytea || column->kind == kPGCellText || column->kind == kPGCellTextFloat) {
+		text = bytes;
+		textLength = length;
+	}
+	else {
+		PGCellText(column, bytes, length, scratch, &text, &textLength);
+	}
+
+	PGByteBufferAppend(&column->data, text, textLength);
+	PGByteBufferAppendLittle(&column->values, column->data.length, 4);
+}
+
+#pragma mark -
+
+@implementation PGResultWriter
+
+@synthesize format = _format;
+@synthesize bufferSize = _bufferSize;
+@synthesize rowsPerBatch = _rowsPerBatch;
+@synthesize includesHeader = _includesHeader;
+@synthesize numberOfRows = _numberOfRows;
+
+- (id)_initWithFormat:(PGResultWriterFormat)format
+{
+	if (self = [super init]) {
+		_format = format;
+		_fd = -1;
+		_bufferSize = 64 * 1024;
+		_rowsPerBatch = 65536;
+		_includesHeader = YES;
+	}
+	return self;
+}
+
+- (id)initWithOutputStream:(NSOutputStream *)stream format:(PGResultWriterFormat)format
+{
+	if (self = [self _initWithFormat:format]) {
+		_stream = [stream retain];
+	}
+	return self;
+}
+
+- (id)initWithFileDescriptor:(int)fd format:(PGResultWriterFormat)format
+{
+	if (self = [self _initWithFormat:format]) {
+		_fd = fd;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	PGWriterColumn *columns = _columns;
+	PGWriterOutput *out = _output;
+
+	for (int i = 0; i < _numberOfColumns; i++) {
+		free(columns[i].jsonKey);
+		free(columns[i].validity.bytes);
+		free(columns[i].values.bytes);
+		free(columns[i].data.bytes);
+	}
+	free(columns);
+
+	if (out) {
+		[out->error release];
+		free(out->text.bytes);
+		free(out->bytes);
+		free(out);
+	}
+
+	[_stream release];
+	[super dealloc];
+}
+
+/** Choose each column's conversion from the first result, and write the header or schema. */
+- (BOOL)_prepareWithResult:(PGResult *)result error:(NSError **)error
+{
+	PGResultDescriptor *descriptor = result._descriptor;
+	NSArray *names = descriptor.fieldNames;
+	int count = descriptor->_numberOfFields;
+	PGWriterColumn *columns = calloc(count ? count : 1, sizeof(PGWriterColumn));
+	PGWriterOutput *out = calloc(1, sizeof(PGWriterOutput));
+
+	out->capacity = MAX(_bufferSize, 64);
+	out->bytes = malloc(out->capacity);
+	out->stream = _stream;
+	out->fd = _fd;
+
+	for (int i = 0; i < count; i++) {
+		PGWriterColumn *column = &columns[i];
+
+		column->type = descriptor->_types[i];
+		column->kind = PGCellKindForType(column->type, descriptor->_formats[i]);
+
+		if (_format == kPGResultWriterJSONLines) {
+			// The quoted name and a colon, escaped as values are. An escape is at most six
+			// bytes, so the key's buffer never fills and nothing is drained to the output.
+			const char *name = [names[i] UTF8String];
+			size_t nameLength = strlen(name);
+			PGWriterOutput key = { .bytes = malloc(nameLength * 6 + 3), .capacity = nameLength * 6 + 3 };
+
+			PGWriteJSONString(&key, name, nameLength);
+			PGWriterOutputAppendByte(&key, ':');
+			column->jsonKey = key.bytes;
+			column->jsonKeyLength = key.length;
+		}
+		else if (_format == kPGResultWriterArrow) {
+			PGArrowSetTypeForColumn(column);
+			PGArrowResetColumn(column);
+		}
+	}
+
+	_columns = columns;
+	_numberOfColumns = count;
+	_output = out;
+
+	if (_format == kPGResultWriterCSV && _includesHeader) {
+		for (int i = 0; i < count; i++) {
+			const char *name = [names[i] UTF8String];
+			if (i > 0) PGWriterOutputAppendByte(out, ',');
+			PGWriteCSVField(out, name, strlen(name));
+		}
+		PGWriterOutputAppendByte(out, '\n');
+	}
+	else if (_format == kPGResultWriterArrow) {
+		PGArrowWriteSchema(out, columns, count, names);
+	}
+
+	if (out->error && error) *error = [[out->error retain] autorelease];
+	return out->error == nil;
+}
+
+- (BOOL)writeResult:(PGResult *)result error:(NSError **)error
+{
+	if (_finished) {
+		if (error) *error = PGWriterError(@"The writer has finished.");
+		return NO;
+	}
+	if (result.status != kPGResultTuplesOK && result.status != kPGResultSingleTuple) {
+		if (error) *error = result.error ?: PGWriterError(@"The result has no rows.");
+		return NO;
+	}
+	if (!_output && ![self _prepareWithResult:result error:error])
+		return NO;
+
+	if (result.numberOfFields != (NSUInteger)_numberOfColumns) {
+		if (error) *error = PGWriterError(@"The result's columns differ from those of the first result.");
+		return NO;
+	}
+
+	PGWriterOutput *out = _output;
+	PGWriterColumn *columns = _columns;
+	NSUInteger numberOfRows = result.numberOfRows;
+	SEL getBytesSel = @selector(_bytesAtRowIndex:fieldIndex:length:);
+	PGBytesFunction getBytes = (PGBytesFunction)[result methodForSelector:getBytesSel];
+
+	for (NSUInteger row = 0; row < numberOfRows && !out->error; row++) {
+		switch (_format) {
+			case kPGResultWriterCSV:
+				PGWriteCSVRow(out, columns, _numberOfColumns, result, row, getBytes, getBytesSel);
+				break;
+			case kPGResultWriterJSONLines:
+				PGWriteJSONRow(out, columns, _numberOfColumns, result, row, getBytes, getBytesSel);
+				break;
+			case kPGResultWriterArrow: {
+				BOOL full = (_rowsInBatch + 1 >= MAX(_rowsPerBatch, 1));
+
+				for (int i = 0; i < _numberOfColumns; i++) {
+					int length = 0;
+					const char *bytes = getBytes(result, getBytesSel, row, i, &length);
+
+					PGArrowAppend(&columns[i], _rowsInBatch, bytes, length, &out->text);
+					full = full || columns[i].data.length > PGArrowMaxDataLength;
+				}
+
+				_rowsInBatch++;
+				if (full) {
+					PGArrowWriteRecordBatch(out, columns, _numberOfColumns, _rowsInBatch);
+					_rowsInBatch = 0;
+				}
+				break;
+			}
+		}
+		_numberOfRows++;
+	}
+
+	if (out->error && error) *error = [[out->error retain] autorelease];
+	return out->error == nil;
+}
+
+- (BOOL)writeRowsOfQuery:(NSString *)query values:(NSArray *)values connection:(PGConnection *)conn error:(NSError **)error
+{
+	__block NSError *writeError = nil;
+
+	PGResult *result = [conn executeQuery:query values:values rowHandler:^(PGRow *row, BOOL *stop) {
+		NSError *rowError = nil;
+
+		if (![self writeResult:row.result error:&rowError]) {
+			writeError = [rowError retain];
+			*stop = YES;
+		}
+	}];
+
+	if (writeError) {
+		if (error) *error = [writeError autorelease];
+		else [writeError release];
+		return NO;
+	}
+	if (result.status != kPGResultTuplesOK) {
+		if (error) *error = result.error;
+		return NO;
+	}
+
+	// Without rows, the final result still describes the columns for the header or schema
+	if (!_output)
+		return [self writeResult:result error:error];
+
+	return YES;
+}
+
+- (BOOL)finish:(NSError **)error
+{
+	PGWriterOutput *out = _output;
+
+	if (_finished || !out)
+		return YES;
+	_finished = YES;
+
+	if (_format == kPGResultWriterArrow) {
+		static const uint8_t endOfStream[8] = { 0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0 };
+
+		if (_rowsInBatch) {
+			PGArrowWriteRecordBatch(out, _columns, _numberOfColumns, _rowsInBatch);
+			_rowsInBatch = 0;
+		}
+		PGWriterOutputAppend(out, endOfStream, 8);
+	}
+
+	PGWriterOutputFlush(out);
+
+	if (out->error && error) *error = [[out->error retain] autorelease];
+	return out->error == nil;
+}
+
+@end
@@ -0,0 +1,66 @@
+//
+//  PGRowMapper.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class PGResult;
+@class PGRow;
+
+/** Creates model objects from the rows of a result.
+ * @discussion A mapper resolves each property's setter, or its instance variable if the
+ *             property is readonly, once when it is created. The column for each property
+ *             and the conversion from the column's type are chosen once per result. Each
+ *             cell is then stored with a direct call, without key-value coding.
+ *
+ *             Integer, floating point and boolean columns are stored to scalar properties
+ *             without creating an NSNumber. NULL is stored as 0 or nil. Strings and data
+ *             are copied from the result, so objects don't keep the result alive. Values
+ *             of text-format results are decoded by column type for object properties
+ *             other than NSString, including id: bool, integers and floats to NSNumber,
+ *             numeric to NSDecimalNumber and bytea to NSData. Other text columns are
+ *             given to NSString and id properties as strings.
+ *
+ *             Creating objects raises NSInvalidArgumentException if a column's value, in
+ *             either format, isn't of the class of its object property, and
+ *             NSRangeException if an integer or floating point value doesn't fit its
+ *             integer property.
+ *
+ *             A mapper may be shared by threads.
+ */
+@interface PGRowMapper : NSObject
+{
+	Class _class;
+	NSDictionary *_mapping;
+	NSMutableDictionary *_targets;	// property name -> PGPropertyTarget, resolved on demand
+}
+
+@property (readonly) Class modelClass;
+
++ (instancetype)mapperWithClass:(Class)modelClass mapping:(NSDictionary *)mapping;
+
+/** The designated initializer.
+ * @param modelClass the class to instantiate with -init
+ * @param mapping property names keyed by column name. If nil, each column is stored to the
+ *        property of the same name, and columns without one are ignored.
+ * @throws NSInvalidArgumentException if a mapped property doesn't exist or has an
+ *         unsupported type
+ */
+- (id)initWithClass:(Class)modelClass mapping:(NSDictionary *)mapping;
+
+/** Create an object for every row of a result. */
+- (NSArray *)objectsWithResult:(PGResult *)result;
+
+/** Create an object for each row in turn, without accumulating them. */
+- (void)enumerateObjectsWithResult:(PGResult *)result block:(void (^)(id object, NSUInteger rowIndex, BOOL *stop))block;
+
+/** Create an object from a single row. Prefer the methods that take a result for more
+ *  than one row, since the columns are resolved with each call.
+ */
+- (id)objectWithRow:(PGRow *)row;
+
+@end
@@ -0,0 +1,556 @@
+//
+//  PGRowMapper.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGRowMapper.h"
+#import "PGResult.h"
+#import "PGRow.h"
+#import "PGResultDescriptor.h"
+#import "PGInternal.h"
+#import <objc/runtime.h>
+
+/** Where and how a property is stored, resolved once per mapper. */
+@interface PGPropertyTarget : NSObject
+{
+@public
+	char type;				// @encode() type of the property, e.g., 'q', 'd', '@'
+	Class objectClass;		// the class of an object property, or Nil for id
+	SEL setter;
+	IMP imp;				// NULL if stored to the instance variable
+	ptrdiff_t ivarOffset;
+	BOOL copies;			// for an object instance variable: copy rather than retain
+}
+@end
+
+@implementation PGPropertyTarget
+@end
+
+/** How a column's values are read. */
+typedef enum {
+	kPGSourceObject = 0,	// decoded to an object
+	kPGSourceString,		// copied to an NSString
+	kPGSourceData,			// copied to an NSData
+	kPGSourceBinaryBool,
+	kPGSourceBinaryInt16,
+	kPGSourceBinaryInt32,
+	kPGSourceBinaryInt64,
+	kPGSourceBinaryFloat,
+	kPGSourceBinaryDouble,
+	kPGSourceTextInteger,	// parsed with strtoll()
+	kPGSourceTextFloat,		// parsed with strtod()
+	kPGSourceTextBool,
+	kPGSourceTextObject,	// decoded to an object by the column's type
+	kPGSourceUnsupported = -1
+} PGColumnSource;
+
+typedef struct {
+	int column;
+	PGColumnSource source;
+	PGValueDecoder decoder;
+	Oid type;
+	PGPropertyTarget *target;
+} PGColumnBinding;
+
+#pragma mark -
+
+static BOOL PGTypeIsSupported(char type)
+{
+	return strchr("cCsSiIlLqQfdB@", type) != NULL && type != '\0';
+}
+
+/** Whether a text value of a type can be decoded to an object by PGObjectFromText(). */
+static BOOL PGTextTypeIsDecoded(Oid type)
+{
+	switch (type) {
+		case 16: case 17: case 20: case 21: case 23: case 26: case 700: case 701: case 1700:
+			return YES;
+		default:
+			return NO;
+	}
+}
+
+static id PGObjectFromText(const char *bytes, Oid type)
+{
+	size_t length;
+	unsigned char *unescaped;
+	NSData *data;
+
+	switch (type) {
+		case 16:   return [NSNumber numberWithBool:bytes[0] == 't'];
+		case 20:
+		case 21:
+		case 23:
+		case 26:   return [NSNumber numberWithLongLong:strtoll(bytes, NULL, 10)];
+		case 700:
+		case 701:  return [NSNumber numberWithDouble:strtod(bytes, NULL)];
+		case 1700: return [NSDecimalNumber decimalNumberWithString:@(bytes) locale:@{ NSLocaleDecimalSeparator : @"." }];
+		case 17:
+			// hex or escape format, depending on the server's bytea_output
+			if ((unescaped = PQunescapeBytea((const unsigned char *)bytes, &length)) == NULL)
+				return nil;
+			data = [NSData dataWithBytes:unescaped length:length];
+			PQfreemem(unescaped);
+			return data;
+		default:
+			return nil;
+	}
+}
+
+/** Whether an object property can hold instances of a class. */
+static BOOL PGTargetAcceptsClass(PGPropertyTarget *target, Class cls)
+{
+	return !target->objectClass || [cls isSubclassOfClass:target->objectClass];
+}
+
+static PGColumnSource PGColumnSourceForType(Oid type, int format, PGPropertyTarget *target)
+{
+	BOOL isScalar = (target->type != '@');
+
+	// Objects decoded from other types are checked against the property's class as they're stored
+	if (format == 1) {
+		switch (type) {
+			case 16:   return isScalar ? kPGSourceBinaryBool   : kPGSourceObject;
+			case 21:   return isScalar ? kPGSourceBinaryInt16  : kPGSourceObject;
+			case 23:   return isScalar ? kPGSourceBinaryInt32  : kPGSourceObject;
+			case 20:   return isScalar ? kPGSourceBinaryInt64  : kPGSourceObject;
+			case 700:  return isScalar ? kPGSourceBinaryFloat  : kPGSourceObject;
+			case 701:  return isScalar ? kPGSourceBinaryDouble : kPGSourceObject;
+			case 25:
+			case 1043:
+				if (isScalar) return kPGSourceObject;
+				return PGTargetAcceptsClass(target, [NSString class]) ? kPGSourceString : kPGSourceUnsupported;
+			case 17:
+				if (isScalar) return kPGSourceObject;
+				return PGTargetAcceptsClass(target, [NSData class]) ? kPGSourceData : kPGSourceUnsupported;
+			default:   return kPGSourceObject;
+		}
+	}
+
+	if (!isScalar) {
+		// Text is only given to properties that can hold a string; other types are decoded.
+		if (target->objectClass && [target->objectClass isSubclassOfClass:[NSString class]])
+			return kPGSourceString;
+		if (PGTextTypeIsDecoded(type))
+			return kPGSourceTextObject;
+		return target->objectClass ? kPGSourceUnsupported : kPGSourceString;
+	}
+
+	switch (type) {
+		case 16:   return kPGSourceTextBool;
+		case 20:
+		case 21:
+		case 23:
+		case 26:   return kPGSourceTextInteger;
+		default:   return kPGSourceTextFloat;	// float4, float8, numeric and anything strtod() reads
+	}
+}
+
+/** Whether an integer can be stored to a property of a type without changing its value. */
+static BOOL PGIntegerFitsType(int64_t value, char type)
+{
+	switch (type) {
+		case 'c': return value >= CHAR_MIN && value <= CHAR_MAX;
+		case 'C': return value >= 0 && value <= UCHAR_MAX;
+		case 's': return value >= SHRT_MIN && value <= SHRT_MAX;
+		case 'S': return value >= 0 && value <= USHRT_MAX;
+		case 'i': return value >= INT_MIN && value <= INT_MAX;
+		case 'I': return value >= 0 && value <= UINT_MAX;
+		case 'l': return value >= LONG_MIN && value <= LONG_MAX;
+		case 'L':
+		case 'Q': return value >= 0;
+		default:  return YES;	// bool, long long, float and double
+	}
+}
+
+static void PGStoreInteger(id object, PGPropertyTarget *target, int64_t value)
+{
+	if (target->imp) {
+		switch (target->type) {
+			case 'c': ((void (*)(id, SEL, char))target->imp)(object, target->setter, (char)value); break;
+			case 'C': ((void (*)(id, SEL, unsigned char))target->imp)(object, target->setter, (unsigned char)value); break;
+			case 'B': ((void (*)(id, SEL, bool))target->imp)(object, target->setter, value != 0); break;
+			case 's': ((void (*)(id, SEL, short))target->imp)(object, target->setter, (short)value); break;
+			case 'S': ((void (*)(id, SEL, unsigned short))target->imp)(object, target->setter, (unsigned short)value); break;
+			case 'i': ((void (*)(id, SEL, int))target->imp)(object, target->setter, (int)value); break;
+			case 'I': ((void (*)(id, SEL, unsigned int))target->imp)(object, target->setter, (unsigned int)value); break;
+			case 'l': ((void (*)(id, SEL, long))target->imp)(object, target->setter, (long)value); break;
+			case 'L': ((void (*)(id, SEL, unsigned long))target->imp)(object, target->setter, (unsigned long)value); break;
+			case 'q': ((void (*)(id, SEL, long long))target->imp)(object, target->setter, (long long)value); break;
+			case 'Q': ((void (*)(id, SEL, unsigned long long))target->imp)(object, target->setter, (unsigned long long)value); break;
+			case 'f': ((void (*)(id, SEL, float))target->imp)(object, target->setter, (float)value); break;
+			case 'd': ((void (*)(id, SEL, double))target->imp)(object, target->setter, (double)value); break;
+		}
+		return;
+	}
+
+	void *ivar = (char *)object + target->ivarOffset;
+
+	switch (target->type) {
+		case 'c': *(char *)ivar = (char)value; break;
+		case 'C': *(unsigned char *)ivar = (unsigned char)value; break;
+		case 'B': *(bool *)ivar = value != 0; break;
+		case 's': *(short *)ivar = (short)value; break;
+		case 'S': *(unsigned short *)ivar = (unsigned short)value; break;
+		case 'i': *(int *)ivar = (int)value; break;
+		case 'I': *(unsigned int *)ivar = (unsigned int)value; break;
+		case 'l': *(long *)ivar = (long)value; break;
+		case 'L': *(unsigned long *)ivar = (unsigned long)value; break;
+		case 'q': *(long long *)ivar = (long long)value; break;
+		case 'Q': *(unsigned long long *)ivar = (unsigned long long)value; break;
+		case 'f': *(float *)ivar = (float)value; break;
+		case 'd': *(double *)ivar = (double)value; break;
+	}
+}
+
+/** Store to a float or double property. */
+static void PGStoreDouble(id object, PGPropertyTarget *target, double value)
+{
+	if (target->imp) {
+		if (target->type == 'f')
+			((void (*)(id, SEL, float))target->imp)(object, target->setter, (float)value);
+		else
+			((void (*)(id, SEL, double))target->imp)(object, target->setter, value);
+	}
+	else if (target->type == 'f')
+		*(float *)((char *)object + target->ivarOffset) = (float)value;
+	else
+		*(double *)((char *)object + target->ivarOffset) = value;
+}
+
+static void PGStoreObject(id object, PGPropertyTarget *target, id value)
+{
+	if (target->imp) {
+		((void (*)(id, SEL, id))target->imp)(object, target->setter, value);
+		return;
+	}
+
+	id *ivar = (id *)((char *)object + target->ivarOffset);
+	id old = *ivar;
+	*ivar = target->copies ? [value copy] : [value retain];
+	[old release];
+}
+
+/** The class named by an object type encoding such as @"NSString", or Nil for id. */
+static Class PGClassFromTypeEncoding(const char *type)
+{
+	if (!type || type[0] != '@' || type[1] != '"')
+		return Nil;
+
+	const char *name = type + 2;
+	const char *end = strchr(name, '"');
+	if (!end || *name == '<')	// id<Protocol>
+		return Nil;
+
+	NSString *className = [[[NSString alloc] initWithBytes:name length:end - name encoding:NSUTF8StringEncoding] autorelease];
+	return NSClassFromString(className);
+}
+
+#pragma mark -
+
+@implementation PGRowMapper
+
+@synthesize modelClass = _class;
+
++ (instancetype)mapperWithClass:(Class)modelClass mapping:(NSDictionary *)mapping
+{
+	return [[[self alloc] initWithClass:modelClass mapping:mapping] autorelease];
+}
+
+- (id)initWithClass:(Class)modelClass mapping:(NSDictionary *)mapping
+{
+	if (self = [super init]) {
+		_class = modelClass;
+		_mapping = [mapping copy];
+		_targets = [[NSMutableDictionary alloc] init];
+
+		for (NSString *property in _mapping.allValues) {
+			if (![self _targetForProperty:property]) {
+				[self release];
+				[NSException raise:NSInvalidArgumentException format:@"%@ has no property \"%@\" of a supported type", modelClass, property];
+			}
+		}
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[_mapping release];
+	[_targets release];
+	[super dealloc];
+}
+
+/** Resolve the setter of a property, or its instance variable if it has no setter. Returns
+ *  nil if there is neither or the type can't be stored. Results, including misses, are kept.
+ */
+- (PGPropertyTarget *)_targetForProperty:(NSString *)name
+{
+	@synchronized(_targets) {
+		id cached = [_targets objectForKey:name];
+		if (cached) return (cached == [NSNull null]) ? nil : cached;
+
+		PGPropertyTarget *target = [[[PGPropertyTarget alloc] init] autorelease];
+		objc_property_t property = class_getProperty(_class, name.UTF8String);
+		Ivar ivar = NULL;
+		BOOL resolved = NO;
+
+		if (property) {
+			char *type = property_copyAttributeValue(property, "T");
+			char *setterName = property_copyAttributeValue(property, "S");
+			char *readonly = property_copyAttributeValue(property, "R");
+			char *ivarName = property_copyAttributeValue(property, "V");
+			char *copies = property_copyAttributeValue(property, "C");
+
+			target->type = type ? type[0] : '\0';
+			target->objectClass = PGClassFromTypeEncoding(type);
+			target->copies = (copies != NULL);
+
+			if (!readonly) {
+				NSString *selName = setterName ? @(setterName) : [NSString stringWithFormat:@"set%@%@:", [[name substringToIndex:1] uppercaseString], [name substringFromIndex:1]];
+				target->setter = NSSelectorFromString(selName);
+				if (class_respondsToSelector(_class, target->setter)) {
+					target->imp = class_getMethodImplementation(_class, target->setter);
+					resolved = YES;
+				}
+			}
+			if (!resolved && ivarName)
+				ivar = class_getInstanceVariable(_class, ivarName);
+
+			free(type);
+			free(setterName);
+			free(readonly);
+			free(ivarName);
+			free(copies);
+		}
+		else {
+			ivar = class_getInstanceVariable(_class, [@"_" stringByAppendingString:name].UTF8String);
+			if (!ivar) ivar = class_getInstanceVariable(_class, name.UTF8String);
+			if (ivar) {
+				target->type = ivar_getTypeEncoding(ivar)[0];
+				target->objectClass = PGClassFromTypeEncoding(ivar_getTypeEncoding(ivar));
+			}
+		}
+
+		if (!resolved && ivar) {
+			target->ivarOffset = ivar_getOffset(ivar);
+			resolved = YES;
+		}
+
+		if (!resolved || !PGTypeIsSupported(target->type)) target = nil;
+
+		[_targets setObject:target ? (id)target : (id)[NSNull null] forKey:name];
+		return target;
+	}
+}
+
+/** Choose the column and conversion for each mapped property. Returns the count.
+ * @throws NSInvalidArgumentException if a column can't be converted to its property's class
+ */
+- (NSUInteger)_getBindings:(PGColumnBinding *)bindings forResult:(PGResult *)result
+{
+	PGResultDescriptor *descriptor = result._descriptor;
+	NSUInteger count = 0;
+
+	for (int column = 0; column < descriptor->_numberOfFields; column++) {
+		NSString *fieldName = descriptor->_fieldNames[column];
+		NSString *property = _mapping ? [_mapping objectForKey:fieldName] : fieldName;
+		PGPropertyTarget *target = property ? [self _targetForProperty:property] : nil;
+
+		if (!target) continue;
+
+		PGColumnBinding *binding = &bindings[count++];
+		binding->column = column;
+		binding->type = descriptor->_types[column];
+		binding->decoder = descriptor->_decoders[column];
+		binding->source = PGColumnSourceForType(binding->type, descriptor->_formats[column], target);
+		binding->target = target;
+
+		if (binding->source == kPGSourceUnsupported)
+			[NSException raise:NSInvalidArgumentException format:@"Column \"%@\", of type %u, can't be stored to %@ property \"%@\"",
+			 fieldName, binding->type, target->objectClass, property];
+	}
+	return count;
+}
+
+static void PGStoreCheckedInteger(id object, const PGColumnBinding *binding, int64_t value)
+{
+	if (!PGIntegerFitsType(value, binding->target->type)) {
+		[object release];
+		[NSException raise:NSRangeException format:@"%lld in column %d is out of range for its property", value, binding->column];
+	}
+	PGStoreInteger(object, binding->target, value);
+}
+
+/** Store a floating point value, range-checking it like an integer for an integer property. */
+static void PGStoreCheckedDouble(id object, const PGColumnBinding *binding, double value)
+{
+	char type = binding->target->type;
+
+	if (type == 'f' || type == 'd') {
+		PGStoreDouble(object, binding->target, value);
+		return;
+	}
+
+	// NaN fails both comparisons
+	if (!(value >= -9223372036854775808.0 && value < 9223372036854775808.0)) {
+		[object release];
+		[NSException raise:NSRangeException format:@"%g in column %d is out of range for its property", value, binding->column];
+	}
+	PGStoreCheckedInteger(object, binding, (int64_t)value);
+}
+
+/** Store a decoded object, raising if an object property's class can't hold it. */
+static void PGStoreCheckedObject(id object, const PGColumnBinding *binding, id value)
+{
+	PGPropertyTarget *target = binding->target;
+
+	if (target->type != '@') {
+		// e.g., a numeric or date column to a scalar
+		if ([value isKindOfClass:[NSDate class]])
+			PGStoreCheckedDouble(object, binding, [value timeIntervalSinceReferenceDate]);
+		else if ([value respondsToSelector:@selector(doubleValue)])
+			PGStoreCheckedDouble(object, binding, [value doubleValue]);
+		else
+			PGStoreInteger(object, target, 0);
+		return;
+	}
+
+	if (value && target->objectClass && ![value isKindOfClass:target->objectClass]) {
+		[object release];
+		[NSException raise:NSInvalidArgumentException format:@"%@ in column %d can't be stored to %@ property", [value class], binding->column, target->objectClass];
+	}
+	PGStoreObject(object, target, value);
+}
+
+static id PGCreateObject(Class cls, PGResult *result, NSUInteger row, const PGColumnBinding *bindings, NSUInteger count,
+						 const char *(*getBytes)(id, SEL, NSUInteger, NSUInteger, int *), SEL getBytesSel)
+{
+	id object = [[cls alloc] init];
+
+	for (NSUInteger i = 0; i < count; i++) {
+		const PGColumnBinding *binding = &bindings[i];
+		PGPropertyTarget *target = binding->target;
+		int length = 0;
+		const char *bytes = getBytes(result, getBytesSel, row, binding->column, &length);
+
+		if (!bytes) {
+			if (target->type == '@')
+				PGStoreObject(object, target, nil);
+			else
+				PGStoreInteger(object, target, 0);
+			continue;
+		}
+
+		const pg_valueref_t value = { .string = (char *)bytes };
+		int32_t tmp32;
+		int64_t tmp64;
+		id obj;
+
+		switch (binding->source) {
+			case kPGSourceBinaryBool:
+				PGStoreInteger(object, target, value.bytes[0]);
+				break;
+			case kPGSourceBinaryInt16:
+				PGStoreCheckedInteger(object, binding, (int16_t)NSSwapBigShortToHost(*value.val16));
+				break;
+			case kPGSourceBinaryInt32:
+				PGStoreCheckedInteger(object, binding, (int32_t)NSSwapBigIntToHost(*value.val32));
+				break;
+			case kPGSourceBinaryInt64:
+				PGStoreCheckedInteger(object, binding, (int64_t)NSSwapBigLongLongToHost(*value.val64));
+				break;
+			case kPGSourceBinaryFloat:
+				tmp32 = NSSwapBigIntToHost(*value.val32);
+				PGStoreCheckedDouble(object, binding, *(float *)&tmp32);
+				break;
+			case kPGSourceBinaryDouble:
+				tmp64 = NSSwapBigLongLongToHost(*value.val64);
+				PGStoreCheckedDouble(object, binding, *(double *)&tmp64);
+				break;
+			case kPGSourceTextInteger:
+				// oid exceeds int32, and strtoll() clamps what exceeds int64
+				PGStoreCheckedInteger(object, binding, strtoll(bytes, NULL, 10));
+				break;
+			case kPGSourceTextFloat:
+				PGStoreCheckedDouble(object, binding, strtod(bytes, NULL));
+				break;
+			case kPGSourceTextBool:
+				PGStoreInteger(object, target, bytes[0] == 't');
+				break;
+			case kPGSourceString:
+				obj = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+				PGStoreObject(object, target, obj);
+				[obj release];
+				break;
+			case kPGSourceData:
+				obj = [[NSData alloc] initWithBytes:bytes length:length];
+				PGStoreObject(object, target, obj);
+				[obj release];
+				break;
+			case kPGSourceObject:
+				PGStoreCheckedObject(object, binding, binding->decoder(result, (char *)bytes, length, binding->type));
+				break;
+			case kPGSourceTextObject:
+				PGStoreCheckedObject(object, binding, PGObjectFromText(bytes, binding->type));
+				break;
+			case kPGSourceUnsupported:
+				break;
+		}
+	}
+	return object;
+}
+
+- (void)enumerateObjectsWithResult:(PGResult *)result block:(void (^)(id object, NSUInteger rowIndex, BOOL *stop))block
+{
+	NSUInteger numberOfFields = result.numberOfFields;
+	NSUInteger numberOfRows = result.numberOfRows;
+	PGColumnBinding *bindings = calloc(numberOfFields ? numberOfFields : 1, sizeof(PGColumnBinding));
+
+	SEL getBytesSel = @selector(_bytesAtRowIndex:fieldIndex:length:);
+	const char *(*getBytes)(id, SEL, NSUInteger, NSUInteger, int *) = (void *)[result methodForSelector:getBytesSel];
+	BOOL stop = NO;
+
+	@try {
+		NSUInteger count = [self _getBindings:bindings forResult:result];
+
+		for (NSUInteger row = 0; row < numberOfRows && !stop; row++) {
+			@autoreleasepool {
+				id object = PGCreateObject(_class, result, row, bindings, count, getBytes, getBytesSel);
+				block(object, row, &stop);
+				[object release];
+			}
+		}
+	}
+	@finally {
+		free(bindings);
+	}
+}
+
+- (NSArray *)objectsWithResult:(PGResult *)result
+{
+	NSMutableArray *objects = [NSMutableArray arrayWithCapacity:result.numberOfRows];
+
+	[self enumerateObjectsWithResult:result block:^(id object, NSUInteger rowIndex, BOOL *stop) {
+		[objects addObject:object];
+	}];
+
+	return objects;
+}
+
+- (id)objectWithRow:(PGRow *)row
+{
+	PGResult *result = row.result;
+	PGColumnBinding bindings[result.numberOfFields ? result.numberOfFields : 1];
+	NSUInteger count = [self _getBindings:bindings forResult:result];
+
+	SEL getBytesSel = @selector(_bytesAtRowIndex:fieldIndex:length:);
+	const char *(*getBytes)(id, SEL, NSUInteger, NSUInteger, int *) = (void *)[result methodForSelector:getBytesSel];
+
+	return [PGCreateObject(_class, result, row.rowNumber, bindings, count, getBytes, getBytesSel) autorelease];
+}
+
+@end
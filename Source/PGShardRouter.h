@@ -0,0 +1,95 @@
+//
+//  PGShardRouter.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <PGCocoa/PGConnection.h>
+
+/** Maps a shard key to the index of the shard that holds it, less than numberOfShards. */
+typedef NSUInteger (^PGShardFunction)(id key, NSUInteger numberOfShards);
+
+/** Receives the rows of a query run on every shard. */
+typedef void (^PGShardRowHandler)(PGRow *row, NSUInteger shard, BOOL *stop);
+
+/** Routes statements to databases that each hold part of the data, by shard key.
+ * @discussion The router holds one connection per shard. Statements for one key go to
+ *             its shard; statements for every shard run on all of them at once, and their
+ *             rows are returned per shard, concatenated, or merged in order as they arrive.
+ *
+ *             The router may be used from any number of threads. Each connection serves
+ *             one request at a time; a request for every shard waits for all of them.
+ */
+@interface PGShardRouter : NSObject
+{
+	NSArray *_shardParams;
+	NSArray *_shards;
+	PGShardFunction _shardFunction;
+}
+
+/** The function that places keys. Defaults to +hashFunction. */
+@property (copy) PGShardFunction shardFunction;
+
+@property (readonly) NSUInteger numberOfShards;
+@property (readonly) NSArray *connections;	///< indexed by shard
+
+/** Places keys by a 64-bit hash of the value: integers by value, strings by their UTF-8
+ *  bytes, data by its bytes. The hash is stable across processes, and keys are assigned
+ *  with a jump consistent hash, so adding a shard moves only the keys the new shard takes.
+ */
++ (PGShardFunction)hashFunction;
+
+/** Places keys by range. Shard i holds keys less than bounds[i] and not less than
+ *  bounds[i-1]; the last shard holds the keys from the last bound up.
+ * @param bounds ascending values that respond to compare:, one fewer than the shards
+ */
++ (PGShardFunction)rangeFunctionWithBounds:(NSArray *)bounds;
+
+/** Initialize with the connection parameters for each shard, in shard order. */
+- (id)initWithShardParameters:(NSArray *)params;
+
+/** Connect to every shard.
+ * @return NO if any shard fails to connect
+ */
+- (BOOL)connect:(NSError **)error;
+- (void)disconnect;
+
+- (NSUInteger)shardIndexForKey:(id)key;
+
+/** Perform arbitrary work with exclusive use of the connection to a key's shard. */
+- (void)performWithShardForKey:(id)key block:(void (^)(PGConnection *conn))block;
+
+/** Execute a statement on the shard for a key. */
+- (PGResult *)executeQuery:(NSString *)query values:(NSArray *)values forKey:(id)key;
+
+/** Execute a statement on every shard concurrently.
+ * @return the results, indexed by shard
+ */
+- (NSArray *)executeQueryOnAllShards:(NSString *)query values:(NSArray *)values;
+
+/** Execute a query on every shard concurrently and pass each row to a handler as it
+ *  arrives, holding one row per shard in memory.
+ * @param comparator if not nil, rows are merged in its order, which must be the order of
+ *                   each shard's rows, e.g., by the query's ORDER BY; otherwise, the rows
+ *                   of each shard are passed in turn
+ * @param error on failure, the first shard's error
+ * @return NO if a shard fails. Stopping the handler cancels the queries and returns YES.
+ */
+- (BOOL)enumerateRowsOfQuery:(NSString *)query values:(NSArray *)values comparator:(NSComparator)comparator
+					   error:(NSError **)error handler:(PGShardRowHandler)handler;
+
+/** Execute a query on every shard and combine the rows into one result.
+ * @see enumerateRowsOfQuery:values:comparator:error:handler:
+ * @return the combined result, or the error result of the first shard to fail
+ */
+- (PGResult *)executeMergedQuery:(NSString *)query values:(NSArray *)values comparator:(NSComparator)comparator;
+
+@end
+
+/** Compares PGRows by the values of fields named by sort descriptors' keys, as ORDER BY
+ *  does: NULL sorts after every value in ascending order and before them in descending.
+ */
+NSComparator PGRowComparatorWithSortDescriptors(NSArray *sortDescriptors);
@@ -0,0 +1,534 @@
+//
+//  PGShardRouter.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGShardRouter.h"
+#import "PGConnection.h"
+#import "PGResult.h"
+#import "PGResultDescriptor.h"
+#import "PGRow.h"
+#import "PGError.h"
+#import "PGQueryParameters.h"
+#import "PGInternal.h"
+
+@interface PGShard : NSObject
+{
+@public
+	PGConnection *connection;
+	NSLock *lock;				// held while a request uses the connection
+}
+@end
+
+@implementation PGShard
+
+- (id)initWithConnection:(PGConnection *)conn
+{
+	if (self = [super init]) {
+		connection = [conn retain];
+		lock = [[NSLock alloc] init];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[connection release];
+	[lock release];
+	[super dealloc];
+}
+
+@end
+
+/** A shard's progress through a single-row mode query during a merge. */
+typedef struct {
+	PGShard *shard;
+	PGRow *row;					// the next row to pass on, retained
+	PGResultDescriptor *descriptor;	// from the shard's first row, shared by the rest
+	BOOL active;				// the query has results left to read
+} PGShardCursor;
+
+#pragma mark Shard functions
+
+static uint64_t PGHashBytes(const void *bytes, size_t length)
+{
+	// FNV-1a
+	const uint8_t *p = bytes;
+	uint64_t hash = 14695981039346656037ULL;
+
+	while (length--) {
+		hash ^= *p++;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static uint64_t PGHashInteger(uint64_t x)
+{
+	// the SplitMix64 finalizer, so sequential keys spread evenly
+	x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static uint64_t PGHashKey(id key)
+{
+	if ([key isKindOfClass:NSNumber.class] && ![key isKindOfClass:NSDecimalNumber.class]) {
+		long long n = [key longLongValue];
+		if ([key doubleValue] == (double)n)
+			return PGHashInteger((uint64_t)n);
+	}
+
+	if ([key isKindOfClass:NSData.class])
+		return PGHashBytes([key bytes], [key length]);
+
+	const char *string = [key isKindOfClass:NSString.class] ? [key UTF8String] : [[key description] UTF8String];
+	return PGHashBytes(string, strlen(string));
+}
+
+/** Lamping and Veach, "A Fast, Minimal Memory, Consistent Hash Algorithm". */
+static NSUInteger PGJumpConsistentHash(uint64_t key, NSUInteger buckets)
+{
+	int64_t b = -1, j = 0;
+
+	while (j < (int64_t)buckets) {
+		b = j;
+		key = key * 2862933555777941757ULL + 1;
+		j = (int64_t)((b + 1) * ((double)(1LL << 31) / (double)((key >> 33) + 1)));
+	}
+	return (NSUInteger)b;
+}
+
+NSComparator PGRowComparatorWithSortDescriptors(NSArray *sortDescriptors)
+{
+	NSArray *descriptors = [[sortDescriptors copy] autorelease];
+
+	return [[^NSComparisonResult(PGRow *row1, PGRow *row2) {
+		for (NSSortDescriptor *descriptor in descriptors) {
+			id value1 = row1[descriptor.key];
+			id value2 = row2[descriptor.key];
+			BOOL null1 = (value1 == NSNull.null), null2 = (value2 == NSNull.null);
+			NSComparisonResult order;
+
+			if (null1 || null2)
+				order = (null1 == null2) ? NSOrderedSame : (null1 ? NSOrderedDescending : NSOrderedAscending);
+			else
+				order = [value1 compare:value2];
+
+			if (order != NSOrderedSame)
+				return descriptor.ascending ? order : -order;
+		}
+		return NSOrderedSame;
+	} copy] autorelease];
+}
+
+#pragma mark -
+
+@implementation PGShardRouter
+
+@synthesize shardFunction = _shardFunction;
+
++ (PGShardFunction)hashFunction
+{
+	return [[^NSUInteger(id key, NSUInteger numberOfShards) {
+		return PGJumpConsistentHash(PGHashKey(key), numberOfShards);
+	} copy] autorelease];
+}
+
++ (PGShardFunction)rangeFunctionWithBounds:(NSArray *)bounds
+{
+	NSArray *sorted = [[bounds copy] autorelease];
+
+	return [[^NSUInteger(id key, NSUInteger numberOfShards) {
+		NSUInteger low = 0, high = sorted.count;
+
+		// the first bound greater than the key
+		while (low < high) {
+			NSUInteger mid = low + (high - low) / 2;
+			if ([key compare:sorted[mid]] == NSOrderedAscending)
+				high = mid;
+			else
+				low = mid + 1;
+		}
+		return MIN(low, numberOfShards - 1);
+	} copy] autorelease];
+}
+
+- (id)initWithShardParameters:(NSArray *)params
+{
+	if (self = [super init]) {
+		_shardParams = [params copy];
+		_shards = [[NSArray alloc] init];
+		_shardFunction = [[PGShardRouter hashFunction] retain];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self disconnect];
+	[_shardParams release];
+	[_shards release];
+	[_shardFunction release];
+	[super dealloc];
+}
+
+- (NSUInteger)numberOfShards
+{
+	return _shardParams.count;
+}
+
+- (NSArray *)connections
+{
+	NSArray *shards = [self _shards];
+	NSMutableArray *connections = [NSMutableArray arrayWithCapacity:shards.count];
+
+	for (PGShard *shard in shards)
+		[connections addObject:shard->connection];
+
+	return connections;
+}
+
+- (NSArray *)_shards
+{
+	@synchronized(self) {
+		return [[_shards retain] autorelease];
+	}
+}
+
+- (BOOL)connect:(NSError **)error
+{
+	NSMutableArray *shards = [NSMutableArray arrayWithCapacity:_shardParams.count];
+
+	for (NSDictionary *params in _shardParams) {
+		PGConnection *conn = [[[PGConnection alloc] initWithParameters:params] autorelease];
+
+		if (![conn connect]) {
+			if (error) {
+				NSString *description = [NSString stringWithFormat:@"Shard %lu is not available.", (unsigned long)shards.count];
+				NSMutableDictionary *info = [NSMutableDictionary dictionaryWithObject:description forKey:NSLocalizedDescriptionKey];
+				if (conn.error) [info setObject:conn.error forKey:NSUnderlyingErrorKey];
+				*error = [NSError errorWithDomain:PostgreSQLErrorDomain code:-1 userInfo:info];
+			}
+			for (PGShard *shard in shards)
+				[shard->connection disconnect];
+			return NO;
+		}
+
+		[shards addObject:[[[PGShard alloc] initWithConnection:conn] autorelease]];
+	}
+
+	@synchronized(self) {
+		[_shards release];
+		_shards = [shards copy];
+	}
+	return YES;
+}
+
+- (void)disconnect
+{
+	for (PGShard *shard in [self _shards]) {
+		[shard->lock lock];
+		[shard->connection disconnect];
+		[shard->lock unlock];
+	}
+}
+
+#pragma mark Single shard
+
+- (NSUInteger)shardIndexForKey:(id)key
+{
+	NSUInteger count = self.numberOfShards;
+	NSUInteger index = self.shardFunction(key, count);
+
+	if (index >= count)
+		[NSException raise:NSRangeException format:@"shard function returned %lu for %lu shards", (unsigned long)index, (unsigned long)count];
+
+	return index;
+}
+
+- (void)performWithShardForKey:(id)key block:(void (^)(PGConnection *conn))block
+{
+	NSArray *shards = [self _shards];
+	NSUInteger index = [self shardIndexForKey:key];
+	if (index >= shards.count) return;	// not connected
+
+	PGShard *shard = shards[index];
+	[shard->lock lock];
+	@try {
+		block(shard->connection);
+	}
+	@finally {
+		[shard->lock unlock];
+	}
+}
+
+- (PGResult *)executeQuery:(NSString *)query values:(NSArray *)values forKey:(id)key
+{
+	__block PGResult *result = nil;
+
+	[self performWithShardForKey:key block:^(PGConnection *conn) {
+		result = [[conn executeQuery:query values:values] retain];
+	}];
+
+	return [result autorelease];
+}
+
+#pragma mark Every shard
+
+// Locks are always taken in shard order, so requests for every shard can't deadlock.
+- (void)_lockShards:(NSArray *)shards
+{
+	for (PGShard *shard in shards)
+		[shard->lock lock];
+}
+
+- (void)_unlockShards:(NSArray *)shards
+{
+	for (PGShard *shard in shards)
+		[shard->lock unlock];
+}
+
+// The statement is sent to every shard before any result is read, so the shards execute
+// it concurrently without a thread apiece.
+- (NSArray *)executeQueryOnAllShards:(NSString *)query values:(NSArray *)values
+{
+	NSArray *shards = [self _shards];
+	NSMutableArray *results = [NSMutableArray arrayWithCapacity:shards.count];
+	PGQueryParameters *params = [PGQueryParameters queryParametersWithValues:values];
+	Oid *types = NULL;
+	const char **valrefs = NULL;
+	int *lengths = NULL;
+	int *formats = NULL;
+	BOOL *sent = calloc(shards.count, sizeof(BOOL));
+
+	int nParams = (int)[params getNumberOfTypes:&types values:&valrefs lengths:&lengths formats:&formats];
+
+	[self _lockShards:shards];
+
+	for (NSUInteger i = 0; i < shards.count && nParams >= 0; i++) {
+		PGShard *shard = shards[i];
+		sent[i] = PQsendQueryParams(shard->connection.conn, query.UTF8String, nParams, types, valrefs, lengths, formats, 1);
+	}
+
+	for (NSUInteger i = 0; i < shards.count; i++) {
+		PGConnection *conn = ((PGShard *)shards[i])->connection;
+		PGresult *result = NULL, *next;
+
+		while (sent[i] && (next = PQgetResult(conn.conn))) {
+			if (result) PQclear(result);
+			result = next;
+		}
+		if (!result)
+			result = PQmakeEmptyPGresult(conn.conn, PGRES_FATAL_ERROR);
+
+		[results addObject:[conn _resultWithResult:result]];
+	}
+
+	[self _unlockShards:shards];
+	free(sent);
+
+	return results;
+}
+
+/** Read a cursor's next row. Returns NO, with the error result in finalResult, if the shard
+ *  fails; the cursor is inactive once its rows are exhausted. finalResult is retained, as
+ *  it may outlive the autorelease pool in which it is read.
+ */
+static BOOL PGShardCursorAdvance(PGShardCursor *cursor, PGResult **finalResult)
+{
+	PGConnection *conn = cursor->shard->connection;
+	PGresult *result;
+
+	[cursor->row release];
+	cursor->row = nil;
+
+	while (cursor->active && (result = PQgetResult(conn.conn))) {
+		switch (PQresultStatus(result)) {
+			case PGRES_SINGLE_TUPLE: {
+				PGResult *row = [conn _resultWithResult:result];
+				if (cursor->descriptor)
+					[row _setDescriptor:cursor->descriptor];
+				else
+					cursor->descriptor = [[row _descriptor] retain];
+				cursor->row = [row[0] retain];
+				return YES;
+			}
+			case PGRES_TUPLES_OK:
+			case PGRES_COMMAND_OK:
+				if (!*finalResult)
+					*finalResult = [[conn _resultWithResult:result] retain];	// empty, but describes the fields
+				else
+					PQclear(result);
+				break;
+			default:
+				[*finalResult release];
+				*finalResult = [[conn _resultWithResult:result] retain];
+				cursor->active = NO;
+
+				// The connection stays busy until every result, through NULL, is read
+				while ((result = PQgetResult(conn.conn)))
+					PQclear(result);
+				return NO;
+		}
+	}
+
+	cursor->active = NO;
+	return YES;
+}
+
+static BOOL PGShardCursorPrecedes(PGShardCursor *cursors, NSUInteger a, NSUInteger b, NSComparator comparator)
+{
+	NSComparisonResult order = comparator(cursors[a].row, cursors[b].row);
+	return order == NSOrderedAscending || (order == NSOrderedSame && a < b);	// stable by shard
+}
+
+static void PGShardHeapSiftDown(NSUInteger *heap, NSUInteger count, NSUInteger i, PGShardCursor *cursors, NSComparator comparator)
+{
+	for (;;) {
+		NSUInteger least = i, left = 2 * i + 1, right = left + 1;
+
+		if (left < count && PGShardCursorPrecedes(cursors, heap[left], heap[least], comparator)) least = left;
+		if (right < count && PGShardCursorPrecedes(cursors, heap[right], heap[least], comparator)) least = right;
+		if (least == i) return;
+
+		NSUInteger swap = heap[i];
+		heap[i] = heap[least];
+		heap[least] = swap;
+		i = least;
+	}
+}
+
+/** Run a query on every shard in single-row mode and pass the rows to the handler.
+ * @param finalResult receives the error result of the first shard to fail, or else an
+ *        empty result describing the fields; may be NULL
+ */
+- (BOOL)_enumerateRowsOfQuery:(NSString *)query values:(NSArray *)values comparator:(NSComparator)comparator
+				  finalResult:(PGResult **)finalResult handler:(PGShardRowHandler)handler
+{
+	NSArray *shards = [self _shards];
+	NSUInteger count = shards.count;
+	PGShardCursor *cursors = calloc(count, sizeof(PGShardCursor));
+	NSUInteger *heap = calloc(count, sizeof(NSUInteger));
+	NSUInteger heapCount = 0;
+	PGResult *last = nil;
+	BOOL stop = NO, success = YES;
+
+	[self _lockShards:shards];
+
+	for (NSUInteger i = 0; i < count; i++) {
+		cursors[i].shard = shards[i];
+		cursors[i].active = [cursors[i].shard->connection _sendSingleRowQuery:query values:values];
+		if (!cursors[i].active && !last) {
+			PGConnection *conn = cursors[i].shard->connection;
+			last = [[conn _resultWithResult:PQmakeEmptyPGresult(conn.conn, PGRES_FATAL_ERROR)] retain];
+			success = NO;
+		}
+	}
+
+	if (comparator) {
+		// A k-way merge: the heap orders the shards by their next row
+		for (NSUInteger i = 0; i < count && success; i++) {
+			success = PGShardCursorAdvance(&cursors[i], &last);
+			if (cursors[i].row) heap[heapCount++] = i;
+		}
+		for (NSUInteger i = heapCount / 2; i-- > 0; )
+			PGShardHeapSiftDown(heap, heapCount, i, cursors, comparator);
+
+		while (success && !stop && heapCount) {
+			NSUInteger i = heap[0];
+
+			@autoreleasepool {
+				handler(cursors[i].row, i, &stop);
+				if (!stop) success = PGShardCursorAdvance(&cursors[i], &last);
+			}
+			if (stop) break;
+
+			if (!cursors[i].row) heap[0] = heap[--heapCount];
+			PGShardHeapSiftDown(heap, heapCount, 0, cursors, comparator);
+		}
+	}
+	else {
+		for (NSUInteger i = 0; i < count && success && !stop; i++) {
+			while (success && !stop) {
+				@autoreleasepool {
+					success = PGShardCursorAdvance(&cursors[i], &last);
+					if (!cursors[i].row) break;
+					handler(cursors[i].row, i, &stop);
+				}
+			}
+		}
+	}
+
+	// Abandon the queries still running and discard their rows. Inactive shards are drained
+	// too, in case a query was sent before it failed, so no connection is left busy.
+	for (NSUInteger i = 0; i < count; i++) {
+		PGConnection *conn = cursors[i].shard->connection;
+		PGresult *result;
+
+		if (cursors[i].active)
+			[conn cancel];
+		while ((result = PQgetResult(conn.conn)))
+			PQclear(result);
+
+		[cursors[i].row release];
+		[cursors[i].descriptor release];
+	}
+
+	[self _unlockShards:shards];
+	free(cursors);
+	free(heap);
+
+	if (finalResult)
+		*finalResult = [last autorelease];
+	else
+		[last release];
+	return success;
+}
+
+- (BOOL)enumerateRowsOfQuery:(NSString *)query values:(NSArray *)values comparator:(NSComparator)comparator
+					   error:(NSError **)error handler:(PGShardRowHandler)handler
+{
+	PGResult *finalResult = nil;
+	BOOL success = [self _enumerateRowsOfQuery:query values:values comparator:comparator finalResult:&finalResult handler:handler];
+
+	if (!success && error) *error = finalResult.error;
+	return success;
+}
+
+- (PGResult *)executeMergedQuery:(NSString *)query values:(NSArray *)values comparator:(NSComparator)comparator
+{
+	__block PGresult *merged = NULL;
+	__block BOOL copied = YES;
+	PGResult *finalResult = nil;
+
+	BOOL success = [self _enumerateRowsOfQuery:query values:values comparator:comparator finalResult:&finalResult handler:^(PGRow *row, NSUInteger shard, BOOL *stop) {
+		PGresult *source = row.result.pgresult;
+
+		if (!merged) merged = PQcopyResult(source, PG_COPYRES_ATTRS);
+
+		int tuple = PQntuples(merged);
+		for (int field = 0, count = PQnfields(source); field < count && copied; field++) {
+			if (PQgetisnull(source, 0, field))
+				copied = PQsetvalue(merged, tuple, field, NULL, -1);
+			else
+				copied = PQsetvalue(merged, tuple, field, PQgetvalue(source, 0, field), PQgetlength(source, 0, field));
+		}
+		*stop = !copied;
+	}];
+
+	if (!success || !copied || !merged) {
+		if (merged) PQclear(merged);
+		if (success && !copied)
+			return [PGResult _resultWithResult:PQmakeEmptyPGresult(NULL, PGRES_FATAL_ERROR)];
+		return finalResult;	// an error, or no rows from any shard
+	}
+
+	return [PGResult _resultWithResult:merged];
+}
+
+@end
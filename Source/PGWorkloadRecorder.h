@@ -0,0 +1,117 @@
+//
+//  PGWorkloadRecorder.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <PGCocoa/PGResult.h>
+
+@class PGConnection;
+@class PGQueryParameters;
+
+typedef enum {
+	kPGWorkloadEventPrepared = 1 << 0,	/**< executed with a PGPreparedQuery */
+	kPGWorkloadEventBatch    = 1 << 1	/**< a multi-statement batch or a command such as BEGIN, sent without parameters */
+} PGWorkloadEventFlags;
+
+/** The version written by PGWorkloadRecorder */
+#define PGWorkloadCaptureVersion 1
+
+/** Records the statements executed by connections to a capture file for later replay.
+ * @discussion Assign a recorder to a connection's recorder property, or share one among
+ *             many connections. Each execution is recorded with its SQL, its parameters
+ *             in the encoding sent to the server, its start time and duration, and its
+ *             status. Each distinct statement text is written once and referred to by number.
+ *             Records are buffered and written in blocks; call -close to finish the file.
+ *
+ *             The file starts with "PGWLOG\0\0", a uint32 version and the capture's start
+ *             time, followed by records, all little-endian:
+ *
+ *               'S'  uint32 statement number, uint32 length, UTF-8 text
+ *               'E'  uint32 session, uint32 statement number, uint32 flags, uint64 start
+ *                    (microseconds from the capture start), uint32 duration (microseconds),
+ *                    int32 status, uint32 parameter count, then per parameter: uint32 type,
+ *                    int32 format, int32 length (-1 for NULL), and the bytes; text values
+ *                    are followed by a NUL not included in the length
+ */
+@interface PGWorkloadRecorder : NSObject
+{
+	NSString *_path;
+	FILE *_file;
+	NSMutableData *_buffer;
+	NSMutableDictionary *_statementNumbers;
+	CFAbsoluteTime _startTime;
+	uint32_t _nextSession;
+}
+
+@property (readonly) NSString *path;
+
+/** Create a capture file, replacing any existing file. */
+- (id)initWithPath:(NSString *)path error:(NSError **)error;
+
+- (void)recordQuery:(NSString *)query values:(NSArray *)values flags:(PGWorkloadEventFlags)flags session:(uint32_t)session
+			  start:(CFAbsoluteTime)start duration:(NSTimeInterval)duration status:(PGExecStatusType)status;
+
+/** Record parameters already bound, e.g., for the types of a prepared statement. */
+- (void)_recordQuery:(NSString *)query parameters:(PGQueryParameters *)params count:(NSInteger)nParams flags:(PGWorkloadEventFlags)flags
+			 session:(uint32_t)session start:(CFAbsoluteTime)start duration:(NSTimeInterval)duration status:(PGExecStatusType)status;
+
+/** A new session number, assigned to each connection that records. */
+- (uint32_t)_nextSessionID;
+
+- (void)flush;
+- (void)close;
+
+@end
+
+/** One recorded execution. */
+@interface PGWorkloadEvent : NSObject
+{
+@public
+	uint32_t _session;
+	uint32_t _statement;
+	PGWorkloadEventFlags _flags;
+	NSTimeInterval _startTime;
+	NSTimeInterval _duration;
+	PGExecStatusType _status;
+	uint32_t _parameterCount;
+	const uint8_t *_parameters;		// within the capture's data
+}
+
+@property (readonly) uint32_t session;
+@property (readonly) uint32_t statementIndex;
+@property (readonly) PGWorkloadEventFlags flags;
+@property (readonly) NSTimeInterval startTime;	///< seconds from the capture start
+@property (readonly) NSTimeInterval duration;
+@property (readonly) PGExecStatusType status;
+
+@end
+
+/** A capture file read for replay. */
+@interface PGWorkloadCapture : NSObject
+{
+	NSData *_data;
+	NSArray *_statements;
+	NSArray *_events;
+	NSMutableSet *_prepared;	// "connection/statement" pairs prepared for replay
+}
+
+@property (readonly) NSArray *statements;	///< SQL text, indexed by statement number
+@property (readonly) NSArray *events;		///< PGWorkloadEvents in the order recorded
+
+- (id)initWithContentsOfFile:(NSString *)path error:(NSError **)error;
+
+/** Execute an event's statement with its recorded parameters. Prepared statements are
+ *  prepared on each connection the first time they are replayed on it.
+ */
+- (PGResult *)replayEvent:(PGWorkloadEvent *)event connection:(PGConnection *)conn;
+
+/** Forget which statements were prepared on a connection about to be closed, since another
+ *  connection may later be allocated at its address.
+ */
+- (void)forgetPreparedStatementsForConnection:(PGConnection *)conn;
+
+@end
@@ -0,0 +1,375 @@
+//
+//  PGWorkloadRecorder.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGWorkloadRecorder.h"
+#import "PGConnection.h"
+#import "PGQueryParameters_Private.h"
+#import "PGInternal.h"
+#import <libkern/OSByteOrder.h>
+
+static const char PGWorkloadMagic[8] = "PGWLOG\0";
+
+#define PGWorkloadBufferSize (64 * 1024)
+
+static void PGAppendUInt32(NSMutableData *data, uint32_t value)
+{
+	value = OSSwapHostToLittleInt32(value);
+	[data appendBytes:&value length:sizeof(value)];
+}
+
+static void PGAppendUInt64(NSMutableData *data, uint64_t value)
+{
+	value = OSSwapHostToLittleInt64(value);
+	[data appendBytes:&value length:sizeof(value)];
+}
+
+static NSError *PGWorkloadError(NSString *path, NSString *reason)
+{
+	NSDictionary *info = @{ NSLocalizedDescriptionKey : [NSString stringWithFormat:@"The workload capture \"%@\" could not be read.", path.lastPathComponent],
+							NSLocalizedFailureReasonErrorKey : reason,
+							NSFilePathErrorKey : path };
+
+	return [NSError errorWithDomain:PostgreSQLErrorDomain code:-1 userInfo:info];
+}
+
+#pragma mark -
+
+@implementation PGWorkloadRecorder
+
+@synthesize path = _path;
+
+- (id)initWithPath:(NSString *)path error:(NSError **)error
+{
+	if (self = [super init]) {
+		_path = [path copy];
+		_buffer = [[NSMutableData alloc] initWithCapacity:PGWorkloadBufferSize];
+		_statementNumbers = [[NSMutableDictionary alloc] init];
+		_startTime = CFAbsoluteTimeGetCurrent();
+
+		if (!(_file = fopen(path.fileSystemRepresentation, "w"))) {
+			if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{ NSFilePathErrorKey : path }];
+			[self release];
+			return nil;
+		}
+
+		uint64_t start;
+		memcpy(&start, &_startTime, sizeof(start));
+
+		[_buffer appendBytes:PGWorkloadMagic length:sizeof(PGWorkloadMagic)];
+		PGAppendUInt32(_buffer, PGWorkloadCaptureVersion);
+		PGAppendUInt64(_buffer, start);
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self close];
+	[_path release];
+	[_buffer release];
+	[_statementNumbers release];
+	[super dealloc];
+}
+
+- (uint32_t)_nextSessionID
+{
+	@synchronized(self) {
+		return ++_nextSession;
+	}
+}
+
+- (void)recordQuery:(NSString *)query values:(NSArray *)values flags:(PGWorkloadEventFlags)flags session:(uint32_t)session
+			  start:(CFAbsoluteTime)start duration:(NSTimeInterval)duration status:(PGExecStatusType)status
+{
+	PGQueryParameters *params = [PGQueryParameters queryParametersWithValues:values];
+	unsigned int *types;
+	const char **valrefs;
+	int *lengths;
+	int *formats;
+	NSInteger nParams = values.count ? [params getNumberOfTypes:&types values:&valrefs lengths:&lengths formats:&formats] : 0;
+
+	if (nParams >= 0)
+		[self _recordQuery:query parameters:params count:nParams flags:flags session:session start:start duration:duration status:status];
+}
+
+- (void)_recordQuery:(NSString *)query parameters:(PGQueryParameters *)params count:(NSInteger)nParams flags:(PGWorkloadEventFlags)flags
+			 session:(uint32_t)session start:(CFAbsoluteTime)start duration:(NSTimeInterval)duration status:(PGExecStatusType)status
+{
+	// Encode outside the lock
+	NSMutableData *record = [NSMutableData dataWithCapacity:64];
+	unsigned int *types = params.types;
+	const char **valrefs = params.valueRefs;
+	int *lengths = params.lengths;
+	int *formats = params.formats;
+
+	PGAppendUInt32(record, (uint32_t)flags);
+	PGAppendUInt64(record, (uint64_t)MAX(0, (start - _startTime) * 1000000.0));
+	PGAppendUInt32(record, (uint32_t)MIN(UINT32_MAX, duration * 1000000.0));
+	PGAppendUInt32(record, (uint32_t)status);
+	PGAppendUInt32(record, (uint32_t)nParams);
+
+	for (NSInteger i = 0; i < nParams; i++) {
+		int32_t length = (valrefs[i] == NULL) ? -1 : (formats[i] == 0) ? (int32_t)strlen(valrefs[i]) : lengths[i];
+
+		PGAppendUInt32(record, types[i]);
+		PGAppendUInt32(record, (uint32_t)formats[i]);
+		PGAppendUInt32(record, (uint32_t)length);
+		if (length >= 0)
+			[record appendBytes:valrefs[i] length:length + (formats[i] == 0 ? 1 : 0)];
+	}
+
+	@synchronized(self) {
+		if (!_file) return;
+
+		NSNumber *number = [_statementNumbers objectForKey:query];
+		if (!number) {
+			NSData *text = [query dataUsingEncoding:NSUTF8StringEncoding];
+
+			number = @(_statementNumbers.count);
+			[_statementNumbers setObject:number forKey:query];
+
+			[_buffer appendBytes:"S" length:1];
+			PGAppendUInt32(_buffer, number.unsignedIntValue);
+			PGAppendUInt32(_buffer, (uint32_t)text.length);
+			[_buffer appendData:text];
+		}
+
+		[_buffer appendBytes:"E" length:1];
+		PGAppendUInt32(_buffer, session);
+		PGAppendUInt32(_buffer, number.unsignedIntValue);
+		[_buffer appendData:record];
+
+		if (_buffer.length >= PGWorkloadBufferSize)
+			[self flush];
+	}
+}
+
+- (void)flush
+{
+	@synchronized(self) {
+		if (_file && _buffer.length) {
+			if (fwrite(_buffer.bytes, _buffer.length, 1, _file) != 1)
+				NSLog(@"workload capture %@: %s", _path, strerror(errno));
+			_buffer.length = 0;
+		}
+		if (_file) fflush(_file);
+	}
+}
+
+- (void)close
+{
+	@synchronized(self) {
+		[self flush];
+		if (_file) fclose(_file);
+		_file = NULL;
+	}
+}
+
+@end
+
+#pragma mark -
+
+@implementation PGWorkloadEvent
+
+@synthesize session = _session;
+@synthesize statementIndex = _statement;
+@synthesize flags = _flags;
+@synthesize startTime = _startTime;
+@synthesize duration = _duration;
+@synthesize status = _status;
+
+@end
+
+#pragma mark -
+
+/** Reads little-endian values from a capture, failing once it runs out of data. */
+typedef struct {
+	const uint8_t *bytes;
+	const uint8_t *end;
+	BOOL failed;
+} PGWorkloadReader;
+
+static const uint8_t *PGReadBytes(PGWorkloadReader *reader, size_t length)
+{
+	if (reader->failed || (size_t)(reader->end - reader->bytes) < length) {
+		reader->failed = YES;
+		return NULL;
+	}
+	const uint8_t *bytes = reader->bytes;
+	reader->bytes += length;
+	return bytes;
+}
+
+static uint32_t PGReadUInt32(PGWorkloadReader *reader)
+{
+	const uint8_t *bytes = PGReadBytes(reader, 4);
+	return bytes ? OSReadLittleInt32(bytes, 0) : 0;
+}
+
+static uint64_t PGReadUInt64(PGWorkloadReader *reader)
+{
+	const uint8_t *bytes = PGReadBytes(reader, 8);
+	return bytes ? OSReadLittleInt64(bytes, 0) : 0;
+}
+
+@implementation PGWorkloadCapture
+
+@synthesize statements = _statements;
+@synthesize events = _events;
+
+- (id)initWithContentsOfFile:(NSString *)path error:(NSError **)error
+{
+	if (!(self = [super init])) return nil;
+
+	_data = [[NSData alloc] initWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:error];
+	_prepared = [[NSMutableSet alloc] init];
+	if (!_data) {
+		[self release];
+		return nil;
+	}
+
+	PGWorkloadReader reader = { _data.bytes, (const uint8_t *)_data.bytes + _data.length, NO };
+	NSMutableArray *statements = [NSMutableArray array];
+	NSMutableArray *events = [NSMutableArray array];
+	NSString *reason = nil;
+
+	const uint8_t *magic = PGReadBytes(&reader, sizeof(PGWorkloadMagic));
+	if (!magic || memcmp(magic, PGWorkloadMagic, sizeof(PGWorkloadMagic)) != 0)
+		reason = @"The file is not a workload capture.";
+	else if (PGReadUInt32(&reader) != PGWorkloadCaptureVersion)
+		reason = @"The capture version is not supported.";
+	PGReadUInt64(&reader);  // start time
+
+	// A capture cut short, e.g., by a crash, is read up to its last complete record
+	while (!reason && !reader.failed && reader.bytes < reader.end) {
+		const uint8_t *type = PGReadBytes(&reader, 1);
+
+		if (*type == 'S') {
+			uint32_t number = PGReadUInt32(&reader);
+			uint32_t length = PGReadUInt32(&reader);
+			const uint8_t *text = PGReadBytes(&reader, length);
+
+			if (reader.failed || number != statements.count) break;
+
+			NSString *statement = [[NSString alloc] initWithBytes:text length:length encoding:NSUTF8StringEncoding];
+			[statements addObject:statement ? statement : @""];
+			[statement release];
+		}
+		else if (*type == 'E') {
+			PGWorkloadEvent *event = [[[PGWorkloadEvent alloc] init] autorelease];
+
+			event->_session = PGReadUInt32(&reader);
+			event->_statement = PGReadUInt32(&reader);
+			event->_flags = PGReadUInt32(&reader);
+			event->_startTime = PGReadUInt64(&reader) / 1000000.0;
+			event->_duration = PGReadUInt32(&reader) / 1000000.0;
+			event->_status = PGReadUInt32(&reader);
+			event->_parameterCount = PGReadUInt32(&reader);
+			event->_parameters = reader.bytes;
+
+			for (uint32_t i = 0; i < event->_parameterCount && !reader.failed; i++) {
+				PGReadUInt32(&reader);
+				int32_t format = PGReadUInt32(&reader);
+				int32_t length = PGReadUInt32(&reader);
+				if (length >= 0) PGReadBytes(&reader, length + (format == 0 ? 1 : 0));
+			}
+
+			if (reader.failed || event->_statement >= statements.count) break;
+			[events addObject:event];
+		}
+		else {
+			reason = @"The capture is damaged.";
+		}
+	}
+
+	if (reason) {
+		if (error) *error = PGWorkloadError(path, reason);
+		[self release];
+		return nil;
+	}
+
+	_statements = [statements copy];
+	_events = [events copy];
+
+	return self;
+}
+
+- (void)dealloc
+{
+	[_data release];
+	[_statements release];
+	[_events release];
+	[_prepared release];
+	[super dealloc];
+}
+
+- (PGResult *)replayEvent:(PGWorkloadEvent *)event connection:(PGConnection *)conn
+{
+	NSString *query = _statements[event->_statement];
+	int nParams = event->_parameterCount;
+	Oid types[nParams ? nParams : 1];
+	const char *values[nParams ? nParams : 1];
+	int lengths[nParams ? nParams : 1];
+	int formats[nParams ? nParams : 1];
+	const uint8_t *bytes = event->_parameters;
+
+	// Bounds were checked when the capture was read
+	for (int i = 0; i < nParams; i++) {
+		types[i] = OSReadLittleInt32(bytes, 0);
+		formats[i] = OSReadLittleInt32(bytes, 4);
+		lengths[i] = OSReadLittleInt32(bytes, 8);
+		bytes += 12;
+		values[i] = (lengths[i] < 0) ? NULL : (const char *)bytes;
+		if (lengths[i] >= 0) bytes += lengths[i] + (formats[i] == 0 ? 1 : 0);
+	}
+
+	PGresult *result;
+
+	if (event->_flags & kPGWorkloadEventBatch) {
+		result = PQexec(conn.conn, query.UTF8String);
+	}
+	else if (event->_flags & kPGWorkloadEventPrepared) {
+		NSString *name = [NSString stringWithFormat:@"pgreplay_%u", event->_statement];
+		NSString *key = [NSString stringWithFormat:@"%p/%u", conn, event->_statement];
+		BOOL prepared;
+
+		@synchronized(_prepared) {
+			prepared = [_prepared containsObject:key];
+		}
+		if (!prepared) {
+			PGresult *prepareResult = PQprepare(conn.conn, name.UTF8String, query.UTF8String, nParams, types);
+			if (PQresultStatus(prepareResult) != PGRES_COMMAND_OK)
+				return [conn _resultWithResult:prepareResult];
+			PQclear(prepareResult);
+
+			@synchronized(_prepared) {
+				[_prepared addObject:key];
+			}
+		}
+		result = PQexecPrepared(conn.conn, name.UTF8String, nParams, values, lengths, formats, 1);
+	}
+	else {
+		result = PQexecParams(conn.conn, query.UTF8String, nParams, types, values, lengths, formats, 1);
+	}
+
+	return [conn _resultWithResult:result];
+}
+
+- (void)forgetPreparedStatementsForConnection:(PGConnection *)conn
+{
+	NSString *prefix = [NSString stringWithFormat:@"%p/", conn];
+
+	@synchronized(_prepared) {
+		for (NSString *key in _prepared.allObjects) {
+			if ([key hasPrefix:prefix])
+				[_prepared removeObject:key];
+		}
+	}
+}
+
+@end
@@ -0,0 +1,99 @@
+//
+//  PGWriteCoalescer.h
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <dispatch/dispatch.h>
+
+@class PGConnection;
+
+/** Called once a row is committed, with nil, or with the error that prevented it. */
+typedef void (^PGWriteCompletion)(NSError *error);
+
+typedef enum {
+	kPGWriteMethodCopy = 0,	///< binary COPY FROM STDIN
+	kPGWriteMethodInsert	///< one multi-row INSERT per batch
+} PGWriteMethod;
+
+/** Combines single-row inserts from many threads into batches for one table.
+ * @discussion Rows are pushed onto a lock-free stack and written on the coalescer's
+ *             dedicated connection when maxBatchSize rows are waiting, or flushInterval
+ *             after the first of them was submitted. Each batch is one statement, and so
+ *             one transaction and one WAL flush, so the rate of inserts grows with the
+ *             batch size instead of being bound by round trips.
+ *
+ *             A row's completion is called after its batch commits. If a batch fails, its
+ *             rows are retried one at a time, so a row that violates a constraint fails
+ *             alone. Completions are called in submission order, on a private serial
+ *             queue unless completionQueue is set. On a concurrent completionQueue, only
+ *             the completions of one batch are called in order.
+ */
+@interface PGWriteCoalescer : NSObject
+{
+@private
+	PGConnection *_connection;
+	NSString *_table;
+	NSArray *_columns;
+	NSUInteger _numberOfColumns;
+	unsigned int *_types;		// Same type as Oid
+	void **_encoders;			// PGParameterEncoder for each column
+	PGWriteMethod _method;
+	NSString *_copyStatement;
+	NSString *_insertPrefix;
+	NSMutableData *_copyBuffer;
+
+	NSUInteger _maxBatchSize;
+	NSTimeInterval _flushInterval;
+	dispatch_queue_t _queue;
+	dispatch_queue_t _completionQueue;
+	dispatch_queue_t _serialCompletionQueue;	// used when _completionQueue is NULL
+
+	id volatile _submissions;	// lock-free stack of pending rows, newest first
+	volatile int32_t _count;	// rows submitted but not yet taken by a flush
+	volatile int32_t _closed;
+}
+
+@property (readonly) PGConnection *connection;
+@property (readonly) NSString *table;
+@property (readonly) NSArray *columns;
+
+/** COPY when every column's type has a binary encoding, else INSERT. A COPY batch with a
+ *  value that can't be encoded, such as a string for an integer column, is written with
+ *  INSERT, for the server to convert.
+ */
+@property (readonly) PGWriteMethod method;
+
+/** The most rows written in one statement. Defaults to 1000. */
+@property NSUInteger maxBatchSize;
+
+/** How long the first row waits for others to join its batch. Defaults to 5 ms. */
+@property NSTimeInterval flushInterval;
+
+/** The queue for completions; NULL for a private serial queue. */
+@property (assign) dispatch_queue_t completionQueue;
+
+/** Take over a connected connection, which must not be used directly afterward.
+ * @param table the table name, used as written, so it may be schema-qualified
+ * @param columns the names of the columns each row supplies, in order
+ * @return nil if the columns can't be described
+ */
+- (id)initWithConnection:(PGConnection *)conn table:(NSString *)table columns:(NSArray *)columns;
+
+/** Queue a row for insertion. Raises NSInvalidArgumentException if the number of values
+ *  doesn't match the columns.
+ * @param values basic types, as for -[PGConnection executeQuery:values:]
+ * @param completion called after the row is committed or fails; may be nil
+ */
+- (void)insertRow:(NSArray *)values completion:(PGWriteCompletion)completion;
+
+/** Write every row submitted so far and wait for their batches to commit. */
+- (void)flush;
+
+/** Stop accepting rows and write those pending. Later rows fail. Called by dealloc. */
+- (void)close;
+
+@end
@@ -0,0 +1,451 @@
+//
+//  PGWriteCoalescer.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+
+#import "PGWriteCoalescer.h"
+#import "PGConnection.h"
+#import "PGResult.h"
+#import "PGError.h"
+#import "PGQueryParameters_Private.h"
+#import "PGInternal.h"
+#import <libkern/OSAtomic.h>
+#import <pthread.h>
+
+#define kPGMaxParameters 65535	// the protocol's limit on parameters in one statement
+#define kPGTypeBPChar 1042		// char(n)
+
+static const char PGCopySignature[11] = "PGCOPY\n\377\r\n\0";
+
+/** The coalescer whose queue the thread is running a flush for, if any. */
+static pthread_key_t PGWriteCoalescerQueueKey;
+
+/** A submitted row, linked into the coalescer's stack. */
+@interface PGPendingWrite : NSObject
+{
+@public
+	PGPendingWrite *_next;
+	NSArray *_values;
+	PGWriteCompletion _completion;
+}
+@end
+
+@implementation PGPendingWrite
+
+- (void)dealloc
+{
+	[_values release];
+	[_completion release];
+	[super dealloc];
+}
+
+@end
+
+static BOOL PGTypeIsText(Oid type)
+{
+	return type == kPGQryParamText || type == kPGQryParamVarChar || type == kPGTypeBPChar;
+}
+
+static NSError *PGCoalescerError(NSString *description)
+{
+	return [NSError errorWithDomain:PostgreSQLErrorDomain code:-1 userInfo:@{ NSLocalizedDescriptionKey : description }];
+}
+
+#pragma mark -
+
+@implementation PGWriteCoalescer
+
+@synthesize connection = _connection;
+@synthesize table = _table;
+@synthesize columns = _columns;
+@synthesize method = _method;
+@synthesize maxBatchSize = _maxBatchSize;
+@synthesize flushInterval = _flushInterval;
+
++ (void)initialize
+{
+	if (self == [PGWriteCoalescer class])
+		pthread_key_create(&PGWriteCoalescerQueueKey, NULL);
+}
+
+- (id)initWithConnection:(PGConnection *)conn table:(NSString *)table columns:(NSArray *)columns
+{
+	if (self = [super init]) {
+		_connection = [conn retain];
+		_table = [table copy];
+		_columns = [columns copy];
+		_numberOfColumns = columns.count;
+		_maxBatchSize = 1000;
+		_flushInterval = 0.005;
+		_queue = dispatch_queue_create("PGWriteCoalescer", DISPATCH_QUEUE_SERIAL);
+		_serialCompletionQueue = dispatch_queue_create("PGWriteCoalescer.completion", DISPATCH_QUEUE_SERIAL);
+		_copyBuffer = [[NSMutableData alloc] init];
+
+		if (![self _describeColumns]) {
+			[self release];
+			return nil;
+		}
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self close];
+	dispatch_release(_queue);
+	dispatch_release(_serialCompletionQueue);
+	if (_completionQueue) dispatch_release(_completionQueue);
+	free(_types);
+	free(_encoders);
+	[_copyStatement release];
+	[_insertPrefix release];
+	[_copyBuffer release];
+	[_columns release];
+	[_table release];
+	[_connection release];
+	[super dealloc];
+}
+
+- (BOOL)_describeColumns
+{
+	if (_numberOfColumns == 0 || _numberOfColumns > kPGMaxParameters)
+		return NO;
+
+	NSMutableArray *quoted = [NSMutableArray arrayWithCapacity:_numberOfColumns];
+
+	for (NSString *column in _columns) {
+		char *identifier = PQescapeIdentifier(_connection.conn, column.UTF8String, strlen(column.UTF8String));
+		if (!identifier)
+			return NO;
+		[quoted addObject:[NSString stringWithUTF8String:identifier]];
+		PQfreemem(identifier);
+	}
+
+	NSString *list = [quoted componentsJoinedByString:@", "];
+	NSString *query = [NSString stringWithFormat:@"SELECT %@ FROM %@ LIMIT 0", list, _table];
+	PGresult *result = PQexec(_connection.conn, query.UTF8String);
+
+	if (PQresultStatus(result) != PGRES_TUPLES_OK) {
+		PQclear(result);
+		return NO;
+	}
+
+	_types = calloc(_numberOfColumns, sizeof(Oid));
+	_encoders = calloc(_numberOfColumns, sizeof(PGParameterEncoder));
+	_method = kPGWriteMethodCopy;
+
+	for (NSUInteger i = 0; i < _numberOfColumns; i++) {
+		_types[i] = PQftype(result, (int)i);
+		_encoders[i] = (void *)PGParameterEncoderForType(_types[i]);
+		if (!_encoders[i] && !PGTypeIsText(_types[i]))
+			_method = kPGWriteMethodInsert;
+	}
+	PQclear(result);
+
+	_copyStatement = [[NSString alloc] initWithFormat:@"COPY %@ (%@) FROM STDIN (FORMAT binary)", _table, list];
+	_insertPrefix = [[NSString alloc] initWithFormat:@"INSERT INTO %@ (%@) VALUES ", _table, list];
+
+	return YES;
+}
+
+- (dispatch_queue_t)completionQueue
+{
+	@synchronized(self) {
+		return _completionQueue;
+	}
+}
+
+- (void)setCompletionQueue:(dispatch_queue_t)queue
+{
+	@synchronized(self) {
+		if (queue) dispatch_retain(queue);
+		if (_completionQueue) dispatch_release(_completionQueue);
+		_completionQueue = queue;
+	}
+}
+
+#pragma mark Submission
+
+- (void)insertRow:(NSArray *)values completion:(PGWriteCompletion)completion
+{
+	if (values.count != _numberOfColumns)
+		[NSException raise:NSInvalidArgumentException format:@"row has %lu values for %lu columns", (unsigned long)values.count, (unsigned long)_numberOfColumns];
+
+	if (_closed) {
+		if (completion) {
+			dispatch_async([self _completionQueue], ^{
+				completion(PGCoalescerError(@"The write coalescer is closed."));
+			});
+		}
+		return;
+	}
+
+	PGPendingWrite *write = [[PGPendingWrite alloc] init];
+	write->_values = [values copy];
+	write->_completion = [completion copy];
+
+	// Push onto the stack; the +1 reference belongs to the stack until a flush takes it
+	id head;
+	do {
+		head = _submissions;
+		write->_next = head;
+	} while (!OSAtomicCompareAndSwapPtrBarrier(head, write, (void * volatile *)&_submissions));
+
+	int32_t count = OSAtomicIncrement32Barrier(&_count);
+
+	if (count == 1)
+		[self _scheduleFlushAfterInterval];
+	else if (count == (int32_t)_maxBatchSize || _closed)	// -close may have taken the stack before this push
+		dispatch_async(_queue, [self _flushBlock]);
+}
+
+- (void)_scheduleFlushAfterInterval
+{
+	dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_flushInterval * NSEC_PER_SEC)), _queue, [self _flushBlock]);
+}
+
+/** A block for _queue that flushes with the thread marked as on the queue. The block holds
+ *  the coalescer until it returns, so a last release there happens where -flush can tell
+ *  it is on the queue.
+ */
+- (dispatch_block_t)_flushBlock
+{
+	__block PGWriteCoalescer *blockSelf = [self retain];
+
+	return [[^{
+		void *outer = pthread_getspecific(PGWriteCoalescerQueueKey);
+
+		pthread_setspecific(PGWriteCoalescerQueueKey, blockSelf);
+		[blockSelf _flush];
+		[blockSelf release];
+		pthread_setspecific(PGWriteCoalescerQueueKey, outer);
+	} copy] autorelease];
+}
+
+- (void)flush
+{
+	if (pthread_getspecific(PGWriteCoalescerQueueKey) == self)
+		[self _flush];
+	else
+		dispatch_sync(_queue, ^{ [self _flush]; });	// the caller holds the coalescer, which may be in -dealloc
+}
+
+- (void)close
+{
+	if (!OSAtomicCompareAndSwap32Barrier(0, 1, &_closed)) return;
+
+	[self flush];
+}
+
+#pragma mark Writing
+
+/** Take every row from the stack and write them in batches, in the order submitted. */
+- (void)_flush
+{
+	PGPendingWrite *list;
+
+	do {
+		list = _submissions;
+	} while (list && !OSAtomicCompareAndSwapPtrBarrier(list, nil, (void * volatile *)&_submissions));
+
+	if (!list) return;
+
+	NSMutableArray *writes = [NSMutableArray array];
+	for (PGPendingWrite *write = list, *next; write; write = next) {
+		next = write->_next;
+		write->_next = nil;
+		[writes addObject:write];
+		[write release];
+	}
+
+	// Rows pushed while this flush was taking the stack didn't start a timer
+	int32_t remaining = OSAtomicAdd32Barrier(-(int32_t)writes.count, &_count);
+	if (remaining >= (int32_t)_maxBatchSize)
+		dispatch_async(_queue, [self _flushBlock]);
+	else if (remaining > 0)
+		[self _scheduleFlushAfterInterval];
+
+	NSArray *ordered = writes.reverseObjectEnumerator.allObjects;	// the stack is newest first
+	NSUInteger batchSize = MAX(MIN(_maxBatchSize, kPGMaxParameters / _numberOfColumns), 1);
+
+	for (NSUInteger i = 0; i < ordered.count; i += batchSize) {
+		@autoreleasepool {
+			NSArray *batch = [ordered subarrayWithRange:NSMakeRange(i, MIN(batchSize, ordered.count - i))];
+			[self _writeBatch:batch];
+		}
+	}
+}
+
+- (void)_writeBatch:(NSArray *)batch
+{
+	PGresult *result = NULL;
+
+	if (_method == kPGWriteMethodCopy && [self _encodeCopyData:batch])
+		result = [self _sendCopyData];
+	else
+		result = [self _insertRows:batch];
+
+	if (PQresultStatus(result) == PGRES_COMMAND_OK) {
+		PQclear(result);
+		[self _completeWrites:batch error:nil];
+		return;
+	}
+
+	NSError *error = [PGError errorWithResult:[PGResult _resultWithResult:result]];
+
+	if (batch.count == 1 || PQstatus(_connection.conn) != CONNECTION_OK) {
+		[self _completeWrites:batch error:error];
+		return;
+	}
+
+	// One bad row fails the whole statement; find it by writing the rows singly
+	for (PGPendingWrite *write in batch) {
+		NSArray *single = @[ write ];
+		result = [self _insertRows:single];
+
+		if (PQresultStatus(result) == PGRES_COMMAND_OK) {
+			PQclear(result);
+			error = nil;
+		}
+		else {
+			error = [PGError errorWithResult:[PGResult _resultWithResult:result]];
+		}
+		[self _completeWrites:single error:error];
+	}
+}
+
+/** The queue set by the caller, else the private serial one, which keeps batches in order. */
+- (dispatch_queue_t)_completionQueue
+{
+	dispatch_queue_t queue = self.completionQueue;
+	return queue ? queue : _serialCompletionQueue;
+}
+
+- (void)_completeWrites:(NSArray *)writes error:(NSError *)error
+{
+	// One block per batch keeps the batch's completions in order and costs one dispatch
+	dispatch_async([self _completionQueue], ^{
+		for (PGPendingWrite *write in writes) {
+			if (write->_completion)
+				write->_completion(error);
+		}
+	});
+}
+
+/** Encode the rows in the binary COPY format. Returns NO if a value has no binary encoding. */
+- (BOOL)_encodeCopyData:(NSArray *)batch
+{
+	NSMutableData *buffer = _copyBuffer;
+	int32_t header[2] = { 0, 0 };	// flags, extension length
+	int16_t fieldCount = NSSwapHostShortToBig((int16_t)_numberOfColumns);
+	int16_t trailer = NSSwapHostShortToBig(-1);
+
+	buffer.length = 0;
+	[buffer appendBytes:PGCopySignature length:sizeof(PGCopySignature)];
+	[buffer appendBytes:header length:sizeof(header)];
+
+	for (PGPendingWrite *write in batch) {
+		[buffer appendBytes:&fieldCount length:sizeof(fieldCount)];
+
+		for (NSUInteger i = 0; i < _numberOfColumns; i++) {
+			id value = write->_values[i];
+			pg_value_t storage;
+			const char *ref = storage.bytes;
+			int length = 0;
+			int32_t swapped;
+
+			if (value == NSNull.null) {
+				swapped = NSSwapHostIntToBig(-1);
+				[buffer appendBytes:&swapped length:sizeof(swapped)];
+				continue;
+			}
+
+			if (PGTypeIsText(_types[i]) && [value isKindOfClass:NSString.class]) {
+				ref = [value UTF8String];
+				length = (int)strlen(ref);
+			}
+			else if (!_encoders[i] || !((PGParameterEncoder)_encoders[i])(value, &storage, &ref, &length)) {
+				return NO;
+			}
+
+			swapped = NSSwapHostIntToBig(length);
+			[buffer appendBytes:&swapped length:sizeof(swapped)];
+			[buffer appendBytes:ref length:length];
+		}
+	}
+
+	[buffer appendBytes:&trailer length:sizeof(trailer)];
+	return YES;
+}
+
+/** Send the encoded COPY data and return the final result. */
+- (PGresult *)_sendCopyData
+{
+	PGconn *conn = _connection.conn;
+	PGresult *result = PQexec(conn, _copyStatement.UTF8String);
+
+	if (PQresultStatus(result) != PGRES_COPY_IN)
+		return result;
+	PQclear(result);
+
+	const char *bytes = _copyBuffer.bytes;
+	NSUInteger length = _copyBuffer.length;
+	BOOL sent = YES;
+
+	// PQputCopyData() takes an int length, so large batches are sent in pieces
+	for (NSUInteger offset = 0; sent && offset < length; offset += INT_MAX) {
+		int chunk = (int)MIN(length - offset, (NSUInteger)INT_MAX);
+		sent = PQputCopyData(conn, bytes + offset, chunk) == 1;
+	}
+
+	PQputCopyEnd(conn, sent ? NULL : "client failed to send data");
+
+	// Keep the last result, as for a batch; a failed COPY reports its error there
+	PGresult *next;
+	result = NULL;
+	while ((next = PQgetResult(conn))) {
+		if (result) PQclear(result);
+		result = next;
+	}
+
+	return result ? result : PQmakeEmptyPGresult(conn, PGRES_FATAL_ERROR);
+}
+
+/** Insert the rows with one multi-row INSERT, binding values by the columns' types. */
+- (PGresult *)_insertRows:(NSArray *)batch
+{
+	NSUInteger count = batch.count * _numberOfColumns;
+	NSMutableString *query = [NSMutableString stringWithString:_insertPrefix];
+	NSMutableArray *values = [NSMutableArray arrayWithCapacity:count];
+	Oid *types = malloc(count * sizeof(Oid));
+	PGParameterEncoder *encoders = malloc(count * sizeof(PGParameterEncoder));
+	NSUInteger n = 0;
+
+	for (PGPendingWrite *write in batch) {
+		[query appendString:(n ? @", (" : @"(")];
+
+		for (NSUInteger i = 0; i < _numberOfColumns; i++, n++) {
+			types[n] = _types[i];
+			encoders[n] = (PGParameterEncoder)_encoders[i];
+			[query appendFormat:(i ? @", $%lu" : @"$%lu"), (unsigned long)n + 1];
+		}
+		[query appendString:@")"];
+		[values addObjectsFromArray:write->_values];
+	}
+
+	PGQueryParameters *params = [[[PGQueryParameters alloc] initWithValues:nil] autorelease];
+	NSInteger nParams = [params _bindValues:values types:types encoders:encoders count:count];
+
+	free(types);
+	free(encoders);
+
+	if (nParams < 0)
+		return PQmakeEmptyPGresult(_connection.conn, PGRES_FATAL_ERROR);
+
+	return PQexecParams(_connection.conn, query.UTF8String, (int)nParams, params.types, params.valueRefs, params.lengths, params.formats, 0);
+}
+
+@end
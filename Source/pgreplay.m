@@ -0,0 +1,230 @@
+//
+//  pgreplay.m
+//  PGCocoa
+//
+//  Created by Aaron Burghardt on 10/19/26.
+//  Copyright 2026. All rights reserved.
+//
+//  Replays a workload captured with PGWorkloadRecorder and reports throughput and latency.
+//
+
+#import <Foundation/Foundation.h>
+#import <PGCocoa/PGConnection.h>
+#import <PGCocoa/PGResult.h>
+#import <PGCocoa/PGWorkloadRecorder.h>
+#import <libkern/OSAtomic.h>
+#import <err.h>
+#import <getopt.h>
+#import <mach/mach_time.h>
+#import <sysexits.h>
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: pgreplay [-h host] [-p port] [-d database] [-U user] [-c connections] [-s speedup] [-n statements] capture\n"
+					"  -c  sessions replayed at once, each on its own connection (default 4)\n"
+					"  -s  replay speed relative to the capture; 0 sends each statement as soon as\n"
+					"      the previous one in its session completes (default 1)\n"
+					"  -n  number of statements listed in the report (default 20)\n");
+	exit(EX_USAGE);
+}
+
+static double PGSeconds(uint64_t machTime)
+{
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0) mach_timebase_info(&timebase);
+
+	return (double)machTime * timebase.numer / timebase.denom / 1e9;
+}
+
+static int PGCompareDoubles(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/** The value at a percentile of a sorted array. */
+static double PGPercentile(const double *sorted, NSUInteger count, double percentile)
+{
+	if (count == 0) return 0;
+
+	NSUInteger index = (NSUInteger)(percentile / 100.0 * (count - 1) + 0.5);
+	return sorted[MIN(index, count - 1)];
+}
+
+/** Latencies in seconds for each statement, appended by one worker. */
+typedef struct {
+	NSMutableData **latencies;	// doubles, indexed by statement number
+	NSUInteger errors;
+} PGWorkerStats;
+
+int main(int argc, char *argv[])
+{
+	@autoreleasepool {
+		NSMutableDictionary *params = [NSMutableDictionary dictionary];
+		NSUInteger connections = 4, listed = 20;
+		double speedup = 1.0;
+		int ch;
+
+		while ((ch = getopt(argc, argv, "h:p:d:U:c:s:n:")) != -1) {
+			switch (ch) {
+				case 'h': params[PGConnectionParameterHostKey] = @(optarg); break;
+				case 'p': params[PGConnectionParameterPortKey] = @(optarg); break;
+				case 'd': params[PGConnectionParameterDatabaseNameKey] = @(optarg); break;
+				case 'U': params[PGConnectionParameterUsernameKey] = @(optarg); break;
+				case 'c': connections = strtoul(optarg, NULL, 10); break;
+				case 's': speedup = strtod(optarg, NULL); break;
+				case 'n': listed = strtoul(optarg, NULL, 10); break;
+				default:  usage();
+			}
+		}
+		if (optind != argc - 1 || connections == 0 || speedup < 0)
+			usage();
+
+		NSError *error = nil;
+		PGWorkloadCapture *capture = [[PGWorkloadCapture alloc] initWithContentsOfFile:@(argv[optind]) error:&error];
+		if (!capture)
+			errx(EX_DATAERR, "%s", error.localizedFailureReason.UTF8String);
+
+		NSUInteger statementCount = capture.statements.count;
+
+		// Each session replays in order on a connection of its own, so its statements run in
+		// the transactions and session state they were captured in. At most `connections`
+		// sessions run at once; a worker takes the next session to start when one ends.
+
+		NSMutableDictionary *bySession = [NSMutableDictionary dictionary];
+		for (PGWorkloadEvent *event in capture.events) {
+			NSMutableArray *events = bySession[@(event.session)];
+			if (!events) bySession[@(event.session)] = events = [NSMutableArray array];
+			[events addObject:event];
+		}
+
+		NSSortDescriptor *byStart = [NSSortDescriptor sortDescriptorWithKey:@"startTime" ascending:YES];
+		for (NSMutableArray *events in bySession.allValues)
+			[events sortUsingDescriptors:@[ byStart ]];
+
+		NSArray *sessions = [bySession.allValues sortedArrayUsingComparator:^NSComparisonResult(NSArray *a, NSArray *b) {
+			double x = [a[0] startTime], y = [b[0] startTime];
+			return (x < y) ? NSOrderedAscending : (x > y) ? NSOrderedDescending : NSOrderedSame;
+		}];
+		__block volatile int32_t nextSession = 0;
+
+		PGWorkerStats *stats = calloc(connections, sizeof(PGWorkerStats));
+		for (NSUInteger i = 0; i < connections; i++) {
+			stats[i].latencies = calloc(statementCount ? statementCount : 1, sizeof(NSMutableData *));
+			for (NSUInteger s = 0; s < statementCount; s++)
+				stats[i].latencies[s] = [[NSMutableData alloc] init];
+		}
+
+		printf("replaying %lu statements from %lu sessions, %lu at a time\n", (unsigned long)capture.events.count,
+			   (unsigned long)sessions.count, (unsigned long)connections);
+
+		uint64_t replayStart = mach_absolute_time();
+		dispatch_group_t group = dispatch_group_create();
+
+		// A serial queue per worker gets its own thread, however many cores there are
+		for (NSUInteger worker = 0; worker < connections; worker++) {
+			dispatch_queue_t queue = dispatch_queue_create("pgreplay.worker", DISPATCH_QUEUE_SERIAL);
+			dispatch_group_async(group, queue, ^{
+				PGWorkerStats *workerStats = &stats[worker];
+				int32_t index;
+
+				while ((index = OSAtomicIncrement32Barrier(&nextSession) - 1) < (int32_t)sessions.count) {
+					PGConnection *conn = [[PGConnection alloc] initWithParameters:params];
+					if (![conn connect])
+						errx(EX_UNAVAILABLE, "connect: %s", conn.errorMessage.UTF8String);
+
+					for (PGWorkloadEvent *event in sessions[index]) {
+						@autoreleasepool {
+							if (speedup > 0) {
+								double due = event.startTime / speedup - PGSeconds(mach_absolute_time() - replayStart);
+								if (due > 0) usleep((useconds_t)(due * 1e6));
+							}
+
+							uint64_t start = mach_absolute_time();
+							PGResult *result = [capture replayEvent:event connection:conn];
+							double latency = PGSeconds(mach_absolute_time() - start);
+
+							[workerStats->latencies[event.statementIndex] appendBytes:&latency length:sizeof(latency)];
+
+							PGExecStatusType status = result.status;
+							if ((status == kPGResultFatalError || status == kPGResultBadResponse) && event.status != status)
+								workerStats->errors++;
+						}
+					}
+
+					[capture forgetPreparedStatementsForConnection:conn];
+					[conn disconnect];
+					[conn release];
+				}
+			});
+			dispatch_release(queue);
+		}
+
+		dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+		dispatch_release(group);
+
+		double elapsed = PGSeconds(mach_absolute_time() - replayStart);
+
+		// Merge each statement's latencies and sort them for percentiles
+
+		NSMutableArray *rows = [NSMutableArray arrayWithCapacity:statementCount];
+		NSMutableData *all = [NSMutableData data];
+		NSUInteger errors = 0;
+
+		for (NSUInteger i = 0; i < connections; i++)
+			errors += stats[i].errors;
+
+		for (NSUInteger s = 0; s < statementCount; s++) {
+			NSMutableData *latencies = [NSMutableData data];
+			for (NSUInteger i = 0; i < connections; i++) {
+				[latencies appendData:stats[i].latencies[s]];
+				[stats[i].latencies[s] release];
+			}
+			if (latencies.length == 0) continue;
+
+			qsort(latencies.mutableBytes, latencies.length / sizeof(double), sizeof(double), PGCompareDoubles);
+			[all appendData:latencies];
+
+			double total = 0;
+			for (NSUInteger j = 0; j < latencies.length / sizeof(double); j++)
+				total += ((double *)latencies.bytes)[j];
+
+			[rows addObject:@{ @"statement" : @(s), @"latencies" : latencies, @"total" : @(total) }];
+		}
+		for (NSUInteger i = 0; i < connections; i++)
+			free(stats[i].latencies);
+		free(stats);
+
+		qsort(all.mutableBytes, all.length / sizeof(double), sizeof(double), PGCompareDoubles);
+		NSUInteger count = all.length / sizeof(double);
+
+		printf("%lu statements in %.3f s: %.1f statements/s, %lu new errors\n",
+			   (unsigned long)count, elapsed, elapsed > 0 ? count / elapsed : 0.0, (unsigned long)errors);
+		printf("latency ms: p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n\n",
+			   PGPercentile(all.bytes, count, 50) * 1000, PGPercentile(all.bytes, count, 95) * 1000,
+			   PGPercentile(all.bytes, count, 99) * 1000, PGPercentile(all.bytes, count, 100) * 1000);
+
+		// Statements by total time, the ones most worth optimizing first
+
+		[rows sortUsingDescriptors:@[ [NSSortDescriptor sortDescriptorWithKey:@"total" ascending:NO] ]];
+
+		printf("%8s %10s %9s %9s %9s %9s  %s\n", "count", "total s", "p50 ms", "p95 ms", "p99 ms", "max ms", "statement");
+
+		for (NSDictionary *row in [rows subarrayWithRange:NSMakeRange(0, MIN(listed, rows.count))]) {
+			NSData *latencies = row[@"latencies"];
+			NSUInteger n = latencies.length / sizeof(double);
+			NSString *sql = capture.statements[[row[@"statement"] unsignedIntegerValue]];
+
+			sql = [[sql componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] componentsJoinedByString:@" "];
+			if (sql.length > 60) sql = [[sql substringToIndex:57] stringByAppendingString:@"..."];
+
+			printf("%8lu %10.3f %9.3f %9.3f %9.3f %9.3f  %s\n", (unsigned long)n, [row[@"total"] doubleValue],
+				   PGPercentile(latencies.bytes, n, 50) * 1000, PGPercentile(latencies.bytes, n, 95) * 1000,
+				   PGPercentile(latencies.bytes, n, 99) * 1000, PGPercentile(latencies.bytes, n, 100) * 1000, sql.UTF8String);
+		}
+
+		[capture release];
+	}
+
+	return 0;
+}
@@ -11,9 +11,26 @@
 #import <PGCocoa/PGResult.h>
 #import <PGCocoa/PGPreparedQuery.h>
 #import <PGCocoa/PGRow.h>
+#import <PGCocoa/PGError.h>
+#import <PGCocoa/PGQueryCache.h>
+#import <PGCocoa/PGLargeObject.h>
+#import <PGCocoa/PGReplicaRouter.h>
+#import <PGCocoa/PGResultSnapshot.h>
+#import <PGCocoa/PGRowMapper.h>
+#import <PGCocoa/PGConnectionMultiplexer.h>
+#import <PGCocoa/PGWorkloadRecorder.h>
+#import <PGCocoa/PGWriteCoalescer.h>
+#import <PGCocoa/PGShardRouter.h>
+#import <PGCocoa/PGParallelScan.h>
+#import <PGCocoa/PGReplicationStream.h>
+#import <PGCocoa/PGResultStructs.h>
+#import <PGCocoa/PGResultWriter.h>
+#import "PGQuery Tool/PGQueryResultModel.h"
 #import <err.h>
 #import <errno.h>
+#import <fcntl.h>
 #import <syslog.h>
+#import <libkern/OSAtomic.h>
 
 static NSString *table_ints   = @"CREATE TEMP TABLE ints (val1 BOOLEAN, val16 SMALLINT, val32 INTEGER, val64 BIGINT);";
 static NSString *table_floats = @"CREATE TEMP TABLE floats (val4 FLOAT4, val8 DOUBLE PRECISION, val15 DECIMAL(30, 5));";
@@ -241,6 +258,1044 @@ void TestPreparedInts(PGConnection *conn)
 	[query deallocate];
 }
 
+void TestPreparedDescription(PGConnection *conn)
+{
+	printf("%s:\n", __func__);
+
+	PGResult *result;
+	PGPreparedQuery *query;
+
+	query = [PGPreparedQuery queryWithName:@"describe" sql:@"SELECT $1::int8 + 1 AS n, $2::text AS t" types:nil connection:conn];
+	if (!query)
+		errx(EXIT_FAILURE, "prepare: %s", conn.error.description.UTF8String);
+
+	NSCAssert(query.numberOfParameters == 2, @"query.numberOfParameters == 2");
+	NSCAssert([query typeOfParameterAtIndex:0] == kPGQryParamInt64, @"[query typeOfParameterAtIndex:0] == kPGQryParamInt64");
+	NSCAssert([query.fieldNames isEqual:(@[ @"n", @"t" ])], @"[query.fieldNames isEqual:(@[ @\"n\", @\"t\" ])]");
+
+	// an int is widened to the int8 the server expects; a string is converted by the server
+
+	result = [query executeWithValues:@[ @(41), @"x" ]];
+	NSCAssert([result[0][@"n"] isEqual:@(42)], @"[result[0][@\"n\"] isEqual:@(42)]");
+	NSCAssert([result[0][@"t"] isEqual:@"x"], @"[result[0][@\"t\"] isEqual:@\"x\"]");
+
+	result = [query executeWithValues:@[ @"7", [NSNull null] ]];
+	NSCAssert([result[0][0] isEqual:@(8)], @"[result[0][0] isEqual:@(8)]");
+	NSCAssert(result[0][1] == [NSNull null], @"result[0][1] == [NSNull null]");
+
+	[query deallocate];
+}
+
+void TestTransactionBlocks(PGConnection *conn)
+{
+	printf("%s:\n", __func__);
+
+	PGResult *result;
+	NSError *error = nil;
+	BOOL success;
+
+	// main() has already begun a transaction, so both blocks run within savepoints
+
+	success = [conn performTransaction:^BOOL(PGConnection *conn, NSError **error) {
+		PGResult *result = [conn executeQuery:qryInsertInts values:@[ @(YES), @(1), @(2), @(3) ]];
+		if (result.status != kPGResultCommandOK) {
+			*error = result.error;
+			return NO;
+		}
+
+		// the inner block's insert is rolled back without affecting the outer block
+		[conn performTransaction:^BOOL(PGConnection *conn, NSError **error) {
+			[conn executeQuery:qryInsertInts values:@[ @(NO), @(4), @(5), @(6) ]];
+			return NO;
+		} error:NULL];
+
+		return YES;
+	} error:&error];
+
+	if (!success)
+		errx(EXIT_FAILURE, "%s", error.description.UTF8String);
+
+	result = [conn executeQuery:qrySelectInts];
+	NSCAssert(result.numberOfRows == 1, @"result.numberOfRows == 1");
+
+	// a failed statement rolls back the savepoint even if the block returns YES
+
+	success = [conn performTransaction:^BOOL(PGConnection *conn, NSError **error) {
+		[conn executeQuery:@"SELECT * FROM no_such_table;"];
+		return YES;
+	} error:&error];
+
+	NSCAssert(!success, @"!success");
+	NSCAssert(conn.transactionStatus == kPGTransactionInTransaction, @"conn.transactionStatus == kPGTransactionInTransaction");
+
+	[conn executeQuery:qryDeleteInts];
+}
+
+void TestErrors(PGConnection *conn)
+{
+	printf("%s:\n", __func__);
+
+	__block PGError *error = nil;
+
+	[conn performTransaction:^BOOL(PGConnection *conn, NSError **outError) {
+		PGResult *result = [conn executeQuery:@"SELECT * FROM no_such_table;"];
+		error = [result.error retain];
+		return NO;
+	} error:NULL];
+
+	NSCAssert(error.code == kPGSQLStateUndefinedTable, @"error.code == kPGSQLStateUndefinedTable");
+	NSCAssert([error.sqlStateString isEqual:@"42P01"], @"[error.sqlStateString isEqual:@\"42P01\"]");
+	NSCAssert(!error.isRetryable, @"!error.isRetryable");
+	NSCAssert(error.userInfo == error.userInfo, @"userInfo is built once");
+
+	[error release];
+
+	// an error detected by the client has no SQLSTATE, which is distinct from success
+
+	[conn performTransaction:^BOOL(PGConnection *conn, NSError **outError) {
+		conn.maxResultBytes = 1;
+		PGResult *result = [conn executeQuery:@"SELECT generate_series(1, 100000);"];
+		conn.maxResultBytes = 0;
+		error = [result.error retain];
+		return NO;
+	} error:NULL];
+
+	NSCAssert(error.code == kPGSQLStateNone, @"error.code == kPGSQLStateNone");
+	NSCAssert(error.sqlStateString == nil, @"error.sqlStateString == nil");
+
+	[error release];
+}
+
+void TestResultLimits(PGConnection *conn)
+{
+	printf("%s:\n", __func__);
+
+	static NSString *qrySeries = @"SELECT generate_series(1, 100000);";
+
+	// cancelled queries abort the transaction, so roll back to a savepoint afterward
+
+	[conn performTransaction:^BOOL(PGConnection *conn, NSError **error) {
+		PGResult *result;
+
+		result = [conn executeQuery:qrySeries];
+		NSCAssert(conn.memoryAccount.bytes >= result.memorySize, @"conn.memoryAccount.bytes >= result.memorySize");
+
+		conn.maxResultBytes = result.memorySize / 2;
+		result = [conn executeQuery:qrySeries];
+		conn.maxResultBytes = 0;
+		NSCAssert(result.status == kPGResultFatalError, @"result.status == kPGResultFatalError");
+		NSCAssert([result.error.localizedDescription rangeOfString:@"limit"].location != NSNotFound, @"limit error message");
+
+		// the fields are charged once, so a limit just above the complete result is not exceeded
+		PGResult *complete = [conn executeQuery:@"SELECT generate_series(1, 1000) AS n;"];
+		conn.maxResultBytes = complete.memorySize;
+		result = [conn executeQuery:@"SELECT generate_series(1, 1000) AS n;"];
+		conn.maxResultBytes = 0;
+		NSCAssert(result.status == kPGResultTuplesOK && result.numberOfRows == 1000, @"result within limit");
+
+		return NO;
+	} error:NULL];
+
+	[conn performTransaction:^BOOL(PGConnection *conn, NSError **error) {
+		PGResult *result;
+		__block NSUInteger count = 0;
+
+		result = [conn executeQuery:qrySeries values:nil rowHandler:^(PGRow *row, BOOL *stop) {
+			*stop = (++count == 10);
+		}];
+		NSCAssert(count == 10, @"count == 10");
+		NSCAssert(result.error.code == kPGSQLStateQueryCanceled, @"result.error.code == kPGSQLStateQueryCanceled");
+
+		return NO;
+	} error:NULL];
+}
+
+void TestQueryCache(PGConnection *conn)
+{
+	printf("%s:\n", __func__);
+
+	PGQueryCache *cache;
+	PGResult *result1, *result2;
+
+	cache = [[PGQueryCache alloc] initWithMaxBytes:1024 * 1024 timeToLive:60.0];
+	conn.queryCache = cache;
+
+	result1 = [conn executeCachedQuery:@"SELECT $1::int4 + 1;" values:@[ @(41) ] tags:@[ @"ints" ]];
+	result2 = [conn executeCachedQuery:@"SELECT $1::int4 + 1;" values:@[ @(41) ] tags:@[ @"ints" ]];
+	NSCAssert(result1 == result2, @"result1 == result2");
+	NSCAssert(cache.hits == 1, @"cache.hits == 1");
+
+	[conn executeCachedQuery:@"SELECT $1::int4 + 1;" values:@[ @(42) ] tags:@[ @"ints" ]];
+	NSCAssert(cache.count == 2, @"cache.count == 2");
+
+	[cache invalidateTag:@"ints"];
+	NSCAssert(cache.count == 0, @"cache.count == 0");
+
+	// a result read before an invalidation is not cached after it
+	NSUInteger generation = [cache generationForTags:@[ @"ints" ]];
+	[cache invalidateTag:@"ints"];
+	[cache setResult:result1 forKey:[NSData dataWithBytes:"stale" length:5] tags:@[ @"ints" ] generation:generation];
+	NSCAssert(cache.count == 0, @"stale result not cached");
+
+	conn.queryCache = nil;
+	[cache release];
+}
+
+void TestLargeObjects(PGConnection *conn)
+{
+	printf("%s:\n", __func__);
+
+	PGLargeObject *object;
+	NSMutableData *data;
+	NSData *readData;
+	unsigned int oid;
+
+	data = [NSMutableData dataWithLength:1000000];
+	for (NSUInteger i = 0; i < data.length; i++)
+		((uint8_t *)data.mutableBytes)[i] = i % 251;
+
+	object = [conn createLargeObject];
+	if (!object)
+		errx(EXIT_FAILURE, "lo_creat: %s", conn.errorMessage.UTF8String);
+
+	oid = object.oid;
+	object.chunkSize = 64 * 1024;
+
+	NSInputStream *stream = [NSInputStream inputStreamWithData:data];
+	[stream open];
+	if (![object writeContentsOfStream:stream])
+		errx(EXIT_FAILURE, "lo_write: %s", conn.errorMessage.UTF8String);
+	[stream close];
+	[object close];
+
+	object = [conn openLargeObject:oid mode:kPGLargeObjectModeRead];
+	readData = [object readDataOfLength:data.length + 1];
+	NSCAssert([readData isEqual:data], @"[readData isEqual:data]");
+	[object close];
+
+	[PGLargeObject unlinkOid:oid connection:conn];
+}
+
+void TestBatch(PGConnection *conn)
+{
+	printf("%s:\n", __func__);
+
+	NSArray *results;
+
+	results = [conn executeQueries:@[ @"SELECT 1", @"SELECT 'two';", @"SELECT 3.0" ]];
+	NSCAssert(results.count == 3, @"results.count == 3");
+	NSCAssert([[results[1] valueAtRowIndex:0 fieldIndex:0] isEqual:@"two"], @"results[1] == 'two'");
+
+	// the failed statement aborts the transaction, so roll back to a savepoint afterward
+
+	[conn performTransaction:^BOOL(PGConnection *conn, NSError **error) {
+		NSArray *results = [conn executeBatch:@"SELECT 1; SELECT * FROM no_such_table; SELECT 3;"];
+		NSCAssert(results.count == 2, @"results.count == 2");
+		NSCAssert([results[1] status] == kPGResultFatalError, @"[results[1] status] == kPGResultFatalError");
+		return NO;
+	} error:NULL];
+}
+
+void TestQueryResultModel(PGConnection *conn)
+{
+	printf("%s:\n", __func__);
+
+	PGResult *result = [conn executeQuery:@"CREATE TEMP TABLE model_rows AS SELECT g AS n, 'row ' || g AS t FROM generate_series(1, 25000) g"];
+	NSCAssert(result.status == kPGResultCommandOK, @"CREATE TEMP TABLE model_rows");
+
+	dispatch_queue_t fetchQueue = dispatch_queue_create("pgtest.model.fetch", DISPATCH_QUEUE_SERIAL);
+	dispatch_queue_t callbackQueue = dispatch_queue_create("pgtest.model.callback", DISPATCH_QUEUE_SERIAL);
+	dispatch_semaphore_t changed = dispatch_semaphore_create(0);
+
+	// wait for a condition, checking it after each change
+	void (^waitFor)(BOOL (^)(void)) = ^(BOOL (^condition)(void)) {
+		while (!condition())
+			NSCAssert(dispatch_semaphore_wait(changed, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)) == 0, @"model changed within 10 seconds");
+	};
+
+	PGQueryResultModel *model = [[PGQueryResultModel alloc] initWithConnection:conn query:@"SELECT n, t FROM model_rows ORDER BY n;"
+																		 queue:fetchQueue pageSize:100];
+	model.callbackQueue = callbackQueue;
+	model.changeHandler = ^{ dispatch_semaphore_signal(changed); };
+	[model start];
+
+	waitFor(^BOOL{ return [model valueAtRow:0 column:0] != nil; });
+	NSCAssert([model.fieldNames isEqual:(@[ @"n", @"t" ])], @"model.fieldNames == (n, t)");
+	NSCAssert([[model valueAtRow:99 column:1] isEqual:@"row 100"], @"row 99 == 'row 100'");
+
+	// scrolling fetches the pages in view, in any order
+	[model setVisibleRange:NSMakeRange(12345, 40)];
+	waitFor(^BOOL{ return [model valueAtRow:12350 column:0] != nil; });
+	NSCAssert([[model valueAtRow:12350 column:0] isEqual:@(12351)], @"row 12350 == 12351");
+
+	[model setVisibleRange:NSMakeRange(300, 40)];
+	waitFor(^BOOL{ return [model valueAtRow:310 column:1] != nil; });
+	NSCAssert([[model valueAtRow:310 column:1] isEqual:@"row 311"], @"row 310 == 'row 311'");
+
+	// the rows are counted in chunks between page fetches
+	waitFor(^BOOL{ return model.rowCountKnown; });
+	NSCAssert(model.numberOfRows == 25000, @"model.numberOfRows == 25000");
+	NSCAssert(model.error == nil, @"model.error == nil");
+
+	[model close];
+	[model release];
+	dispatch_sync(fetchQueue, ^{});
+
+	// other statements run once without a cursor
+	model = [[PGQueryResultModel alloc] initWithConnection:conn query:@"UPDATE model_rows SET t = 'updated' WHERE n <= 10 RETURNING n"
+													 queue:fetchQueue pageSize:100];
+	model.callbackQueue = callbackQueue;
+	model.changeHandler = ^{ dispatch_semaphore_signal(changed); };
+	[model start];
+
+	waitFor(^BOOL{ return model.rowCountKnown || model.error; });
+	NSCAssert(model.error == nil, @"model.error == nil");
+	NSCAssert(model.numberOfRows == 10, @"model.numberOfRows == 10");
+	NSCAssert([model valueAtRow:9 column:0] != nil, @"row 9 of the RETURNING result");
+
+	[model close];
+	[model release];
+	dispatch_sync(fetchQueue, ^{});
+
+	result = [conn executeQuery:@"SELECT count(*) FROM model_rows WHERE t = 'updated'"];
+	NSCAssert([[result valueAtRowIndex:0 fieldIndex:0] isEqual:@(10)], @"the UPDATE ran once");
+
+	[conn executeQuery:@"DROP TABLE model_rows"];
+	dispatch_release(changed);
+	dispatch_release(callbackQueue);
+	dispatch_release(fetchQueue);
+}
+
+void TestResultSnapshot(PGConnection *conn)
+{
+	printf("%s:\n", __func__);
+
+	NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"pgtest.pgsnap"];
+	NSError *error = nil;
+
+	PGResult *result = [conn executeQuery:@"SELECT g AS n, 'row ' || g AS t, CASE WHEN g % 2 = 0 THEN NULL ELSE g / 4.0::float8 END AS f, "
+						 "decode('00ff', 'hex') AS b, 1.5::numeric AS d, now() AS ts FROM generate_series(1, 1000) g"];
+	NSCAssert(result.status == kPGResultTuplesOK, @"result.status == kPGResultTuplesOK");
+
+	BOOL written = [result writeSnapshotToFile:path error:&error];
+	NSCAssert(written, @"[result writeSnapshotToFile:path error:&error]");
+
+	PGResult *snapshot = [PGResult resultWithContentsOfSnapshotFile:path error:&error];
+	NSCAssert(snapshot, @"[PGResult resultWithContentsOfSnapshotFile:path error:&error]");
+	NSCAssert(snapshot.numberOfRows == result.numberOfRows, @"snapshot.numberOfRows == result.numberOfRows");
+	NSCAssert([snapshot.fieldNames isEqual:result.fieldNames], @"[snapshot.fieldNames isEqual:result.fieldNames]");
+
+	for (NSUInteger row = 0; row < result.numberOfRows; row++) {
+		for (NSUInteger field = 0; field < result.numberOfFields; field++) {
+			id expected = [result valueAtRowIndex:row fieldIndex:field];
+			NSCAssert([[snapshot valueAtRowIndex:row fieldIndex:field] isEqual:expected], @"snapshot value isEqual: result value");
+		}
+	}
+	NSCAssert([snapshot[9][@"t"] isEqual:@"row 10"], @"[snapshot[9][@\"t\"] isEqual:@\"row 10\"]");
+
+	// a damaged file is rejected when opened
+
+	NSFileHandle *handle = [NSFileHandle fileHandleForWritingAtPath:path];
+	[handle truncateFileAtOffset:100];
+	[handle closeFile];
+	snapshot = [PGResult resultWithContentsOfSnapshotFile:path error:&error];
+	NSCAssert(snapshot == nil, @"truncated snapshot == nil");
+
+	[[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+}
+
+@interface PGTestModel : NSObject
+@property long long identifier;
+@property double score;
+@property BOOL active;
+@property (copy) NSString *name;
+@property (readonly) short rank;
+@property (retain) NSNumber *total;
+@end
+
+@implementation PGTestModel
+- (void)dealloc
+{
+	[_name release];
+	[_total release];
+	[super dealloc];
+}
+@end
+
+void TestRowMapper(PGConnection *conn)
+{
+	printf("%s:\n", __func__);
+
+	PGResult *result = [conn executeQuery:@"SELECT g::int8 AS id, g * 0.5::float8 AS score, g % 2 = 0 AS active, 'name ' || g AS name, "
+						 "g::int2 AS rank, NULLIF(g, 3)::int4 AS other FROM generate_series(1, 10) g"];
+	NSCAssert(result.status == kPGResultTuplesOK, @"result.status == kPGResultTuplesOK");
+
+	PGRowMapper *mapper = [PGRowMapper mapperWithClass:[PGTestModel class] mapping:@{ @"id" : @"identifier", @"score" : @"score",
+							@"active" : @"active", @"name" : @"name", @"rank" : @"rank", @"other" : @"score" }];
+	NSArray *objects = [mapper objectsWithResult:result];
+	NSCAssert(objects.count == 10, @"objects.count == 10");
+
+	PGTestModel *model = objects[3];
+	NSCAssert(model.identifier == 4, @"model.identifier == 4");
+	NSCAssert(model.active, @"model.active");
+	NSCAssert([model.name isEqual:@"name 4"], @"[model.name isEqual:@\"name 4\"]");
+	NSCAssert(model.rank == 4, @"model.rank == 4");	// readonly, stored to the ivar
+	NSCAssert(model.score == 4.0, @"model.score == 4.0");	// \"other\" is mapped last
+	NSCAssert([objects[2] score] == 0.0, @"NULL is stored as 0");
+
+	// text results and implicit mapping; the unknown column is ignored
+
+	mapper = [PGRowMapper mapperWithClass:[PGTestModel class] mapping:nil];
+	result = [conn executeBatch:@"SELECT 7 AS identifier, 'seven' AS name, 't'::bool AS active, 'x' AS unknown"][0];
+	model = [mapper objectWithRow:result[0]];
+	NSCAssert(model.identifier == 7 && model.active && [model.name isEqual:@"seven"], @"text result mapped");
+
+	// text values are decoded by type for object properties, and checked against narrow scalars
+
+	result = [conn executeBatch:@"SELECT 12.5::numeric AS total"][0];
+	model = [mapper objectWithRow:result[0]];
+	NSCAssert([model.total isKindOfClass:[NSDecimalNumber class]] && model.total.doubleValue == 12.5, @"text numeric to NSDecimalNumber");
+
+	result = [conn executeBatch:@"SELECT 70000 AS rank"][0];
+	BOOL raised = NO;
+	@try {
+		[mapper objectWithRow:result[0]];
+	}
+	@catch (NSException *exception) {
+		raised = [exception.name isEqual:NSRangeException];
+	}
+	NSCAssert(raised, @"70000 doesn't fit a short");
+
+	// binary values are checked against the property's class, and floats against integer properties
+
+	result = [conn executeQuery:@"SELECT 5::int4 AS name"];
+	raised = NO;
+	@try {
+		[mapper objectWithRow:result[0]];
+	}
+	@catch (NSException *exception) {
+		raised = [exception.name isEqual:NSInvalidArgumentException];
+	}
+	NSCAssert(raised, @"an int4 isn't stored to an NSString property");
+
+	result = [conn executeQuery:@"SELECT 1e10::float8 AS rank"];
+	raised = NO;
+	@try {
+		[mapper objectWithRow:result[0]];
+	}
+	@catch (NSException *exception) {
+		raised = [exception.name isEqual:NSRangeException];
+	}
+	NSCAssert(raised, @"1e10 doesn't fit a short");
+}
+
+void TestWorkloadCapture(PGConnection *conn)
+{
+	printf("%s:\n", __func__);
+
+	NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"pgtest.pgcapture"];
+	NSError *error = nil;
+
+	PGWorkloadRecorder *recorder = [[PGWorkloadRecorder alloc] initWithPath:path error:&error];
+	NSCAssert(recorder, @"[[PGWorkloadRecorder alloc] initWithPath:path error:&error]");
+
+	conn.recorder = recorder;
+	[conn executeQuery:@"SELECT $1::int4 + 1" values:@[ @41 ]];
+	[conn executeQuery:@"SELECT $1::int4 + 1" values:@[ @1 ]];
+	[conn executeBatch:@"SELECT 1; SELECT 2"];
+
+	PGPreparedQuery *query = [PGPreparedQuery queryWithName:@"capture" sql:@"SELECT $1::text || 'x'" types:nil connection:conn];
+	[query executeWithValues:@[ @"abc" ]];
+
+	[conn beginTransaction];
+	[conn executeQuery:@"SELECT 3"];
+	[conn commitTransaction];
+	conn.recorder = nil;
+
+	[conn executeQuery:@"SELECT 'not recorded'"];
+	[recorder close];
+	[recorder release];
+
+	PGWorkloadCapture *capture = [[PGWorkloadCapture alloc] initWithContentsOfFile:path error:&error];
+	NSCAssert(capture, @"[[PGWorkloadCapture alloc] initWithContentsOfFile:path error:&error]");
+	NSCAssert(capture.statements.count == 6, @"capture.statements.count == 6");
+	NSCAssert(capture.events.count == 7, @"capture.events.count == 7");
+
+	PGWorkloadEvent *event = capture.events[1];
+	NSCAssert(event.statementIndex == [capture.events[0] statementIndex], @"repeated statement shares its index");
+	NSCAssert([capture.events[2] flags] & kPGWorkloadEventBatch, @"batch flag");
+	NSCAssert([capture.events[3] flags] & kPGWorkloadEventPrepared, @"prepared flag");
+
+	// transaction control is recorded around the statements it encloses
+	NSCAssert([capture.statements[[capture.events[4] statementIndex]] isEqual:@"BEGIN"], @"BEGIN recorded");
+	NSCAssert([capture.statements[[capture.events[5] statementIndex]] isEqual:@"SELECT 3"], @"executeQuery: recorded");
+	NSCAssert([capture.statements[[capture.events[6] statementIndex]] isEqual:@"COMMIT"], @"COMMIT recorded");
+
+	PGResult *result = [capture replayEvent:capture.events[0] connection:conn];
+	NSCAssert([result[0][0] isEqual:@42], @"replayed parameters");
+
+	result = [capture replayEvent:capture.events[3] connection:conn];
+	NSCAssert([result[0][0] isEqual:@"abcx"], @"replayed prepared statement");
+
+	[capture release];
+	[[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+}
+
+void TestWriteCoalescer(NSDictionary *params)
+{
+	printf("%s:\n", __func__);
+
+	PGConnection *conn = [[[PGConnection alloc] initWithParameters:params] autorelease];
+	NSCAssert([conn connect], @"[conn connect]");
+	CreateTable(conn, @"CREATE TEMP TABLE coalesced (n int4 PRIMARY KEY, label text, at timestamptz)");
+
+	PGWriteCoalescer *coalescer = [[PGWriteCoalescer alloc] initWithConnection:conn table:@"coalesced" columns:@[ @"n", @"label", @"at" ]];
+	NSCAssert(coalescer.method == kPGWriteMethodCopy, @"coalescer.method == kPGWriteMethodCopy");
+	coalescer.maxBatchSize = 64;
+
+	__block int32_t succeeded = 0, failed = 0;
+	dispatch_group_t completions = dispatch_group_create();	// entered for each row, left by its completion
+
+	dispatch_apply(500, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+		dispatch_group_enter(completions);
+		[coalescer insertRow:@[ @((int)i), [NSString stringWithFormat:@"row %zu", i], [NSDate date] ] completion:^(NSError *error) {
+			OSAtomicIncrement32Barrier(error ? &failed : &succeeded);
+			dispatch_group_leave(completions);
+		}];
+	});
+
+	// a duplicate key fails alone; the rest of its batch is retried and committed
+	dispatch_group_enter(completions);
+	[coalescer insertRow:@[ @7, @"duplicate", NSNull.null ] completion:^(NSError *error) {
+		NSCAssert([(PGError *)error sqlState] == kPGSQLStateUniqueViolation, @"unique violation");
+		OSAtomicIncrement32Barrier(&failed);
+		dispatch_group_leave(completions);
+	}];
+	dispatch_group_enter(completions);
+	[coalescer insertRow:@[ @500, @"after", NSNull.null ] completion:^(NSError *error) {
+		OSAtomicIncrement32Barrier(error ? &failed : &succeeded);
+		dispatch_group_leave(completions);
+	}];
+
+	[coalescer close];
+	[coalescer release];
+
+	PGResult *result = [conn executeQuery:@"SELECT count(*) FROM coalesced"];
+	NSCAssert([result[0][0] isEqual:@501], @"501 rows written");
+
+	// numeric has no binary encoder, so rows are written with INSERT
+	CreateTable(conn, @"CREATE TEMP TABLE coalesced_numeric (n int4, d numeric)");
+	coalescer = [[PGWriteCoalescer alloc] initWithConnection:conn table:@"coalesced_numeric" columns:@[ @"n", @"d" ]];
+	NSCAssert(coalescer.method == kPGWriteMethodInsert, @"coalescer.method == kPGWriteMethodInsert");
+	for (int i = 0; i < 10; i++)
+		[coalescer insertRow:@[ @(i), [NSDecimalNumber decimalNumberWithString:@"1.25"] ] completion:nil];
+	[coalescer flush];
+	[coalescer release];
+
+	result = [conn executeQuery:@"SELECT sum(d)::text FROM coalesced_numeric"];
+	NSCAssert([result[0][0] isEqual:@"12.50"], @"numeric rows inserted");
+
+	// completions run asynchronously
+	long timedOut = dispatch_group_wait(completions, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC));
+	NSCAssert(timedOut == 0, @"every completion called");
+	NSCAssert(succeeded == 501 && failed == 1, @"completions reported");
+	dispatch_release(completions);
+}
+
+void TestShardRouter(NSDictionary *params)
+{
+	printf("%s:\n", __func__);
+
+	// Each shard's rows are in a temporary table, so one database serves for three
+	PGShardRouter *router = [[[PGShardRouter alloc] initWithShardParameters:@[ params, params, params ]] autorelease];
+	NSError *error = nil;
+	NSCAssert([router connect:&error], @"[router connect:&error]");
+
+	for (PGConnection *conn in router.connections)
+		CreateTable(conn, @"CREATE TEMP TABLE sharded (customer int4, amount float8)");
+
+	NSUInteger counts[3] = { 0, 0, 0 };
+	for (int customer = 0; customer < 300; customer++) {
+		counts[[router shardIndexForKey:@(customer)]]++;
+		[router executeQuery:@"INSERT INTO sharded VALUES ($1, $2)" values:@[ @(customer), @(customer * 1.5) ] forKey:@(customer)];
+	}
+	NSCAssert(counts[0] && counts[1] && counts[2], @"keys spread across shards");
+	NSCAssert([router shardIndexForKey:@"abc"] == [router shardIndexForKey:@"abc"], @"hash is stable");
+
+	PGResult *result = [router executeQuery:@"SELECT amount FROM sharded WHERE customer = $1" values:@[ @42 ] forKey:@42];
+	NSCAssert(result.numberOfRows == 1 && [result[0][0] doubleValue] == 63.0, @"routed by key");
+
+	NSArray *results = [router executeQueryOnAllShards:@"SELECT count(*) FROM sharded" values:nil];
+	NSCAssert([results[1][0][0] unsignedIntegerValue] == counts[1], @"per-shard results");
+
+	// merged in ORDER BY order from every shard
+	NSComparator comparator = PGRowComparatorWithSortDescriptors(@[ [NSSortDescriptor sortDescriptorWithKey:@"customer" ascending:NO] ]);
+	result = [router executeMergedQuery:@"SELECT customer, amount FROM sharded ORDER BY customer DESC" values:nil comparator:comparator];
+	NSCAssert(result.numberOfRows == 300, @"result.numberOfRows == 300");
+	for (NSUInteger i = 0; i < 300; i++)
+		NSCAssert([result[i][@"customer"] integerValue] == 299 - i, @"rows merged in order");
+
+	__block NSUInteger seen = 0;
+	BOOL success = [router enumerateRowsOfQuery:@"SELECT customer FROM sharded WHERE customer < $1 ORDER BY customer" values:@[ @100 ]
+									 comparator:PGRowComparatorWithSortDescriptors(@[ [NSSortDescriptor sortDescriptorWithKey:@"customer" ascending:YES] ])
+										  error:&error handler:^(PGRow *row, NSUInteger shard, BOOL *stop) {
+		NSCAssert([row[@"customer"] unsignedIntegerValue] == seen, @"streamed in order");
+		*stop = (++seen == 50);
+	}];
+	NSCAssert(success && seen == 50, @"stopped early");
+
+	success = [router enumerateRowsOfQuery:@"SELECT 1 / 0" values:nil comparator:nil error:&error handler:^(PGRow *row, NSUInteger shard, BOOL *stop) {}];
+	NSCAssert(!success && [(PGError *)error sqlState] == kPGSQLStateDivisionByZero, @"shard error reported");
+
+	// every shard's connection is ready for the next query
+	for (PGResult *shardResult in [router executeQueryOnAllShards:@"SELECT 1" values:nil])
+		NSCAssert(shardResult.status == kPGResultTuplesOK, @"shard usable after an error");
+	success = [router enumerateRowsOfQuery:@"SELECT 1" values:nil comparator:nil error:&error handler:^(PGRow *row, NSUInteger shard, BOOL *stop) {}];
+	NSCAssert(success, @"enumerate after an error");
+
+	// range placement
+	router.shardFunction = [PGShardRouter rangeFunctionWithBounds:@[ @100, @200 ]];
+	NSCAssert([router shardIndexForKey:@99] == 0 && [router shardIndexForKey:@100] == 1 && [router shardIndexForKey:@500] == 2, @"range shards");
+
+	[router disconnect];
+}
+
+void TestParallelScan(NSDictionary *params)
+{
+	printf("%s:\n", __func__);
+
+	// The scan's connections can't see the main connection's uncommitted tables
+	PGConnection *conn = [[[PGConnection alloc] initWithParameters:params] autorelease];
+	NSCAssert([conn connect], @"[conn connect]");
+	CreateTable(conn, @"CREATE TABLE scanned AS SELECT g AS id, 'row ' || g AS label FROM generate_series(1, 10000) g");
+
+	PGParallelScan *scan = [[[PGParallelScan alloc] initWithParameters:params table:@"scanned"] autorelease];
+	scan.keyColumn = @"id";
+	scan.numberOfConnections = 4;
+
+	__block int64_t rows = 0, sum = 0;
+	__block uint32_t workers = 0;
+	NSError *error = nil;
+
+	BOOL success = [scan scanWithHandler:^(PGRow *row, NSUInteger worker, BOOL *stop) {
+		OSAtomicIncrement64Barrier(&rows);
+		OSAtomicAdd64Barrier([row[@"id"] longLongValue], &sum);
+		OSAtomicOr32Barrier(1 << worker, &workers);
+	} error:&error];
+	NSCAssert(success, @"[scan scanWithHandler:error:]");
+	NSCAssert(rows == 10000 && sum == 50005000, @"every row read once");
+	NSCAssert(workers == 0xF, @"every connection read a range");
+
+	// rows without a key are read whatever the number of ranges
+	[conn executeQuery:@"INSERT INTO scanned VALUES (NULL, 'no key')"];
+	for (NSUInteger n = 1; n <= 4; n += 3) {
+		scan.numberOfConnections = n;
+		rows = 0;
+		success = [scan scanWithHandler:^(PGRow *row, NSUInteger worker, BOOL *stop) {
+			OSAtomicIncrement64Barrier(&rows);
+		} error:&error];
+		NSCAssert(success && rows == 10001, @"rows with a NULL key are read");
+	}
+
+	// the span of extreme keys doesn't overflow
+	CreateTable(conn, @"CREATE TABLE extremes AS SELECT unnest(ARRAY[-9223372036854775808, 0, 9223372036854775807]::int8[]) AS id");
+	PGParallelScan *extremes = [[[PGParallelScan alloc] initWithParameters:params table:@"extremes"] autorelease];
+	extremes.keyColumn = @"id";
+	rows = 0;
+	success = [extremes scanWithHandler:^(PGRow *row, NSUInteger worker, BOOL *stop) {
+		OSAtomicIncrement64Barrier(&rows);
+	} error:&error];
+	NSCAssert(success && rows == 3, @"scan of extreme keys");
+	DropTable(conn, @"extremes");
+
+	// by ctid, delivered one row at a time
+	scan.keyColumn = nil;
+	scan.condition = @"id % 2 = 0";
+	rows = 0;
+	__block BOOL inHandler = NO;
+	success = [scan scanSeriallyWithHandler:^(PGRow *row, NSUInteger worker, BOOL *stop) {
+		NSCAssert(!inHandler, @"handler called serially");
+		inHandler = YES;
+		rows++;
+		inHandler = NO;
+	} error:&error];
+	NSCAssert(success && rows == 5000, @"filtered ctid scan");
+
+	success = [scan scanWithHandler:^(PGRow *row, NSUInteger worker, BOOL *stop) { *stop = YES; } error:&error];
+	NSCAssert(success, @"stopped scan succeeds");
+
+	DropTable(conn, @"scanned");
+}
+
+void TestReplicationStream(NSDictionary *params)
+{
+	printf("%s:\n", __func__);
+
+	PGReplicationStream *stream = [[[PGReplicationStream alloc] initWithParameters:params slotName:@"pgtest_slot" plugin:kPGReplicationPluginTestDecoding] autorelease];
+	NSError *error = nil;
+
+	NSCAssert([stream connect:&error], @"[stream connect:&error]");
+	if (![stream createSlot:&error]) {
+		printf("skipped: %s\n", error.description.UTF8String);	// e.g., wal_level is not logical
+		return;
+	}
+
+	PGConnection *conn = [[[PGConnection alloc] initWithParameters:params] autorelease];
+	NSCAssert([conn connect], @"[conn connect]");
+	CreateTable(conn, @"CREATE TABLE replicated (id int4 PRIMARY KEY, label text)");
+	[conn executeQuery:@"INSERT INTO replicated SELECT g, 'it''s ' || g FROM generate_series(1, 100) g"];
+	[conn executeQuery:@"UPDATE replicated SET label = NULL WHERE id = 7"];
+	[conn executeQuery:@"DELETE FROM replicated WHERE id = 9"];
+
+	__block NSUInteger inserts = 0;
+	__block PGChange *update = nil, *delete = nil;
+
+	BOOL success = [stream streamChangesFromLSN:0 error:&error handler:^(PGChange *change, BOOL *stop) {
+		if (![change.table isEqual:@"replicated"] && change.type != kPGChangeCommit) return;
+
+		switch (change.type) {
+			case kPGChangeInsert: inserts++; break;
+			case kPGChangeUpdate: update = [change retain]; break;
+			case kPGChangeDelete: delete = [change retain]; break;
+			case kPGChangeCommit: *stop = (delete != nil); break;
+			default: break;
+		}
+	}];
+	NSCAssert(success, @"[stream streamChangesFromLSN:0 error:&error handler:]");
+	NSCAssert(inserts == 100, @"inserts == 100");
+	NSCAssert([update.values[@"id"] isEqual:@"7"] && update.values[@"label"] == NSNull.null, @"update decoded");
+	NSCAssert([delete.oldValues[@"id"] isEqual:@"9"], @"delete decoded");
+	NSCAssert(stream.confirmedLSN >= delete.lsn, @"changes confirmed");
+	[update release];
+	[delete release];
+
+	DropTable(conn, @"replicated");
+	NSCAssert([stream dropSlot:&error], @"[stream dropSlot:&error]");
+	[stream disconnect];
+}
+
+typedef struct {
+	int64_t id;
+	double score;
+	bool scoreIsNull;
+	int16_t rank;
+	NSTimeInterval at;
+	char name[8];
+} PGTestRecord;
+
+void TestStructDecoding(PGConnection *conn)
+{
+	printf("%s:\n", __func__);
+
+	static const PGStructField fields[] = {
+		PGStructFieldMake("id", PGTestRecord, id, kPGStructFieldInt64),
+		PGStructFieldMakeNullable("score", PGTestRecord, score, kPGStructFieldDouble, scoreIsNull),
+		PGStructFieldMake("rank", PGTestRecord, rank, kPGStructFieldInt16),
+		PGStructFieldMake("at", PGTestRecord, at, kPGStructFieldTimeInterval),
+		PGStructFieldMake("name", PGTestRecord, name, kPGStructFieldString)
+	};
+	PGTestRecord records[4];
+	NSError *error = nil;
+
+	PGResult *result = [conn executeQuery:@"SELECT g AS id, NULLIF(g * 1.5, 3)::numeric AS score, g::int2 AS rank, "
+						 "'2001-01-01 00:00:00+00'::timestamptz + g * interval '1 second' AS at, 'name number ' || g AS name "
+						 "FROM generate_series(1, 10) g"];
+	NSCAssert(result.status == kPGResultTuplesOK, @"result.status == kPGResultTuplesOK");
+
+	BOOL success = [result getStructs:records stride:sizeof(PGTestRecord) range:NSMakeRange(1, 4) fields:fields count:5 error:&error];
+	NSCAssert(success, @"[result getStructs:...]");
+	NSCAssert(records[0].id == 2 && records[0].rank == 2, @"records[0].id == 2 && records[0].rank == 2");
+	NSCAssert(records[0].scoreIsNull && records[0].score == 0.0, @"NULL zeroed and flagged");
+	NSCAssert(!records[1].scoreIsNull && records[1].score == 4.5, @"records[1].score == 4.5");
+	NSCAssert(records[3].at == 5.0, @"records[3].at == 5.0");
+	NSCAssert(strcmp(records[3].name, "name nu") == 0, @"string truncated to fit");
+
+	// int4 can't be narrowed to int16_t
+	static const PGStructField narrow[] = { PGStructFieldMake("id", PGTestRecord, rank, kPGStructFieldInt16) };
+	NSCAssert(![result getStructs:records stride:sizeof(PGTestRecord) range:NSMakeRange(0, 1) fields:narrow count:1 error:&error],
+			  @"incompatible column rejected");
+
+	// text results
+	result = [conn executeBatch:@"SELECT 7::int8 AS id, 2.25::float8 AS score, 3::int2 AS rank, 'seven' AS name"][0];
+	success = [result getStructs:records stride:sizeof(PGTestRecord) range:NSMakeRange(0, 1) fields:fields count:3 error:&error];
+	NSCAssert(success && records[0].id == 7 && records[0].score == 2.25 && records[0].rank == 3, @"text result decoded");
+}
+
+/** The position of a FlatBuffers table's field, or NULL if it is absent. */
+static const uint8_t *PGTestFlatField(const uint8_t *table, int field)
+{
+	const uint8_t *vtable = table - (int32_t)OSReadLittleInt32(table, 0);
+	uint16_t vtableSize = OSReadLittleInt16(vtable, 0);
+
+	if (4 + 2 * field >= vtableSize)
+		return NULL;
+
+	uint16_t offset = OSReadLittleInt16(vtable, 4 + 2 * field);
+	return offset ? table + offset : NULL;
+}
+
+/** The table, vector or string referred to by the offset at a position. */
+static const uint8_t *PGTestFlatDeref(const uint8_t *position)
+{
+	return position + OSReadLittleInt32(position, 0);
+}
+
+/** Parse the encapsulated Arrow message at offset, returning its Message table, header
+ *  type and body, and advancing offset past the body.
+ */
+static const uint8_t *PGTestArrowMessage(NSData *stream, NSUInteger *offset, uint8_t *headerType, const uint8_t **body, int64_t *bodyLength)
+{
+	const uint8_t *bytes = (const uint8_t *)stream.bytes + *offset;
+
+	NSCAssert(OSReadLittleInt32(bytes, 0) == 0xFFFFFFFF, @"continuation marker");
+	uint32_t metadataLength = OSReadLittleInt32(bytes, 4);
+	NSCAssert(metadataLength % 8 == 0, @"metadata padded to 8 bytes");
+
+	const uint8_t *message = PGTestFlatDeref(bytes + 8);
+	NSCAssert(OSReadLittleInt16(PGTestFlatField(message, 0), 0) == 4, @"MetadataVersion V5");
+
+	*headerType = *PGTestFlatField(message, 1);
+	*bodyLength = OSReadLittleInt64(PGTestFlatField(message, 3), 0);
+	*body = bytes + 8 + metadataLength;
+	*offset += 8 + metadataLength + *bodyLength;
+	NSCAssert(*offset <= stream.length, @"message within the stream");
+
+	return PGTestFlatDeref(PGTestFlatField(message, 2));
+}
+
+void TestResultWriter(PGConnection *conn)
+{
+	printf("%s:\n", __func__);
+
+	NSString *query = @"SELECT g AS id, CASE g WHEN 2 THEN NULL ELSE 'say \"' || g || '\", ok' END AS label, g * 0.25::float8 AS score, "
+					  "12.50::numeric AS amount, g % 2 = 0 AS even, '2001-01-01 00:00:01.5+00'::timestamptz AS at FROM generate_series(1, 3) g";
+	PGResult *result = [conn executeQuery:query];
+	NSCAssert(result.status == kPGResultTuplesOK, @"result.status == kPGResultTuplesOK");
+	NSError *error = nil;
+
+	NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
+	[stream open];
+	PGResultWriter *writer = [[[PGResultWriter alloc] initWithOutputStream:stream format:kPGResultWriterCSV] autorelease];
+	writer.bufferSize = 16;		// forces writes mid-row
+	NSCAssert([writer writeResult:result error:&error] && [writer finish:&error], @"CSV written");
+
+	NSString *csv = [[[NSString alloc] initWithData:[stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey] encoding:NSUTF8StringEncoding] autorelease];
+	NSString *expected = @"id,label,score,amount,even,at\n"
+						 "1,\"say \"\"1\"\", ok\",0.25,12.50,false,2001-01-01T00:00:01.5Z\n"
+						 "2,,0.5,12.50,true,2001-01-01T00:00:01.5Z\n"
+						 "3,\"say \"\"3\"\", ok\",0.75,12.50,false,2001-01-01T00:00:01.5Z\n";
+	NSCAssert([csv isEqual:expected], @"CSV output");
+	[stream close];
+
+	stream = [NSOutputStream outputStreamToMemory];
+	[stream open];
+	writer = [[[PGResultWriter alloc] initWithOutputStream:stream format:kPGResultWriterJSONLines] autorelease];
+	NSCAssert([writer writeRowsOfQuery:query values:nil connection:conn error:&error] && [writer finish:&error], @"JSON Lines written");
+	NSCAssert(writer.numberOfRows == 3, @"writer.numberOfRows == 3");
+
+	NSString *json = [[[NSString alloc] initWithData:[stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey] encoding:NSUTF8StringEncoding] autorelease];
+	NSArray *lines = [json componentsSeparatedByString:@"\n"];
+	NSCAssert(lines.count == 4 && [lines[3] length] == 0, @"one line per row");
+	NSDictionary *row = [NSJSONSerialization JSONObjectWithData:[lines[1] dataUsingEncoding:NSUTF8StringEncoding] options:0 error:NULL];
+	NSCAssert(row[@"label"] == NSNull.null && [row[@"even"] isEqual:@YES] && [row[@"amount"] doubleValue] == 12.5, @"JSON values");
+	[stream close];
+
+	// Arrow: a schema message, two record batches and the end-of-stream marker
+	NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"pgtest.arrow"];
+	int fd = open(path.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	NSCAssert(fd >= 0, @"fd >= 0");
+
+	writer = [[[PGResultWriter alloc] initWithFileDescriptor:fd format:kPGResultWriterArrow] autorelease];
+	writer.rowsPerBatch = 2;
+	NSCAssert([writer writeResult:result error:&error] && [writer finish:&error], @"Arrow written");
+	close(fd);
+
+	NSData *arrow = [NSData dataWithContentsOfFile:path];
+	const uint8_t *bytes = arrow.bytes;
+	const uint8_t endOfStream[8] = { 0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0 };
+	NSCAssert(arrow.length % 8 == 0 && memcmp(bytes, endOfStream, 4) == 0, @"Arrow framing");
+	NSCAssert(memcmp(bytes + arrow.length - 8, endOfStream, 8) == 0, @"Arrow end-of-stream");
+
+	// the schema: a nullable field of the mapped type for each column
+	NSUInteger offset = 0;
+	uint8_t headerType;
+	const uint8_t *body;
+	int64_t bodyLength;
+
+	const uint8_t *schema = PGTestArrowMessage(arrow, &offset, &headerType, &body, &bodyLength);
+	NSCAssert(headerType == 1 && bodyLength == 0, @"Schema message");
+
+	const uint8_t *fields = PGTestFlatDeref(PGTestFlatField(schema, 1));
+	const uint8_t expectedTypes[6] = { 2, 5, 3, 5, 6, 10 };	// Int, Utf8, FloatingPoint, Utf8 (numeric), Bool, Timestamp
+	NSCAssert(OSReadLittleInt32(fields, 0) == 6, @"six fields");
+
+	for (int i = 0; i < 6; i++) {
+		const uint8_t *field = PGTestFlatDeref(fields + 4 + 4 * i);
+		NSCAssert(*PGTestFlatField(field, 1) == 1, @"field is nullable");
+		NSCAssert(*PGTestFlatField(field, 2) == expectedTypes[i], @"field type id");
+	}
+	const uint8_t *name = PGTestFlatDeref(PGTestFlatField(PGTestFlatDeref(fields + 4), 0));
+	NSCAssert(OSReadLittleInt32(name, 0) == 2 && memcmp(name + 4, "id", 2) == 0, @"first field is \"id\"");
+
+	// the first record batch: two rows, a node per column, and contiguous 8-byte aligned buffers
+	const uint8_t *batch = PGTestArrowMessage(arrow, &offset, &headerType, &body, &bodyLength);
+	NSCAssert(headerType == 3, @"RecordBatch message");
+	NSCAssert(OSReadLittleInt64(PGTestFlatField(batch, 0), 0) == 2, @"batch length == 2");
+
+	const uint8_t *nodes = PGTestFlatDeref(PGTestFlatField(batch, 1));
+	NSCAssert(OSReadLittleInt32(nodes, 0) == 6, @"six field nodes");
+	for (int i = 0; i < 6; i++) {
+		int64_t nullCount = OSReadLittleInt64(nodes, 4 + 16 * i + 8);
+		NSCAssert(OSReadLittleInt64(nodes, 4 + 16 * i) == 2, @"node length == 2");
+		NSCAssert(nullCount == (i == 1 ? 1 : 0), @"only label has a NULL");
+	}
+
+	// validity and values for fixed-width columns, plus data for the two Utf8 columns
+	const uint8_t *buffers = PGTestFlatDeref(PGTestFlatField(batch, 2));
+	uint32_t numberOfBuffers = OSReadLittleInt32(buffers, 0);
+	int64_t expectedOffset = 0;
+	NSCAssert(numberOfBuffers == 14, @"14 buffers");
+
+	for (uint32_t i = 0; i < numberOfBuffers; i++) {
+		int64_t bufferOffset = OSReadLittleInt64(buffers, 4 + 16 * i);
+		int64_t bufferLength = OSReadLittleInt64(buffers, 4 + 16 * i + 8);
+		NSCAssert(bufferOffset == expectedOffset, @"buffers are contiguous and 8-byte aligned");
+		expectedOffset += (bufferLength + 7) & ~7;
+	}
+	NSCAssert(expectedOffset == bodyLength, @"buffers fill the body");
+
+	NSCAssert(OSReadLittleInt64(buffers, 4 + 8) == 0, @"id has no validity bitmap");
+	NSCAssert(OSReadLittleInt64(buffers, 4 + 16 + 8) == 8, @"id values are two int32");
+	NSCAssert(OSReadLittleInt32(body, 0) == 1 && OSReadLittleInt32(body, 4) == 2, @"id values == 1, 2");
+	NSCAssert(OSReadLittleInt64(buffers, 4 + 32 + 8) == 1, @"label has a validity bitmap");
+	NSCAssert(body[OSReadLittleInt64(buffers, 4 + 32)] == 0x01, @"label row 2 is NULL");
+
+	// the second batch holds the last row, followed by the end-of-stream marker
+	batch = PGTestArrowMessage(arrow, &offset, &headerType, &body, &bodyLength);
+	NSCAssert(headerType == 3 && OSReadLittleInt64(PGTestFlatField(batch, 0), 0) == 1, @"second batch length == 1");
+	NSCAssert(offset == arrow.length - 8, @"end-of-stream follows the last batch");
+
+	[[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+}
+
+void TestConnectionParameters(NSDictionary *params)
+{
+	printf("%s:\n", __func__);
+
+	// session parameters are escaped into the options string, so spaces and backslashes
+	// survive; pgtest.note is a placeholder variable, which any string may be assigned
+	NSDictionary *session = @{ @"search_path" : @"\"my schema\", public", @"pgtest.note" : @"back\\slash and space" };
+	PGConnection *conn = [[[PGConnection alloc] initWithParameters:params sessionParameters:session] autorelease];
+	NSCAssert([conn connect], @"[conn connect] with session parameters");
+
+	PGResult *result = [conn executeQuery:@"SHOW search_path"];
+	NSCAssert([result[0][0] isEqual:@"\"my schema\", public"], @"search_path read back");
+	result = [conn executeQuery:@"SHOW pgtest.note"];
+	NSCAssert([result[0][0] isEqual:@"back\\slash and space"], @"pgtest.note read back");
+	[conn disconnect];
+
+	// without an application_name, the process name is the fallback
+	conn = [[[PGConnection alloc] initWithParameters:params] autorelease];
+	NSCAssert([conn connect], @"[conn connect]");
+	result = [conn executeQuery:@"SHOW application_name"];
+	NSCAssert([result[0][0] isEqual:[[NSProcessInfo processInfo] processName]], @"fallback_application_name is the process name");
+	[conn disconnect];
+
+	NSMutableDictionary *named = [[params mutableCopy] autorelease];
+	named[PGConnectionParameterApplicationNameKey] = @"named by parameter";
+	conn = [[[PGConnection alloc] initWithParameters:named] autorelease];
+	NSCAssert([conn connect], @"[conn connect] with application_name");
+	result = [conn executeQuery:@"SHOW application_name"];
+	NSCAssert([result[0][0] isEqual:@"named by parameter"], @"application_name overrides the fallback");
+	[conn disconnect];
+}
+
+void TestMultiplexer(NSDictionary *params)
+{
+	printf("%s:\n", __func__);
+
+	PGConnection *conn = [[[PGConnection alloc] initWithParameters:params] autorelease];
+	NSCAssert([conn connect], @"[conn connect]");
+
+	PGConnectionMultiplexer *multiplexer = [[PGConnectionMultiplexer alloc] initWithConnection:conn];
+	NSMutableArray *futures = [NSMutableArray array];
+	NSObject *lock = [[[NSObject alloc] init] autorelease];
+
+	dispatch_apply(100, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+		PGQueryFuture *future = [multiplexer submitQuery:@"SELECT $1::int4 * 2" values:@[ @((int)i) ]];
+		@synchronized(lock) {
+			[futures addObject:future];
+		}
+	});
+
+	for (PGQueryFuture *future in futures) {
+		PGResult *result = future.result;
+		NSCAssert(result.status == kPGResultTuplesOK, @"result.status == kPGResultTuplesOK");
+		NSCAssert([[result valueAtRowIndex:0 fieldIndex:0] intValue] == [future.values[0] intValue] * 2, @"result == value * 2");
+	}
+
+	// a failed query doesn't affect the next one
+
+	__block PGResult *completed = nil;
+	dispatch_semaphore_t done = dispatch_semaphore_create(0);
+	[multiplexer submitQuery:@"SELECT * FROM no_such_table" values:nil completionQueue:NULL completion:^(PGResult *result) {
+		completed = [result retain];
+		dispatch_semaphore_signal(done);
+	}];
+	dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+	dispatch_release(done);
+	NSCAssert(completed.status == kPGResultFatalError, @"completed.status == kPGResultFatalError");
+	[completed release];
+
+	NSCAssert([multiplexer executeQuery:@"SELECT 1" values:nil].status == kPGResultTuplesOK, @"query after a failure");
+
+	[multiplexer close];
+	NSCAssert([multiplexer submitQuery:@"SELECT 1" values:nil].result.status == kPGResultFatalError, @"submission after close fails");
+	[multiplexer release];
+}
+
+void TestReplicaRouter(NSDictionary *params)
+{
+	printf("%s:\n", __func__);
+
+	NSCAssert(PGLSNFromString(@"16/B374D848") == 0x16B374D848ULL, @"PGLSNFromString(@\"16/B374D848\")");
+	NSCAssert(PGLSNFromString(@"bogus") == 0, @"PGLSNFromString(@\"bogus\") == 0");
+
+	PGReplicaRouter *router = [[PGReplicaRouter alloc] initWithNodeParameters:@[ params ]];
+	router.maxReplicaLagBytes = 16 * 1024 * 1024;
+
+	NSError *error = nil;
+	BOOL connected = [router connect:&error];
+	NSCAssert(connected, @"[router connect:&error]");
+
+	// the primary's position is a real LSN, matching the server's own arithmetic on pg_lsn
+	PGResult *position = [router.primaryConnection executeQuery:@"SELECT (pg_current_wal_lsn() - '0/0'::pg_lsn)::int8"];
+	uint64_t primaryLSN = [router _primaryLSN];
+	NSCAssert(primaryLSN != 0, @"[router _primaryLSN] != 0");
+	NSCAssert(primaryLSN >= [position[0][0] unsignedLongLongValue], @"primaryLSN >= the server's position");
+	NSCAssert(primaryLSN - [position[0][0] unsignedLongLongValue] < 1024 * 1024, @"primaryLSN is near the server's position");
+
+	// lag is measured on a separate connection, so a busy primary is still measured
+	__block uint64_t busyLSN = 0;
+	[router performWithConnectionReadOnly:NO block:^(PGConnection *conn) {
+		busyLSN = [router _primaryLSN];
+	}];
+	NSCAssert(busyLSN >= primaryLSN, @"[router _primaryLSN] while the primary is busy");
+
+	// with no replicas, reads fall back to the primary
+
+	PGResult *result = [router executeQuery:@"SELECT pg_is_in_recovery()" values:nil readOnly:YES];
+	NSCAssert(result.status == kPGResultTuplesOK, @"result.status == kPGResultTuplesOK");
+
+	BOOL success = [router performTransactionWithIsolation:kPGIsolationLevelRepeatableRead options:kPGTransactionOptionReadOnly block:^BOOL(PGConnection *conn, NSError **error) {
+		return [conn executeQuery:@"SELECT 1"].status == kPGResultTuplesOK;
+	} error:&error];
+	NSCAssert(success, @"read-only transaction");
+
+	[router disconnect];
+	[router release];
+}
+
 void CreateTable(PGConnection *conn, NSString *qry)
 {
 	PGResult *result;
@@ -301,9 +1356,69 @@ int main(int argc, char *argv[])
 //		TestArrays(conn);
 //		putchar('\n');
 //
+		TestConnectionParameters(params);
+		putchar('\n');
+
 		TestPreparedInts(conn);
 		putchar('\n');
 
+		TestPreparedDescription(conn);
+		putchar('\n');
+
+		TestTransactionBlocks(conn);
+		putchar('\n');
+
+		TestErrors(conn);
+		putchar('\n');
+
+		TestResultLimits(conn);
+		putchar('\n');
+
+		TestQueryCache(conn);
+		putchar('\n');
+
+		TestLargeObjects(conn);
+		putchar('\n');
+
+		TestBatch(conn);
+		putchar('\n');
+
+		TestQueryResultModel(conn);
+		putchar('\n');
+
+		TestReplicaRouter(params);
+		putchar('\n');
+
+		TestMultiplexer(params);
+		putchar('\n');
+
+		TestResultSnapshot(conn);
+		putchar('\n');
+
+		TestRowMapper(conn);
+		putchar('\n');
+
+		TestWorkloadCapture(conn);
+		putchar('\n');
+
+		TestWriteCoalescer(params);
+		putchar('\n');
+
+		TestShardRouter(params);
+		putchar('\n');
+
+		TestParallelScan(params);
+		putchar('\n');
+
+		TestReplicationStream(params);
+		putchar('\n');
+
+		TestStructDecoding(conn);
+		putchar('\n');
+
+		TestResultWriter(conn);
+		putchar('\n');
+
 bail:
 		DropTable(conn, @"ints");
 		DropTable(conn, @"floats");